@@ -40,6 +40,21 @@ GURL GetTopDocumentGURL(content::FrameTreeNode* frame_tree_node) {
       browser_context, common_params_->url,                           \
       GetTopDocumentGURL(frame_tree_node_), &common_params_->referrer);
 
+// Tracking query parameters are stripped at the top of WillStartRequest, so
+// that the throttles and the loader only ever see the filtered URL and the
+// navigation keeps its own id, redirect chain and initiator state. Server
+// redirects are left to WhaleProxyingURLLoaderFactory.
+#define WHALE_WILLSTARTREQUEST_MAYBESTRIPTRACKINGQUERY        \
+  if (GURL filtered_url;                                      \
+      GetContentClient()->browser()->MaybeStripTrackingQuery( \
+          this, &filtered_url)) {                             \
+    if (!redirect_chain_.empty() &&                           \
+        redirect_chain_.back() == common_params_->url) {      \
+      redirect_chain_.back() = filtered_url;                  \
+    }                                                         \
+    common_params_->url = filtered_url;                       \
+  }
+
 #define WHALE_ONSTARTCHECKSCOMPLETE_MAYBEHIDEREFERRER                 \
   GetContentClient()->browser()->MaybeHideReferrer(                   \
       frame_tree_node_->navigator().controller().GetBrowserContext(), \
@@ -49,3 +64,4 @@ GURL GetTopDocumentGURL(content::FrameTreeNode* frame_tree_node) {
 #include "content/browser/renderer_host/navigation_request.cc"
 
 #undef WHALE_ONSTARTCHECKSCOMPLETE_MAYBEHIDEREFERRER
+#undef WHALE_WILLSTARTREQUEST_MAYBESTRIPTRACKINGQUERY
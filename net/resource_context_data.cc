@@ -5,51 +5,214 @@
 
 #include "whale/whale/browser/net/resource_context_data.h"
 
+#include <algorithm>
+#include <cinttypes>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "base/containers/flat_map.h"
+#include "base/files/file_path.h"
+#include "base/path_service.h"
+#include "base/strings/stringprintf.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/memory_dump_manager.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "chrome/common/chrome_paths.h"
 #include "content/public/browser/browser_context.h"
 #include "content/public/browser/browser_thread.h"
 #include "net/cookies/site_for_cookies.h"
+#include "whale/components/tracking_blockers/ad_filter_list.h"
+#include "whale/components/tracking_blockers/tracker_domain_blocklist.h"
+
+namespace {
+
+// Number of frames reported individually in detailed dumps.
+constexpr size_t kMaxReportedFrames = 5;
+
+// Compiled tracker domain list, see whale_blocker::TrackerDomainTrie.
+constexpr base::FilePath::CharType kTrackerDomainListDir[] =
+    FILE_PATH_LITERAL("Tracker Domains");
+constexpr base::FilePath::CharType kTrackerDomainListFile[] =
+    FILE_PATH_LITERAL("trackers.dat");
+
+// Compiled ad filter list, see whale_blocker::AdFilterEngine.
+constexpr base::FilePath::CharType kAdFilterListDir[] =
+    FILE_PATH_LITERAL("Ad Filters");
+constexpr base::FilePath::CharType kAdFilterListFile[] =
+    FILE_PATH_LITERAL("filters.dat");
+
+struct FrameUsage {
+  size_t request_count = 0;
+  size_t bytes = 0;
+};
+
+}  // namespace
 
 // User data key for ResourceContextData.
 const void* const kResourceContextUserDataKey = &kResourceContextUserDataKey;
 
-ResourceContextData::ResourceContextData() : weak_factory_(this) {
+ResourceContextData::ResourceContextData(
+    content::BrowserContext* browser_context)
+    : decision_cache_(browser_context),
+      rules_publisher_(browser_context),
+      url_rewrite_settings_publisher_(browser_context),
+      weak_factory_(this) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  base::trace_event::MemoryDumpManager::GetInstance()->RegisterDumpProvider(
+      this, "WhaleResourceContextData",
+      base::SingleThreadTaskRunner::GetCurrentDefault());
+
+  base::FilePath user_data_dir;
+  if (base::PathService::Get(chrome::DIR_USER_DATA, &user_data_dir)) {
+    whale_blocker::TrackerDomainBlocklist::GetInstance()->Load(
+        user_data_dir.Append(kTrackerDomainListDir)
+            .Append(kTrackerDomainListFile));
+    whale_blocker::AdFilterList::GetInstance()->Load(
+        user_data_dir.Append(kAdFilterListDir).Append(kAdFilterListFile));
+  }
 }
 
-ResourceContextData::~ResourceContextData() = default;
+ResourceContextData::~ResourceContextData() {
+  base::trace_event::MemoryDumpManager::GetInstance()->UnregisterDumpProvider(
+      this);
+}
 
 // static
-void ResourceContextData::StartProxying(
-    content::BrowserContext* browser_context,
-    int render_process_id,
-    int frame_tree_node_id,
-    mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver,
-    mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory) {
-  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
-
+ResourceContextData* ResourceContextData::GetOrCreate(
+    content::BrowserContext* browser_context) {
   auto* self = static_cast<ResourceContextData*>(
       browser_context->GetUserData(kResourceContextUserDataKey));
   if (!self) {
-    self = new ResourceContextData();
+    self = new ResourceContextData(browser_context);
     browser_context->SetUserData(kResourceContextUserDataKey,
                                  base::WrapUnique(self));
   }
+  return self;
+}
 
+// static
+void ResourceContextData::StartProxying(
+    content::BrowserContext* browser_context,
+    int render_process_id,
+    int frame_tree_node_id,
+    mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver,
+    mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory,
+    mojo::PendingReceiver<network::mojom::TrustedURLLoaderHeaderClient>
+        header_client_receiver,
+    bool url_rewrite_in_network_service) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+
+  ResourceContextData* self = GetOrCreate(browser_context);
   auto proxy = std::make_unique<WhaleProxyingURLLoaderFactory>(
       browser_context, render_process_id, frame_tree_node_id,
-      std::move(receiver), std::move(target_factory), self->next_request_id(),
+      std::move(receiver), std::move(target_factory),
+      std::move(header_client_receiver), url_rewrite_in_network_service,
+      self->next_request_id(),
       base::BindOnce(&ResourceContextData::RemoveProxy,
                      self->weak_factory_.GetWeakPtr()));
 
   self->proxies_.emplace(std::move(proxy));
 }
 
+// static
+WhaleRequestDecisionCache* ResourceContextData::GetDecisionCache(
+    content::BrowserContext* browser_context) {
+  if (!browser_context) {
+    return nullptr;
+  }
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  auto* self = static_cast<ResourceContextData*>(
+      browser_context->GetUserData(kResourceContextUserDataKey));
+  return self ? &self->decision_cache_ : nullptr;
+}
+
+// static
+whale_blocker::TrackingBlockerRulesPublisher*
+ResourceContextData::GetRulesPublisher(
+    content::BrowserContext* browser_context) {
+  if (!browser_context) {
+    return nullptr;
+  }
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  auto* self = static_cast<ResourceContextData*>(
+      browser_context->GetUserData(kResourceContextUserDataKey));
+  return self ? &self->rules_publisher_ : nullptr;
+}
+
+// static
+whale_blocker::URLRewriteSettingsPublisher*
+ResourceContextData::GetURLRewriteSettingsPublisher(
+    content::BrowserContext* browser_context) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  return &GetOrCreate(browser_context)->url_rewrite_settings_publisher_;
+}
+
 void ResourceContextData::RemoveProxy(WhaleProxyingURLLoaderFactory* proxy) {
   auto it = proxies_.find(proxy);
   DCHECK(it != proxies_.end());
   proxies_.erase(it);
 }
+
+bool ResourceContextData::OnMemoryDump(
+    const base::trace_event::MemoryDumpArgs& args,
+    base::trace_event::ProcessMemoryDump* pmd) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  using base::trace_event::MemoryAllocatorDump;
+
+  size_t request_count = 0;
+  size_t total_bytes = 0;
+  base::flat_map<int, FrameUsage> frames;
+  for (const auto& proxy : proxies_) {
+    const size_t bytes = proxy->EstimateMemoryUsage();
+    request_count += proxy->request_count();
+    total_bytes += bytes;
+
+    FrameUsage& frame = frames[proxy->frame_tree_node_id()];
+    frame.request_count += proxy->request_count();
+    frame.bytes += bytes;
+  }
+
+  const std::string dump_name = base::StringPrintf(
+      "whale/resource_context_data/0x%" PRIXPTR,
+      reinterpret_cast<uintptr_t>(this));
+  MemoryAllocatorDump* dump = pmd->CreateAllocatorDump(dump_name);
+  dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes, total_bytes);
+  dump->AddScalar("proxy_count", MemoryAllocatorDump::kUnitsObjects,
+                  proxies_.size());
+  dump->AddScalar("in_flight_request_count",
+                  MemoryAllocatorDump::kUnitsObjects, request_count);
+  pmd->CreateAllocatorDump(dump_name + "/decision_cache")
+      ->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes,
+                  decision_cache_.EstimateMemoryUsage());
+
+  if (args.level_of_detail !=
+      base::trace_event::MemoryDumpLevelOfDetail::DETAILED) {
+    return true;
+  }
+
+  // Report the frames holding the most proxy state.
+  std::vector<std::pair<int, FrameUsage>> offenders(frames.begin(),
+                                                    frames.end());
+  const size_t reported = std::min(offenders.size(), kMaxReportedFrames);
+  std::partial_sort(offenders.begin(), offenders.begin() + reported,
+                    offenders.end(), [](const auto& a, const auto& b) {
+                      return a.second.bytes > b.second.bytes;
+                    });
+  for (size_t i = 0; i < reported; ++i) {
+    MemoryAllocatorDump* frame_dump = pmd->CreateAllocatorDump(
+        base::StringPrintf("%s/frame_%d", dump_name.c_str(),
+                           offenders[i].first));
+    frame_dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                          MemoryAllocatorDump::kUnitsBytes,
+                          offenders[i].second.bytes);
+    frame_dump->AddScalar("in_flight_request_count",
+                          MemoryAllocatorDump::kUnitsObjects,
+                          offenders[i].second.request_count);
+  }
+  return true;
+}
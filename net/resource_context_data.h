@@ -16,15 +16,21 @@
 #include "base/containers/unique_ptr_adapters.h"
 #include "base/memory/ref_counted.h"
 #include "base/supports_user_data.h"
+#include "base/trace_event/memory_dump_provider.h"
 #include "content/public/browser/content_browser_client.h"
 #include "mojo/public/cpp/bindings/pending_receiver.h"
 #include "mojo/public/cpp/bindings/pending_remote.h"
+#include "services/network/public/mojom/network_context.mojom.h"
 #include "services/network/public/mojom/url_loader_factory.mojom.h"
+#include "whale/components/tracking_blockers/tracking_blocker_rules_publisher.h"
+#include "whale/components/tracking_blockers/url_rewrite_settings_publisher.h"
 #include "whale/whale/browser/net/whale_proxying_url_loader_factory.h"
+#include "whale/whale/browser/net/whale_request_decision_cache.h"
 
 // Owns proxying factories for URLLoaders and websocket proxies. There is
 // one |ResourceContextData| per profile.
-class ResourceContextData : public base::SupportsUserData::Data {
+class ResourceContextData : public base::SupportsUserData::Data,
+                            public base::trace_event::MemoryDumpProvider {
  public:
   ResourceContextData(const ResourceContextData&) = delete;
   ResourceContextData& operator=(const ResourceContextData&) = delete;
@@ -35,16 +41,43 @@ class ResourceContextData : public base::SupportsUserData::Data {
       int render_process_id,
       int frame_tree_node_id,
       mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver,
-      mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory);
+      mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory,
+      mojo::PendingReceiver<network::mojom::TrustedURLLoaderHeaderClient>
+          header_client_receiver,
+      bool url_rewrite_in_network_service);
+
+  // Returns null if nothing has been proxied for |browser_context| yet.
+  static WhaleRequestDecisionCache* GetDecisionCache(
+      content::BrowserContext* browser_context);
+
+  // Returns null if nothing has been proxied for |browser_context| yet.
+  static whale_blocker::TrackingBlockerRulesPublisher* GetRulesPublisher(
+      content::BrowserContext* browser_context);
+
+  // Creates the ResourceContextData of |browser_context| if needed, since
+  // network service factories are set up without proxying anything.
+  static whale_blocker::URLRewriteSettingsPublisher*
+  GetURLRewriteSettingsPublisher(content::BrowserContext* browser_context);
 
   void RemoveProxy(WhaleProxyingURLLoaderFactory* proxy);
   uint64_t next_request_id() { return ++request_id_; }
 
+  // base::trace_event::MemoryDumpProvider:
+  bool OnMemoryDump(const base::trace_event::MemoryDumpArgs& args,
+                    base::trace_event::ProcessMemoryDump* pmd) override;
+
  private:
-  ResourceContextData();
+  explicit ResourceContextData(content::BrowserContext* browser_context);
+
+  static ResourceContextData* GetOrCreate(
+      content::BrowserContext* browser_context);
 
   uint64_t request_id_ = 0;
 
+  WhaleRequestDecisionCache decision_cache_;
+  whale_blocker::TrackingBlockerRulesPublisher rules_publisher_;
+  whale_blocker::URLRewriteSettingsPublisher url_rewrite_settings_publisher_;
+
   std::set<std::unique_ptr<WhaleProxyingURLLoaderFactory>,
            base::UniquePtrComparator>
       proxies_;
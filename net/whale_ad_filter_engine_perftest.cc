@@ -0,0 +1,241 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/ad_filter_engine.h"
+
+// Measures AdFilterEngine build, load and match cost. By default a synthetic
+// list and request corpus are generated; real ones can be passed with
+//   --ad-filter-list=<ABP/uBO list>
+//   --ad-filter-corpus=<file with "url source_host type" per line>
+// where type is one of script, image, stylesheet, xhr, subdocument or other.
+
+namespace {
+
+using whale_blocker::AdFilterEngine;
+
+constexpr char kMetricPrefix[] = "WhaleAdFilterEngine.";
+constexpr char kMetricBuildTime[] = "build_time";
+constexpr char kMetricLoadTime[] = "load_time";
+constexpr char kMetricSerializedSize[] = "serialized_size";
+// Percentiles of the per-request average of each batch, not of single
+// matches; a slow outlier is diluted by its batch.
+constexpr char kMetricMedianBatchMatch[] = "median_batch_match_time";
+constexpr char kMetricP99BatchMatch[] = "p99_batch_match_time";
+constexpr char kMetricBlockedRatio[] = "blocked_ratio";
+
+constexpr char kListSwitch[] = "ad-filter-list";
+constexpr char kCorpusSwitch[] = "ad-filter-corpus";
+
+// Requests timed together; a single match is too short for TimeTicks.
+constexpr size_t kBatchSize = 64;
+
+struct CorpusEntry {
+  GURL url;
+  std::string source_host;
+  AdFilterEngine::ResourceType type;
+  bool third_party;
+};
+
+AdFilterEngine::ResourceType ParseType(base::StringPiece type) {
+  if (type == "script") {
+    return AdFilterEngine::kScript;
+  }
+  if (type == "image") {
+    return AdFilterEngine::kImage;
+  }
+  if (type == "stylesheet") {
+    return AdFilterEngine::kStylesheet;
+  }
+  if (type == "xhr") {
+    return AdFilterEngine::kXmlHttpRequest;
+  }
+  if (type == "subdocument") {
+    return AdFilterEngine::kSubdocument;
+  }
+  return AdFilterEngine::kOther;
+}
+
+std::string RandomLabel(size_t length) {
+  std::string label;
+  for (size_t i = 0; i < length; ++i) {
+    label.push_back('a' + base::RandInt(0, 25));
+  }
+  return label;
+}
+
+std::vector<std::string> GenerateList(size_t count) {
+  std::vector<std::string> lines;
+  lines.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const std::string host =
+        RandomLabel(base::RandInt(4, 10)) + "." + RandomLabel(3) + ".com";
+    switch (i % 8) {
+      case 0:
+      case 1:
+      case 2:
+        lines.push_back("||" + host + "^");
+        break;
+      case 3:
+        lines.push_back("||" + host + "^$third-party");
+        break;
+      case 4:
+        lines.push_back("/" + RandomLabel(6) + "/*/" + RandomLabel(5) + "^");
+        break;
+      case 5:
+        lines.push_back("-" + RandomLabel(7) + ".js$script");
+        break;
+      case 6:
+        lines.push_back("||" + host + "/" + RandomLabel(5) +
+                        "$domain=" + RandomLabel(6) + ".net");
+        break;
+      case 7:
+        lines.push_back("@@||" + host + "/" + RandomLabel(4) + "/");
+        break;
+    }
+  }
+  return lines;
+}
+
+std::vector<CorpusEntry> GenerateCorpus(const std::vector<std::string>& list,
+                                        size_t count) {
+  std::vector<CorpusEntry> corpus;
+  corpus.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::string host;
+    // Roughly one in ten requests goes to a listed host.
+    if (i % 10 == 0) {
+      const std::string& line = list[base::RandInt(0, list.size() - 1)];
+      if (base::StartsWith(line, "||")) {
+        host = line.substr(2, line.find_first_of("^/$") - 2);
+      }
+    }
+    if (host.empty()) {
+      host = "cdn" + base::NumberToString(i % 50) + "." + RandomLabel(8) +
+             ".com";
+    }
+    const GURL url(base::StringPrintf(
+        "https://%s/%s/%s.js?v=%d&id=%s", host.c_str(),
+        RandomLabel(6).c_str(), RandomLabel(8).c_str(),
+        base::RandInt(0, 1000), RandomLabel(12).c_str()));
+    corpus.push_back({url, "www.news" + base::NumberToString(i % 20) + ".com",
+                      i % 3 ? AdFilterEngine::kImage : AdFilterEngine::kScript,
+                      true});
+  }
+  return corpus;
+}
+
+std::vector<CorpusEntry> ReadCorpus(const base::FilePath& path) {
+  std::string contents;
+  CHECK(base::ReadFileToString(path, &contents)) << path;
+  std::vector<CorpusEntry> corpus;
+  for (base::StringPiece line : base::SplitStringPiece(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    std::vector<std::string> fields = base::SplitString(
+        line, " \t", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    if (fields.size() < 3) {
+      continue;
+    }
+    GURL url(fields[0]);
+    const bool third_party =
+        url.host_piece() != fields[1] &&
+        !base::EndsWith(url.host_piece(), "." + fields[1]);
+    corpus.push_back(
+        {std::move(url), fields[1], ParseType(fields[2]), third_party});
+  }
+  return corpus;
+}
+
+class WhaleAdFilterEnginePerfTest : public testing::Test {
+ protected:
+  void RunTest(const std::string& story,
+               size_t rule_count,
+               size_t request_count) {
+    const auto* command_line = base::CommandLine::ForCurrentProcess();
+    std::vector<std::string> list;
+    if (command_line->HasSwitch(kListSwitch)) {
+      std::string contents;
+      ASSERT_TRUE(base::ReadFileToString(
+          command_line->GetSwitchValuePath(kListSwitch), &contents));
+      list = base::SplitString(contents, "\n", base::TRIM_WHITESPACE,
+                               base::SPLIT_WANT_NONEMPTY);
+    } else {
+      list = GenerateList(rule_count);
+    }
+    const std::vector<CorpusEntry> corpus =
+        command_line->HasSwitch(kCorpusSwitch)
+            ? ReadCorpus(command_line->GetSwitchValuePath(kCorpusSwitch))
+            : GenerateCorpus(list, request_count);
+    ASSERT_FALSE(corpus.empty());
+
+    base::TimeTicks start = base::TimeTicks::Now();
+    const std::vector<uint8_t> data = AdFilterEngine::Build(list);
+    const base::TimeDelta build_time = base::TimeTicks::Now() - start;
+
+    start = base::TimeTicks::Now();
+    auto engine = AdFilterEngine::CreateFromBuffer(data);
+    const base::TimeDelta load_time = base::TimeTicks::Now() - start;
+    ASSERT_TRUE(engine);
+
+    std::vector<double> batch_times_ns;
+    size_t blocked = 0;
+    for (size_t i = 0; i < corpus.size(); i += kBatchSize) {
+      const size_t end = std::min(corpus.size(), i + kBatchSize);
+      start = base::TimeTicks::Now();
+      for (size_t j = i; j < end; ++j) {
+        const CorpusEntry& entry = corpus[j];
+        if (engine->Match(entry.url, entry.source_host, entry.type,
+                          entry.third_party) ==
+            AdFilterEngine::Decision::kBlock) {
+          ++blocked;
+        }
+      }
+      batch_times_ns.push_back(
+          (base::TimeTicks::Now() - start).InNanosecondsF() / (end - i));
+    }
+    std::sort(batch_times_ns.begin(), batch_times_ns.end());
+
+    perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+    reporter.RegisterImportantMetric(kMetricBuildTime, "ms");
+    reporter.RegisterImportantMetric(kMetricLoadTime, "ms");
+    reporter.RegisterImportantMetric(kMetricSerializedSize, "bytes");
+    reporter.RegisterImportantMetric(kMetricMedianBatchMatch, "ns");
+    reporter.RegisterImportantMetric(kMetricP99BatchMatch, "ns");
+    reporter.RegisterImportantMetric(kMetricBlockedRatio, "%");
+    reporter.AddResult(kMetricBuildTime, build_time.InMillisecondsF());
+    reporter.AddResult(kMetricLoadTime, load_time.InMillisecondsF());
+    reporter.AddResult(kMetricSerializedSize, data.size());
+    reporter.AddResult(kMetricMedianBatchMatch,
+                       batch_times_ns[batch_times_ns.size() / 2]);
+    reporter.AddResult(kMetricP99BatchMatch,
+                       batch_times_ns[batch_times_ns.size() * 99 / 100]);
+    reporter.AddResult(kMetricBlockedRatio, 100.0 * blocked / corpus.size());
+  }
+};
+
+}  // namespace
+
+TEST_F(WhaleAdFilterEnginePerfTest, Rules10k) {
+  RunTest("rules_10k", 10000, 100000);
+}
+
+TEST_F(WhaleAdFilterEnginePerfTest, Rules100k) {
+  RunTest("rules_100k", 100000, 100000);
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/ad_filter_engine.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+using whale_blocker::AdFilterEngine;
+
+TEST(WhaleAdFilterEngine, Matches) {
+  size_t rejected = 0;
+  auto engine = AdFilterEngine::CreateFromBuffer(AdFilterEngine::Build(
+      {"! comment", "example.com##.banner", "||ads.example.net^",
+       "/banner/*/img^", "|https://cdn.test/ad.js|", "-pixel.gif$image",
+       "||track.example.org^$third-party,~script",
+       "||widget.example.org^$domain=news.test|~sub.news.test",
+       "@@||ads.example.net/allowed/", "/popunder$unknown-option"},
+      &rejected));
+  ASSERT_TRUE(engine);
+  EXPECT_EQ(1u, rejected);
+
+  auto match = [&engine](const char* url, const char* source_host,
+                         AdFilterEngine::ResourceType type, bool third_party) {
+    return engine->Match(GURL(url), source_host, type, third_party);
+  };
+  constexpr auto kBlock = AdFilterEngine::Decision::kBlock;
+  constexpr auto kAllow = AdFilterEngine::Decision::kAllow;
+  constexpr auto kNoMatch = AdFilterEngine::Decision::kNoMatch;
+
+  // Host anchors match the host and its subdomains only.
+  EXPECT_EQ(kBlock, match("https://ads.example.net/x.js", "a.test",
+                          AdFilterEngine::kScript, true));
+  EXPECT_EQ(kBlock, match("https://eu.ads.example.net/x.js", "a.test",
+                          AdFilterEngine::kScript, true));
+  EXPECT_EQ(kNoMatch, match("https://badads.example.net/x.js", "a.test",
+                            AdFilterEngine::kScript, true));
+
+  // Exceptions override blocking filters.
+  EXPECT_EQ(kAllow, match("https://ads.example.net/allowed/x.js", "a.test",
+                          AdFilterEngine::kScript, true));
+
+  // Wildcards and separators.
+  EXPECT_EQ(kBlock, match("https://a.test/banner/300x250/img?x=1", "a.test",
+                          AdFilterEngine::kImage, false));
+  EXPECT_EQ(kNoMatch, match("https://a.test/banner/300x250/img.png", "a.test",
+                            AdFilterEngine::kImage, false));
+
+  // Start and end anchors.
+  EXPECT_EQ(kBlock, match("https://cdn.test/ad.js", "a.test",
+                          AdFilterEngine::kScript, true));
+  EXPECT_EQ(kNoMatch, match("https://cdn.test/ad.js?v=2", "a.test",
+                            AdFilterEngine::kScript, true));
+
+  // Resource type options.
+  EXPECT_EQ(kBlock, match("https://a.test/t-pixel.gif", "a.test",
+                          AdFilterEngine::kImage, false));
+  EXPECT_EQ(kNoMatch, match("https://a.test/t-pixel.gif", "a.test",
+                            AdFilterEngine::kXmlHttpRequest, false));
+
+  // Party options.
+  EXPECT_EQ(kBlock, match("https://track.example.org/c", "a.test",
+                          AdFilterEngine::kImage, true));
+  EXPECT_EQ(kNoMatch, match("https://track.example.org/c", "example.org",
+                            AdFilterEngine::kImage, false));
+  EXPECT_EQ(kNoMatch, match("https://track.example.org/c", "a.test",
+                            AdFilterEngine::kScript, true));
+
+  // $domain= applies to the source document's host.
+  EXPECT_EQ(kBlock, match("https://widget.example.org/w", "www.news.test",
+                          AdFilterEngine::kSubdocument, true));
+  EXPECT_EQ(kNoMatch, match("https://widget.example.org/w", "sub.news.test",
+                            AdFilterEngine::kSubdocument, true));
+  EXPECT_EQ(kNoMatch, match("https://widget.example.org/w", "other.test",
+                            AdFilterEngine::kSubdocument, true));
+
+  // Blocking filters with unknown options are dropped, not applied more
+  // broadly.
+  EXPECT_EQ(kNoMatch, match("https://a.test/popunder", "a.test",
+                            AdFilterEngine::kScript, false));
+}
+
+TEST(WhaleAdFilterEngine, ExceptionsIgnoreUnknownOptions) {
+  size_t rejected = 0;
+  auto engine = AdFilterEngine::CreateFromBuffer(AdFilterEngine::Build(
+      {"||ads.example.net^", "@@||ads.example.net/player/$unknown-option",
+       "@@||ads.example.net/embed/$script,unknown-option"},
+      &rejected));
+  ASSERT_TRUE(engine);
+  EXPECT_EQ(0u, rejected);
+
+  // The exceptions apply as if the unknown option weren't there, so they
+  // never unblock less than the list asked for.
+  EXPECT_EQ(AdFilterEngine::Decision::kAllow,
+            engine->Match(GURL("https://ads.example.net/player/p.js"),
+                          "a.test", AdFilterEngine::kScript, true));
+  EXPECT_EQ(AdFilterEngine::Decision::kAllow,
+            engine->Match(GURL("https://ads.example.net/embed/e.js"),
+                          "a.test", AdFilterEngine::kScript, true));
+  // Known options still narrow them.
+  EXPECT_EQ(AdFilterEngine::Decision::kBlock,
+            engine->Match(GURL("https://ads.example.net/embed/e.png"),
+                          "a.test", AdFilterEngine::kImage, true));
+}
@@ -0,0 +1,195 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/net/whale_block_event_queue.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "base/containers/flat_map.h"
+#include "base/functional/bind.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/no_destructor.h"
+#include "content/public/browser/browser_task_traits.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/browser/web_contents.h"
+
+namespace {
+
+constexpr size_t kQueueCapacity = 1024;
+
+// Upper bound on events handled by one drain task, so that a flood can't
+// monopolize the consumer sequence; the rest is left for the next task.
+constexpr size_t kMaxEventsPerDrain = 4096;
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+void DispatchToShieldsDataControllers(
+    std::vector<WhaleBlockEventQueue::Event> events) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  base::flat_map<int, whale::WhaleShieldsDataController*> controllers;
+  base::flat_map<whale::WhaleShieldsDataController*, std::vector<std::string>>
+      url_params;
+  for (auto& event : events) {
+    auto it = controllers.find(event.frame_tree_node_id);
+    if (it == controllers.end()) {
+      content::WebContents* web_contents =
+          content::WebContents::FromFrameTreeNodeId(event.frame_tree_node_id);
+      // Can be null if the |web_contents| is generated in component layer -
+      // We don't attach any tab helpers in this case.
+      it = controllers
+               .emplace(event.frame_tree_node_id,
+                        web_contents
+                            ? whale::WhaleShieldsDataController::
+                                  FromWebContents(web_contents)
+                            : nullptr)
+               .first;
+    }
+    whale::WhaleShieldsDataController* controller = it->second;
+    // The frame tree node can outlive the document the event was queued
+    // for; don't report blocks of a page that was navigated away from.
+    if (!controller || (event.navigation_id &&
+                        event.navigation_id < controller->navigation_id())) {
+      continue;
+    }
+    if (event.block_type == BlockType::URLParams) {
+      url_params[controller].push_back(std::move(event.value));
+    } else {
+      controller->HandleItemBlocked(event.block_type, event.value);
+    }
+  }
+  for (const auto& [controller, params] : url_params) {
+    controller->HandleURLParamsBlocked(params);
+  }
+}
+
+}  // namespace
+
+// static
+WhaleBlockEventQueue* WhaleBlockEventQueue::GetInstance() {
+  static base::NoDestructor<WhaleBlockEventQueue> instance(
+      kQueueCapacity, content::GetUIThreadTaskRunner({}),
+      base::BindRepeating(&DispatchToShieldsDataControllers));
+  return instance.get();
+}
+
+WhaleBlockEventQueue::WhaleBlockEventQueue(
+    size_t capacity,
+    scoped_refptr<base::SequencedTaskRunner> task_runner,
+    DrainCallback callback)
+    : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+      cells_(new Cell[mask_ + 1]),
+      task_runner_(std::move(task_runner)),
+      callback_(std::move(callback)) {
+  for (size_t i = 0; i <= mask_; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+WhaleBlockEventQueue::~WhaleBlockEventQueue() = default;
+
+void WhaleBlockEventQueue::Push(Event event) {
+  if (overflowing_.load(std::memory_order_acquire) || !TryEnqueue(event)) {
+    base::AutoLock lock(overflow_lock_);
+    // Only use the ring again once the drain has taken the overflow, or
+    // this event would overtake the ones queued there.
+    if (overflowing_.load(std::memory_order_relaxed) || !TryEnqueue(event)) {
+      UMA_HISTOGRAM_BOOLEAN("Whale.ITP.BlockEventQueue.Overflow", true);
+      overflow_.push_back(std::move(event));
+      overflowing_.store(true, std::memory_order_release);
+    }
+  }
+  ScheduleDrain();
+}
+
+void WhaleBlockEventQueue::ScheduleDrain() {
+  if (!drain_scheduled_.exchange(true, std::memory_order_acq_rel)) {
+    task_runner_->PostTask(FROM_HERE,
+                           base::BindOnce(&WhaleBlockEventQueue::Drain,
+                                          base::Unretained(this)));
+  }
+}
+
+bool WhaleBlockEventQueue::TryEnqueue(Event& event) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Cell& cell = cells_[pos & mask_];
+    const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    const intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        cell.event = std::move(event);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // Full.
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool WhaleBlockEventQueue::TryDequeue(Event* event) {
+  size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Cell& cell = cells_[pos & mask_];
+    const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    const intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        *event = std::move(cell.event);
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // Empty.
+      return false;
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void WhaleBlockEventQueue::Drain() {
+  // Cleared before dequeuing: a producer that enqueues after this point
+  // either gets picked up below or schedules the next drain.
+  drain_scheduled_.exchange(false, std::memory_order_acq_rel);
+
+  std::vector<Event> events;
+  Event event;
+  while (events.size() < kMaxEventsPerDrain && TryDequeue(&event)) {
+    events.push_back(std::move(event));
+  }
+  if (events.size() == kMaxEventsPerDrain) {
+    ScheduleDrain();
+  } else if (overflowing_.load(std::memory_order_acquire)) {
+    base::AutoLock lock(overflow_lock_);
+    // Events published to the ring before their producer overflowed are
+    // visible now; take them first to keep each producer's order.
+    while (TryDequeue(&event)) {
+      events.push_back(std::move(event));
+    }
+    std::move(overflow_.begin(), overflow_.end(), std::back_inserter(events));
+    overflow_.clear();
+    overflowing_.store(false, std::memory_order_release);
+  }
+  UMA_HISTOGRAM_COUNTS_10000("Whale.ITP.BlockEventQueue.DrainSize",
+                             events.size());
+  if (!events.empty()) {
+    callback_.Run(std::move(events));
+  }
+}
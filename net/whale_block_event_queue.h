@@ -0,0 +1,87 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_WHALE_BROWSER_NET_WHALE_BLOCK_EVENT_QUEUE_H_
+#define WHALE_WHALE_BROWSER_NET_WHALE_BLOCK_EVENT_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/synchronization/lock.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/thread_annotations.h"
+#include "whale/whale/browser/ui/whale_shields_data_controller.h"
+
+// Carries block events from the network stage and the filter engines to
+// WhaleShieldsDataController. Producers on any thread append to a bounded
+// lock-free ring (Vyukov's MPMC queue, used here with a single consumer)
+// and only the producer that finds the ring idle posts a drain task, so a
+// burst of blocks costs one task on the consumer sequence instead of one
+// per event. Once the ring is full, events go to a locked overflow list
+// until a drain empties the ring and takes the list behind it, so that
+// each producer's events are still delivered in push order.
+class WhaleBlockEventQueue {
+ public:
+  struct Event {
+    int frame_tree_node_id = 0;
+    // WhaleShieldsDataController::navigation_id() the event belongs to, or 0
+    // for the current document. Events of an older navigation are dropped.
+    int64_t navigation_id = 0;
+    BlockType block_type = BlockType::Ads;
+    // Blocked URL, or removed parameter name for BlockType::URLParams.
+    std::string value;
+  };
+
+  using DrainCallback = base::RepeatingCallback<void(std::vector<Event>)>;
+
+  // Delivers events to the shields controllers on the UI thread.
+  static WhaleBlockEventQueue* GetInstance();
+
+  // |capacity| is rounded up to a power of two. |callback| runs on
+  // |task_runner| with the events in push order per producer. Must outlive
+  // the tasks it posts.
+  WhaleBlockEventQueue(size_t capacity,
+                       scoped_refptr<base::SequencedTaskRunner> task_runner,
+                       DrainCallback callback);
+  WhaleBlockEventQueue(const WhaleBlockEventQueue&) = delete;
+  WhaleBlockEventQueue& operator=(const WhaleBlockEventQueue&) = delete;
+  ~WhaleBlockEventQueue();
+
+  // May be called on any thread.
+  void Push(Event event);
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    Event event;
+  };
+
+  bool TryEnqueue(Event& event);
+  bool TryDequeue(Event* event);
+  void ScheduleDrain();
+  void Drain();
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+  alignas(64) std::atomic<bool> drain_scheduled_{false};
+
+  // Set while |overflow_| may be non-empty; producers then skip the ring.
+  std::atomic<bool> overflowing_{false};
+  base::Lock overflow_lock_;
+  std::vector<Event> overflow_ GUARDED_BY(overflow_lock_);
+
+  const scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  const DrainCallback callback_;
+};
+
+#endif  // WHALE_WHALE_BROWSER_NET_WHALE_BLOCK_EVENT_QUEUE_H_
@@ -0,0 +1,91 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/net/whale_block_event_queue.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/test/bind.h"
+#include "base/test/task_environment.h"
+#include "base/threading/thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+TEST(WhaleBlockEventQueue, DrainsInBulk) {
+  base::test::TaskEnvironment task_environment;
+  size_t drain_count = 0;
+  std::vector<std::string> values;
+  WhaleBlockEventQueue queue(
+      16, base::SequencedTaskRunner::GetCurrentDefault(),
+      base::BindLambdaForTesting(
+          [&](std::vector<WhaleBlockEventQueue::Event> events) {
+            ++drain_count;
+            for (auto& event : events) {
+              values.push_back(std::move(event.value));
+            }
+          }));
+
+  // Producers on several threads; the ring overflows on purpose.
+  constexpr int kThreads = 4;
+  constexpr int kEventsPerThread = 50;
+  std::vector<std::unique_ptr<base::Thread>> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.push_back(
+        std::make_unique<base::Thread>("producer" + base::NumberToString(i)));
+    ASSERT_TRUE(threads.back()->Start());
+    threads.back()->task_runner()->PostTask(
+        FROM_HERE, base::BindLambdaForTesting([&queue, i] {
+          for (int j = 0; j < kEventsPerThread; ++j) {
+            queue.Push({1, 0, BlockType::Trackers,
+                        base::NumberToString(i * kEventsPerThread + j)});
+          }
+        }));
+  }
+  for (auto& thread : threads) {
+    thread->FlushForTesting();
+  }
+  task_environment.RunUntilIdle();
+
+  EXPECT_EQ(size_t{kThreads * kEventsPerThread}, values.size());
+  EXPECT_LT(drain_count, values.size());
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(values.end(), std::unique(values.begin(), values.end()));
+
+  // A single burst on the consumer's own sequence costs one drain.
+  drain_count = 0;
+  for (int i = 0; i < 10; ++i) {
+    queue.Push({1, 0, BlockType::Ads, "ad"});
+  }
+  task_environment.RunUntilIdle();
+  EXPECT_EQ(1u, drain_count);
+}
+
+TEST(WhaleBlockEventQueue, KeepsOrderOnOverflow) {
+  base::test::TaskEnvironment task_environment;
+  std::vector<std::string> values;
+  WhaleBlockEventQueue queue(
+      2, base::SequencedTaskRunner::GetCurrentDefault(),
+      base::BindLambdaForTesting(
+          [&](std::vector<WhaleBlockEventQueue::Event> events) {
+            for (auto& event : events) {
+              values.push_back(std::move(event.value));
+            }
+          }));
+
+  // Events past the ring's capacity queue up behind it, and the ring isn't
+  // used again until they are delivered.
+  for (int i = 0; i < 5; ++i) {
+    queue.Push({1, 0, BlockType::Trackers, base::NumberToString(i)});
+  }
+  task_environment.RunUntilIdle();
+  queue.Push({1, 0, BlockType::Trackers, "5"});
+  task_environment.RunUntilIdle();
+
+  EXPECT_EQ(std::vector<std::string>({"0", "1", "2", "3", "4", "5"}), values);
+}
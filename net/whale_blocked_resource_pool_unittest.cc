@@ -0,0 +1,107 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_blocked_resource_pool.h"
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "content/public/test/browser_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+TEST(WhaleBlockedResourceList, IsBounded) {
+  content::BrowserTaskEnvironment task_environment;
+  whale::WhaleBlockedResourcePool pool;
+  whale::WhaleBlockedResourceList tab1(&pool, 2);
+  whale::WhaleBlockedResourceList tab2(&pool, 2);
+
+  EXPECT_TRUE(tab1.Insert("https://t.com/a.js"));
+  EXPECT_FALSE(tab1.Insert("https://t.com/a.js"));
+  EXPECT_TRUE(tab1.Insert("https://t.com/b.js"));
+  // Past the cap values are counted but not stored.
+  EXPECT_TRUE(tab1.Insert("https://t.com/c.js"));
+  EXPECT_FALSE(tab1.Insert("https://t.com/c.js"));
+  EXPECT_FALSE(tab1.Insert("https://t.com/a.js"));
+  EXPECT_EQ(3u, tab1.count());
+  EXPECT_EQ(2u, tab1.stored_count());
+  EXPECT_EQ(std::vector<std::string>({"https://t.com/a.js",
+                                      "https://t.com/b.js"}),
+            tab1.GetValues());
+
+  // Tabs share the pooled strings.
+  EXPECT_TRUE(tab2.Insert("https://t.com/a.js"));
+  EXPECT_EQ(2u, pool.size());
+
+  tab1.Clear();
+  EXPECT_EQ(0u, tab1.count());
+  EXPECT_EQ(1u, pool.size());
+  tab2.Clear();
+  EXPECT_EQ(0u, pool.size());
+}
+
+TEST(WhaleBlockedResourceList, OverflowIsBounded) {
+  content::BrowserTaskEnvironment task_environment;
+  whale::WhaleBlockedResourcePool pool;
+  whale::WhaleBlockedResourceList list(&pool, 1);
+  const size_t max_hashes = whale::WhaleBlockedResourceList::kMaxOverflowHashes;
+
+  EXPECT_TRUE(list.Insert("https://t.com/stored.js"));
+  for (size_t i = 0; i < max_hashes; ++i) {
+    EXPECT_TRUE(list.Insert("https://t.com/" + base::NumberToString(i)));
+  }
+  EXPECT_EQ(max_hashes + 1, list.count());
+  // Still recognized.
+  EXPECT_FALSE(list.Insert("https://t.com/0"));
+
+  // Past the bound values are counted every time.
+  EXPECT_TRUE(list.Insert("https://t.com/late.js"));
+  EXPECT_TRUE(list.Insert("https://t.com/late.js"));
+  EXPECT_EQ(max_hashes + 3, list.count());
+  EXPECT_EQ(1u, list.stored_count());
+
+  list.Clear();
+  EXPECT_EQ(0u, list.count());
+}
+
+TEST(WhaleBlockedResourceList, ReadSince) {
+  content::BrowserTaskEnvironment task_environment;
+  whale::WhaleBlockedResourcePool pool;
+  whale::WhaleBlockedResourceList list(&pool, 3);
+  whale::WhaleBlockedResourceList::Cursor cursor;
+  std::vector<base::StringPiece> values;
+
+  // A new cursor reads everything.
+  list.Insert("https://t.com/b.js");
+  EXPECT_FALSE(list.ReadSince(&cursor, &values));
+  EXPECT_EQ(std::vector<base::StringPiece>({"https://t.com/b.js"}), values);
+
+  // Then only what was added since, in insertion order.
+  values.clear();
+  list.Insert("https://t.com/c.js");
+  list.Insert("https://t.com/a.js");
+  list.Insert("https://t.com/b.js");
+  EXPECT_TRUE(list.ReadSince(&cursor, &values));
+  EXPECT_EQ(std::vector<base::StringPiece>(
+                {"https://t.com/c.js", "https://t.com/a.js"}),
+            values);
+  values.clear();
+  EXPECT_TRUE(list.ReadSince(&cursor, &values));
+  EXPECT_TRUE(values.empty());
+
+  // Values past the cap are counted only.
+  list.Insert("https://t.com/d.js");
+  EXPECT_TRUE(list.ReadSince(&cursor, &values));
+  EXPECT_TRUE(values.empty());
+
+  // A cursor taken before Clear() is stale even once the list has grown
+  // back past its position.
+  list.Clear();
+  list.Insert("https://t.com/e.js");
+  list.Insert("https://t.com/f.js");
+  list.Insert("https://t.com/g.js");
+  EXPECT_FALSE(list.ReadSince(&cursor, &values));
+  EXPECT_EQ(3u, values.size());
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_blocking_stats_store.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/run_loop.h"
+#include "base/task/thread_pool.h"
+#include "base/test/bind.h"
+#include "base/test/task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+TEST(WhaleBlockingStatsStore, SurvivesRestart) {
+  using whale::WhaleBlockingStatsStore;
+  base::test::TaskEnvironment task_environment(
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME);
+  base::ScopedTempDir profile_dir;
+  ASSERT_TRUE(profile_dir.CreateUniqueTempDir());
+  auto create_store = [&] {
+    return std::make_unique<WhaleBlockingStatsStore>(
+        profile_dir.GetPath(),
+        base::ThreadPool::CreateSequencedTaskRunner({base::MayBlock()}));
+  };
+  auto get_stats = [](WhaleBlockingStatsStore* store) {
+    std::vector<WhaleBlockingStatsStore::DailyStats> stats;
+    base::RunLoop run_loop;
+    store->GetDailyStats(base::BindLambdaForTesting(
+        [&](std::vector<WhaleBlockingStatsStore::DailyStats> result) {
+          stats = std::move(result);
+          run_loop.Quit();
+        }));
+    run_loop.Run();
+    return stats;
+  };
+
+  const int32_t first_day = WhaleBlockingStatsStore::GetDay(base::Time::Now());
+  auto store = create_store();
+  store->RecordBlocked(BlockType::Ads);
+  store->RecordBlocked(BlockType::Trackers, 2);
+  task_environment.FastForwardBy(WhaleBlockingStatsStore::kFlushDelay);
+  // Pending counts are written on destruction.
+  store->RecordBlocked(BlockType::URLParams);
+  store.reset();
+  task_environment.RunUntilIdle();
+
+  // A record torn by a crash is dropped.
+  ASSERT_TRUE(base::AppendToFile(profile_dir.GetPath().Append(FILE_PATH_LITERAL(
+                                     "Whale Blocking Stats Log")),
+                                 "torn"));
+
+  store = create_store();
+  auto stats = get_stats(store.get());
+  ASSERT_EQ(1u, stats.size());
+  EXPECT_EQ(first_day, stats[0].day);
+  EXPECT_EQ(1u, stats[0].ads);
+  EXPECT_EQ(2u, stats[0].trackers);
+  EXPECT_EQ(1u, stats[0].url_params);
+
+  // The next day folds the log into the aggregates.
+  task_environment.FastForwardBy(base::Days(1));
+  store->RecordBlocked(BlockType::Ads, 3);
+  stats = get_stats(store.get());
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_GT(stats[1].day, first_day);
+  EXPECT_EQ(3u, stats[1].ads);
+  EXPECT_TRUE(base::PathExists(
+      profile_dir.GetPath().Append(FILE_PATH_LITERAL("Whale Blocking Stats"))));
+
+  store.reset();
+  task_environment.RunUntilIdle();
+  store = create_store();
+  stats = get_stats(store.get());
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ(1u, stats[0].ads);
+  EXPECT_EQ(2u, stats[0].trackers);
+  EXPECT_EQ(3u, stats[1].ads);
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/exemption_table.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+TEST(WhaleExemptionTable, IsExempt) {
+  using whale_blocker::ExemptionFeature;
+  auto table = whale_blocker::ExemptionTable::CreateFromString(
+      "# partners\n"
+      "query-filter naver.com\n"
+      "query-filter partner.example\n"
+      "referrer naver.com\n"
+      "unknown-feature other.example\n");
+  ASSERT_TRUE(table);
+
+  EXPECT_TRUE(table->IsExempt(ExemptionFeature::kQueryFilter,
+                              GURL("https://n.news.naver.com/article")));
+  EXPECT_TRUE(table->IsExempt(ExemptionFeature::kQueryFilter,
+                              GURL("https://partner.example./")));
+  EXPECT_FALSE(table->IsExempt(ExemptionFeature::kQueryFilter,
+                               GURL("https://notnaver.com/")));
+  EXPECT_FALSE(table->IsExempt(ExemptionFeature::kReferrer,
+                               GURL("https://partner.example/")));
+  EXPECT_FALSE(table->IsExempt(ExemptionFeature::kBlocking,
+                               GURL("https://naver.com/")));
+  EXPECT_FALSE(table->IsExempt(ExemptionFeature::kQueryFilter,
+                               GURL("https://other.example/")));
+
+  // The built-in table keeps the existing naver.com exemptions.
+  EXPECT_TRUE(whale_blocker::IsExempt(ExemptionFeature::kQueryFilter,
+                                      GURL("https://www.naver.com/")));
+  EXPECT_TRUE(whale_blocker::IsExempt(ExemptionFeature::kReferrer,
+                                      GURL("https://www.naver.com/")));
+}
@@ -5,28 +5,69 @@
 
 #include "whale/whale/browser/net/whale_proxying_url_loader_factory.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "base/auto_reset.h"
+#include "base/feature_list.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/numerics/checked_math.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/trace_event/memory_usage_estimator.h"
 #include "content/public/browser/browser_context.h"
 #include "content/public/browser/browser_task_traits.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/render_frame_host.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/common/url_constants.h"
 #include "content/public/common/url_utils.h"
 #include "mojo/public/cpp/system/data_pipe_producer.h"
 #include "mojo/public/cpp/system/string_data_source.h"
 #include "net/base/completion_repeating_callback.h"
 #include "net/cookies/site_for_cookies.h"
-#include "net/http/http_util.h"
+#include "net/http/http_response_headers.h"
 #include "net/url_request/redirect_info.h"
 #include "net/url_request/redirect_util.h"
 #include "net/url_request/url_request.h"
 #include "services/network/public/cpp/parsed_headers.h"
 #include "services/network/public/mojom/early_hints.mojom.h"
 #include "url/origin.h"
+#include "whale/components/tracking_blockers/common/features.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
 #include "whale/whale/browser/net/resource_context_data.h"
 #include "whale/whale/browser/net/whale_site_hacks_network_delegate_helper.h"
 
 namespace {
 
+// Coalescing window for OnTransferSizeUpdated() relays. Roughly one frame, so
+// that the renderer still sees progress at display rate.
+constexpr base::TimeDelta kTransferSizeFlushInterval = base::Milliseconds(16);
+
+size_t EstimateHeadersMemoryUsage(const net::HttpRequestHeaders& headers) {
+  size_t bytes = 0;
+  for (const auto& header : headers.GetHeaderVector()) {
+    bytes += base::trace_event::EstimateMemoryUsage(header.key) +
+             base::trace_event::EstimateMemoryUsage(header.value);
+  }
+  return bytes;
+}
+
+size_t EstimateRequestMemoryUsage(const network::ResourceRequest& request) {
+  size_t bytes = base::trace_event::EstimateMemoryUsage(request.method) +
+                 request.url.EstimateMemoryUsage() +
+                 request.referrer.EstimateMemoryUsage() +
+                 EstimateHeadersMemoryUsage(request.headers) +
+                 EstimateHeadersMemoryUsage(request.cors_exempt_headers);
+  if (request.request_body) {
+    for (const auto& element : *request.request_body->elements()) {
+      if (element.type() == network::DataElement::Tag::kBytes) {
+        bytes += element.As<network::DataElementBytes>().bytes().size();
+      }
+    }
+  }
+  return bytes;
+}
+
 // Creates simulated net::RedirectInfo when an extension redirects a request,
 // behaving like a redirect response was actually returned by the remote server.
 net::RedirectInfo CreateRedirectInfo(
@@ -46,6 +87,30 @@ net::RedirectInfo CreateRedirectInfo(
       false /* is_signed_exchange_fallback_redirect */);
 }
 
+// Returns the tab origin whose settings the network service stage applies to
+// the requests of |render_frame_host|, or nullopt if the stage doesn't run
+// for them and the proxy rewrites their URLs itself.
+absl::optional<GURL> GetURLRewriteStageTabOrigin(
+    content::RenderFrameHost* render_frame_host) {
+  if (!base::FeatureList::IsEnabled(
+          whale_blocker::features::kTrackingBlockerInNetworkService) ||
+      !render_frame_host) {
+    return absl::nullopt;
+  }
+
+  content::WebContents* contents =
+      content::WebContents::FromRenderFrameHost(render_frame_host);
+  if (!contents) {
+    return absl::nullopt;
+  }
+  GURL tab_origin =
+      url::Origin::Create(contents->GetLastCommittedURL()).GetURL();
+  if (tab_origin.SchemeIs(content::kChromeExtensionScheme)) {
+    return absl::nullopt;
+  }
+  return tab_origin;
+}
+
 }  // namespace
 
 WhaleProxyingURLLoaderFactory::InProgressRequest::FollowRedirectParams::
@@ -53,6 +118,15 @@ WhaleProxyingURLLoaderFactory::InProgressRequest::FollowRedirectParams::
 WhaleProxyingURLLoaderFactory::InProgressRequest::FollowRedirectParams::
     ~FollowRedirectParams() = default;
 
+void WhaleProxyingURLLoaderFactory::InProgressRequest::FollowRedirectParams::
+    Clear() {
+  pending = false;
+  removed_headers.clear();
+  modified_headers.Clear();
+  modified_cors_exempt_headers.Clear();
+  new_url.reset();
+}
+
 WhaleProxyingURLLoaderFactory::InProgressRequest::InProgressRequest(
     WhaleProxyingURLLoaderFactory* factory,
     uint64_t request_id,
@@ -60,13 +134,14 @@ WhaleProxyingURLLoaderFactory::InProgressRequest::InProgressRequest(
     int render_process_id,
     int frame_tree_node_id,
     uint32_t options,
-    const network::ResourceRequest& request,
+    network::ResourceRequest request,
     content::BrowserContext* browser_context,
     const net::MutableNetworkTrafficAnnotationTag& traffic_annotation,
     mojo::PendingReceiver<network::mojom::URLLoader> loader_receiver,
     mojo::PendingRemote<network::mojom::URLLoaderClient> client)
-    : factory_(factory),
-      request_(request),
+    : priority_(request.priority),
+      factory_(factory),
+      request_(std::move(request)),
       request_id_(request_id),
       network_service_request_id_(network_service_request_id),
       render_process_id_(render_process_id),
@@ -88,7 +163,18 @@ WhaleProxyingURLLoaderFactory::InProgressRequest::InProgressRequest(
 WhaleProxyingURLLoaderFactory::InProgressRequest::~InProgressRequest() =
     default;
 
+size_t WhaleProxyingURLLoaderFactory::InProgressRequest::EstimateMemoryUsage()
+    const {
+  size_t bytes = sizeof(*this) + EstimateRequestMemoryUsage(request_) +
+                 redirect_url_.EstimateMemoryUsage();
+  if (ctx_) {
+    bytes += sizeof(WhaleRequestInfo) + ctx_->EstimateMemoryUsage();
+  }
+  return bytes;
+}
+
 void WhaleProxyingURLLoaderFactory::InProgressRequest::Restart() {
+  started_ = true;
   request_completed_ = false;
   start_time_ = base::TimeTicks::Now();
 
@@ -100,8 +186,20 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::Restart() {
                                    frame_tree_node_id_, request_id_,
                                    browser_context_, ctx_);
 
-  int result = OnBeforeURLRequest_SiteHacksWork(ctx_, &redirect_url_);
-  DCHECK_EQ(net::OK, result);
+  // Fail tracker and ad requests before anything reaches the network.
+  int result = OnBeforeURLRequest_BlockWork(ctx_);
+  if (result != net::OK) {
+    // Deletes |this|.
+    OnRequestError(network::URLLoaderCompletionStatus(result));
+    return;
+  }
+
+  // The network service stage strips the query and caps the referrer of
+  // such frames' requests itself.
+  if (!factory_->url_rewrite_in_network_service_) {
+    result = OnBeforeURLRequest_SiteHacksWork(ctx_, &redirect_url_);
+    DCHECK_EQ(net::OK, result);
+  }
 
   continuation.Run(net::OK);
 }
@@ -121,12 +219,15 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::FollowRedirect(
   request_.headers.MergeFrom(modified_headers);
 
   if (target_loader_.is_bound()) {
-    auto params = std::make_unique<FollowRedirectParams>();
-    params->removed_headers = removed_headers;
-    params->modified_headers = modified_headers;
-    params->modified_cors_exempt_headers = modified_cors_exempt_headers;
-    params->new_url = new_url;
-    pending_follow_redirect_params_ = std::move(params);
+    // Assigning into the existing buffers keeps their capacity from the
+    // previous hop.
+    FollowRedirectParams& params = pending_follow_redirect_params_;
+    params.pending = true;
+    params.removed_headers.assign(removed_headers.begin(),
+                                  removed_headers.end());
+    params.modified_headers = modified_headers;
+    params.modified_cors_exempt_headers = modified_cors_exempt_headers;
+    params.new_url = new_url;
   }
 
   Restart();
@@ -135,6 +236,15 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::FollowRedirect(
 void WhaleProxyingURLLoaderFactory::InProgressRequest::SetPriority(
     net::RequestPriority priority,
     int32_t intra_priority_value) {
+  if (!started_) {
+    // Still waiting for admission; reorder the queue and start with the new
+    // priority later.
+    const QueueKey old_key = queue_key();
+    priority_ = priority;
+    request_.priority = priority;
+    factory_->RequeueRequest(this, old_key);
+    return;
+  }
   if (target_loader_.is_bound()) {
     target_loader_->SetPriority(priority, intra_priority_value);
   }
@@ -161,6 +271,9 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::OnReceiveResponse(
     network::mojom::URLResponseHeadPtr head,
     mojo::ScopedDataPipeConsumerHandle body,
     absl::optional<mojo_base::BigBuffer> cached_metadata) {
+  // What is left is reading the body, which the network service paces on
+  // its own; let a queued request start.
+  factory_->ReleaseSlot(this);
   current_response_head_ = std::move(head);
   current_response_body_ = std::move(body);
   cached_metadata_ = std::move(cached_metadata);
@@ -177,8 +290,8 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::OnReceiveRedirect(
   DCHECK(ctx_);
   ctx_->internal_redirect = false;
   HandleResponseOrRedirectHeaders(
-      base::BindRepeating(&InProgressRequest::ContinueToBeforeRedirect,
-                          weak_factory_.GetWeakPtr(), redirect_info));
+      base::BindOnce(&InProgressRequest::ContinueToBeforeRedirect,
+                     weak_factory_.GetWeakPtr(), redirect_info));
 }
 
 void WhaleProxyingURLLoaderFactory::InProgressRequest::OnUploadProgress(
@@ -191,7 +304,31 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::OnUploadProgress(
 
 void WhaleProxyingURLLoaderFactory::InProgressRequest::OnTransferSizeUpdated(
     int32_t transfer_size_diff) {
-  target_client_->OnTransferSizeUpdated(transfer_size_diff);
+  int32_t pending_diff = 0;
+  if (!base::CheckAdd(pending_transfer_size_diff_, transfer_size_diff)
+           .AssignIfValid(&pending_diff)) {
+    // The sum no longer fits in the mojo field; relay what we have so far.
+    FlushTransferSizeUpdate();
+    pending_diff = transfer_size_diff;
+  }
+  pending_transfer_size_diff_ = pending_diff;
+
+  if (!transfer_size_flush_timer_.IsRunning()) {
+    transfer_size_flush_timer_.Start(
+        FROM_HERE, kTransferSizeFlushInterval,
+        base::BindOnce(&InProgressRequest::FlushTransferSizeUpdate,
+                       base::Unretained(this)));
+  }
+}
+
+void WhaleProxyingURLLoaderFactory::InProgressRequest::
+    FlushTransferSizeUpdate() {
+  transfer_size_flush_timer_.Stop();
+  if (pending_transfer_size_diff_ == 0) {
+    return;
+  }
+  target_client_->OnTransferSizeUpdated(pending_transfer_size_diff_);
+  pending_transfer_size_diff_ = 0;
 }
 
 void WhaleProxyingURLLoaderFactory::InProgressRequest::OnComplete(
@@ -204,6 +341,7 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::OnComplete(
     OnRequestError(status);
     return;
   }
+  FlushTransferSizeUpdate();
   target_client_->OnComplete(status);
 
   // Deletes |this|.
@@ -232,11 +370,6 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::
 
   network::mojom::URLResponseHeadPtr head =
       network::mojom::URLResponseHead::New();
-  std::string headers = base::StringPrintf(
-      "HTTP/1.1 %i Internal Redirect\n"
-      "Location: %s\n"
-      "Non-Authoritative-Reason: WebRequest API\n\n",
-      kInternalRedirectStatusCode, redirect_url_.spec().c_str());
 
   // Cross-origin requests need to modify the Origin header to 'null'. Since
   // CorsURLLoader sets |request_initiator| to the Origin request header in
@@ -245,20 +378,24 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::
   // Following checks implement the step 10 of "4.4. HTTP-redirect fetch",
   // https://fetch.spec.whatwg.org/#http-redirect-fetch
   if (request_.request_initiator &&
-      (!url::Origin::Create(redirect_url_)
-            .IsSameOriginWith(url::Origin::Create(request_.url)) &&
-       !request_.request_initiator->IsSameOriginWith(
-           url::Origin::Create(request_.url)))) {
+      !request_.request_initiator->IsSameOriginWith(request_.url) &&
+      !url::Origin::Create(redirect_url_).IsSameOriginWith(request_.url)) {
     // Reset the initiator to pretend tainted origin flag of the spec is set.
     request_.request_initiator = url::Origin();
   }
-  head->headers = base::MakeRefCounted<net::HttpResponseHeaders>(
-      net::HttpUtil::AssembleRawHeaders(headers));
+  // Build the headers directly instead of formatting and re-parsing a raw
+  // header block.
+  head->headers =
+      net::HttpResponseHeaders::Builder(net::HttpVersion(1, 1),
+                                        "307 Internal Redirect")
+          .AddHeader("Location", redirect_url_.spec())
+          .AddHeader("Non-Authoritative-Reason", "WebRequest API")
+          .Build();
   head->encoded_data_length = 0;
 
   current_response_head_ = std::move(head);
   ctx_->internal_redirect = true;
-  ContinueToBeforeRedirect(redirect_info, net::OK);
+  ContinueToBeforeRedirect(std::move(redirect_info), net::OK);
 }
 
 void WhaleProxyingURLLoaderFactory::InProgressRequest::
@@ -310,6 +447,17 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::ContinueToStartRequest(
     // Nothing has cancelled us up to this point, so it's now OK to
     // initiate the real network request.
     uint32_t options = options_;
+    // Only requests with an ID can be matched up in OnLoaderCreated(). Only
+    // those whose headers may be filtered go through the header client; it
+    // costs the network service a round trip per response. Server redirects
+    // are followed by the same loader, so a first-party request keeps its
+    // headers after a redirect to a third party.
+    if (network_service_request_id_ != 0 &&
+        factory_->url_loader_header_client_receiver_.is_bound() &&
+        ctx_ && ShouldFilterResponseHeaders(*ctx_)) {
+      options |= network::mojom::kURLLoadOptionUseHeaderClient;
+      factory_->network_service_requests_[network_service_request_id_] = this;
+    }
     factory_->target_factory_->CreateLoaderAndStart(
         target_loader_.BindNewPipeAndPassReceiver(),
         network_service_request_id_, options, request_,
@@ -327,33 +475,15 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::ContinueToSendHeaders(
     OnRequestError(network::URLLoaderCompletionStatus(error_code));
     return;
   }
-  const std::set<std::string>& removed_headers = ctx_->removed_headers;
-  const std::set<std::string>& set_headers = ctx_->set_headers;
-
-  if (pending_follow_redirect_params_) {
-    pending_follow_redirect_params_->removed_headers.insert(
-        pending_follow_redirect_params_->removed_headers.end(),
-        removed_headers.begin(), removed_headers.end());
-
-    for (auto& set_header : set_headers) {
-      std::string header_value;
-      if (request_.headers.GetHeader(set_header, &header_value)) {
-        pending_follow_redirect_params_->modified_headers.SetHeader(
-            set_header, header_value);
-      } else {
-        NOTREACHED();
-      }
-    }
-
+  if (pending_follow_redirect_params_.pending) {
+    FollowRedirectParams& params = pending_follow_redirect_params_;
     if (target_loader_.is_bound()) {
       target_loader_->FollowRedirect(
-          pending_follow_redirect_params_->removed_headers,
-          pending_follow_redirect_params_->modified_headers,
-          pending_follow_redirect_params_->modified_cors_exempt_headers,
-          pending_follow_redirect_params_->new_url);
+          params.removed_headers, params.modified_headers,
+          params.modified_cors_exempt_headers, params.new_url);
     }
 
-    pending_follow_redirect_params_.reset();
+    params.Clear();
   }
 
   if (proxied_client_receiver_.is_bound()) {
@@ -377,7 +507,7 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::
 }
 
 void WhaleProxyingURLLoaderFactory::InProgressRequest::ContinueToBeforeRedirect(
-    const net::RedirectInfo& redirect_info,
+    net::RedirectInfo redirect_info,
     int error_code) {
   if (error_code != net::OK) {
     OnRequestError(network::URLLoaderCompletionStatus(error_code));
@@ -389,17 +519,12 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::ContinueToBeforeRedirect(
   }
 
   if (ctx_->internal_redirect) {
-    ctx_->redirect_source = GURL();
+    ctx_->redirect_source.reset();
   } else {
-    ctx_->redirect_source = request_.url;
+    ctx_->redirect_source = url::Origin::Create(request_.url);
   }
   target_client_->OnReceiveRedirect(redirect_info,
                                     std::move(current_response_head_));
-  request_.url = redirect_info.new_url;
-  request_.method = redirect_info.new_method;
-  request_.site_for_cookies = redirect_info.new_site_for_cookies;
-  request_.referrer = GURL(redirect_info.new_referrer);
-  request_.referrer_policy = redirect_info.new_referrer_policy;
 
   if (request_.trusted_params) {
     request_.trusted_params->isolation_info =
@@ -407,6 +532,17 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::ContinueToBeforeRedirect(
             url::Origin::Create(redirect_info.new_url));
   }
 
+  // |redirect_info| is owned by this call, so its members can be moved into
+  // |request_| once it has been relayed to the client.
+  request_.url = std::move(redirect_info.new_url);
+  request_.method = std::move(redirect_info.new_method);
+  request_.site_for_cookies = std::move(redirect_info.new_site_for_cookies);
+  // Most hops keep the referrer; avoid re-parsing it in that case.
+  if (request_.referrer.possibly_invalid_spec() != redirect_info.new_referrer) {
+    request_.referrer = GURL(redirect_info.new_referrer);
+  }
+  request_.referrer_policy = redirect_info.new_referrer_policy;
+
   // The request method can be changed to "GET". In this case we need to
   // reset the request body manually.
   if (request_.method == net::HttpRequestHeaders::kGetMethod) {
@@ -420,8 +556,6 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::
     HandleResponseOrRedirectHeaders(net::CompletionOnceCallback continuation) {
   redirect_url_ = GURL();
 
-  // TODO(jwoo.park): brave has RemoveTrackableSecurityHeadersForThirdParty.
-
   auto split_once_callback = base::SplitOnceCallback(std::move(continuation));
   if (request_.url.SchemeIsHTTPOrHTTPS()) {
     ctx_ = WhaleRequestInfo::MakeCTX(request_, render_process_id_,
@@ -432,6 +566,47 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::
   std::move(split_once_callback.second).Run(net::OK);
 }
 
+void WhaleProxyingURLLoaderFactory::InProgressRequest::OnLoaderCreated(
+    mojo::PendingReceiver<network::mojom::TrustedHeaderClient> receiver) {
+  // A restarted request gets a new loader, and with it a new header client.
+  header_client_receiver_.reset();
+  header_client_receiver_.Bind(std::move(receiver));
+}
+
+void WhaleProxyingURLLoaderFactory::InProgressRequest::OnBeforeSendHeaders(
+    const net::HttpRequestHeaders& headers,
+    OnBeforeSendHeadersCallback callback) {
+  std::move(callback).Run(net::OK, absl::nullopt);
+}
+
+void WhaleProxyingURLLoaderFactory::InProgressRequest::OnHeadersReceived(
+    const std::string& headers,
+    const net::IPEndPoint& remote_endpoint,
+    OnHeadersReceivedCallback callback) {
+  // This runs before the network service acts on the headers, so stripped
+  // HSTS and the like never reach its TransportSecurityState.
+  // Most responses carry none of the stripped headers; pass those on without
+  // building a context or parsing the header block.
+  if (!request_.url.SchemeIsHTTPOrHTTPS() ||
+      !MayHaveTrackableSecurityHeaders(headers)) {
+    std::move(callback).Run(net::OK, absl::nullopt, absl::nullopt);
+    return;
+  }
+  ctx_ = WhaleRequestInfo::MakeCTX(request_, render_process_id_,
+                                   frame_tree_node_id_, request_id_,
+                                   browser_context_, ctx_);
+  auto response_headers =
+      base::MakeRefCounted<net::HttpResponseHeaders>(headers);
+  int result = OnHeadersReceived_SiteHacksWork(ctx_, response_headers.get());
+  DCHECK_EQ(net::OK, result);
+  if (response_headers->raw_headers() == headers) {
+    std::move(callback).Run(net::OK, absl::nullopt, absl::nullopt);
+    return;
+  }
+  std::move(callback).Run(net::OK, response_headers->raw_headers(),
+                          absl::nullopt);
+}
+
 void WhaleProxyingURLLoaderFactory::InProgressRequest::OnRequestError(
     const network::URLLoaderCompletionStatus& status) {
   if (!request_completed_) {
@@ -439,6 +614,7 @@ void WhaleProxyingURLLoaderFactory::InProgressRequest::OnRequestError(
     // be modified
     network::URLLoaderCompletionStatus collapse_status(status);
 
+    FlushTransferSizeUpdate();
     target_client_->OnComplete(collapse_status);
   }
 
@@ -452,12 +628,25 @@ WhaleProxyingURLLoaderFactory::WhaleProxyingURLLoaderFactory(
     int frame_tree_node_id,
     mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver,
     mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory,
+    mojo::PendingReceiver<network::mojom::TrustedURLLoaderHeaderClient>
+        header_client_receiver,
+    bool url_rewrite_in_network_service,
     uint64_t request_id,
     DisconnectCallback on_disconnect)
     : browser_context_(browser_context),
       render_process_id_(render_process_id),
       frame_tree_node_id_(frame_tree_node_id),
+      url_rewrite_in_network_service_(url_rewrite_in_network_service),
       request_id_(request_id),
+      max_active_requests_(
+          base::FeatureList::IsEnabled(
+              whale_blocker::features::kProxiedRequestAdmissionControl)
+              ? base::checked_cast<size_t>(std::max(
+                    1, whale_blocker::features::kMaxActiveProxiedRequests
+                           .Get()))
+              : std::numeric_limits<size_t>::max()),
+      max_queued_requests_(base::checked_cast<size_t>(std::max(
+          0, whale_blocker::features::kMaxQueuedProxiedRequests.Get()))),
       disconnect_callback_(std::move(on_disconnect)),
       weak_factory_(this) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
@@ -469,6 +658,10 @@ WhaleProxyingURLLoaderFactory::WhaleProxyingURLLoaderFactory(
       base::BindOnce(&WhaleProxyingURLLoaderFactory::OnTargetFactoryError,
                      base::Unretained(this)));
 
+  if (header_client_receiver) {
+    url_loader_header_client_receiver_.Bind(std::move(header_client_receiver));
+  }
+
   proxy_receivers_.Add(this, std::move(receiver));
   proxy_receivers_.set_disconnect_handler(
       base::BindRepeating(&WhaleProxyingURLLoaderFactory::OnProxyBindingError,
@@ -477,21 +670,54 @@ WhaleProxyingURLLoaderFactory::WhaleProxyingURLLoaderFactory(
 
 WhaleProxyingURLLoaderFactory::~WhaleProxyingURLLoaderFactory() = default;
 
+// static
+void WhaleProxyingURLLoaderFactory::PopulateURLRewriteSettings(
+    content::BrowserContext* browser_context,
+    content::RenderFrameHost* render_frame_host,
+    network::mojom::URLLoaderFactoryParams* factory_params) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  absl::optional<GURL> tab_origin =
+      GetURLRewriteStageTabOrigin(render_frame_host);
+  if (!tab_origin) {
+    return;
+  }
+
+  // The factory lives as long as the document, whose settings can change
+  // meanwhile; the publisher keeps its copy current.
+  mojo::PendingRemote<whale_blocker::mojom::URLRewriteSettingsObserver>
+      observer;
+  factory_params->whale_url_rewrite_settings_observer =
+      observer.InitWithNewPipeAndPassReceiver();
+  factory_params->whale_url_rewrite_settings =
+      ResourceContextData::GetURLRewriteSettingsPublisher(browser_context)
+          ->AddObserver(*tab_origin, std::move(observer));
+}
+
 // static
 bool WhaleProxyingURLLoaderFactory::MaybeProxyRequest(
     content::BrowserContext* browser_context,
     content::RenderFrameHost* render_frame_host,
     int render_process_id,
-    mojo::PendingReceiver<network::mojom::URLLoaderFactory>* factory_receiver) {
+    mojo::PendingReceiver<network::mojom::URLLoaderFactory>* factory_receiver,
+    mojo::PendingRemote<network::mojom::TrustedURLLoaderHeaderClient>*
+        header_client) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
   auto proxied_receiver = std::move(*factory_receiver);
   mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory_remote;
   *factory_receiver = target_factory_remote.InitWithNewPipeAndPassReceiver();
 
+  mojo::PendingReceiver<network::mojom::TrustedURLLoaderHeaderClient>
+      header_client_receiver;
+  if (header_client && !header_client->is_valid()) {
+    header_client_receiver = header_client->InitWithNewPipeAndPassReceiver();
+  }
+
   ResourceContextData::StartProxying(
       browser_context, render_process_id,
       render_frame_host ? render_frame_host->GetFrameTreeNodeId() : 0,
-      std::move(proxied_receiver), std::move(target_factory_remote));
+      std::move(proxied_receiver), std::move(target_factory_remote),
+      std::move(header_client_receiver),
+      GetURLRewriteStageTabOrigin(render_frame_host).has_value());
   return true;
 }
 
@@ -510,11 +736,96 @@ void WhaleProxyingURLLoaderFactory::CreateLoaderAndStart(
   // unique, so we don't use it for identity here.
   const uint64_t whale_request_id = request_id_++;
 
+  const bool can_start = active_request_count_ < max_active_requests_ &&
+                         queued_requests_.empty();
+  if (!can_start) {
+    const bool rejected = queued_requests_.size() >= max_queued_requests_;
+    UMA_HISTOGRAM_BOOLEAN("Whale.ITP.ProxyingURLLoader.QueueRejected",
+                          rejected);
+    if (rejected) {
+      // Reject before copying |request| so that a runaway page can't grow
+      // the browser process memory.
+      mojo::Remote<network::mojom::URLLoaderClient>(std::move(client))
+          ->OnComplete(network::URLLoaderCompletionStatus(
+              net::ERR_INSUFFICIENT_RESOURCES));
+      return;
+    }
+  }
+
+  // The only copy of |request|; the queue and the restarts use this one.
   auto result = requests_.emplace(std::make_unique<InProgressRequest>(
       this, whale_request_id, request_id, render_process_id_,
-      frame_tree_node_id_, options, request, browser_context_,
-      traffic_annotation, std::move(loader_receiver), std::move(client)));
-  (*result.first)->Restart();
+      frame_tree_node_id_, options, network::ResourceRequest(request),
+      browser_context_, traffic_annotation, std::move(loader_receiver),
+      std::move(client)));
+  InProgressRequest* in_progress_request = result.first->get();
+  if (can_start) {
+    AdmitRequest(in_progress_request);
+    return;
+  }
+
+  in_progress_request->set_queued_time(base::TimeTicks::Now());
+  queued_requests_.emplace(in_progress_request->queue_key(),
+                           in_progress_request);
+  UMA_HISTOGRAM_COUNTS_10000("Whale.ITP.ProxyingURLLoader.QueueDepth",
+                             queued_requests_.size());
+}
+
+void WhaleProxyingURLLoaderFactory::StartQueuedRequests() {
+  // Restart() can complete a request synchronously, which re-enters
+  // RemoveRequest(); the outer loop keeps admitting in that case.
+  base::AutoReset<bool> starting(&starting_queued_requests_, true);
+  while (active_request_count_ < max_active_requests_ &&
+         !queued_requests_.empty()) {
+    auto it = queued_requests_.begin();
+    InProgressRequest* request = it->second;
+    queued_requests_.erase(it);
+    UMA_HISTOGRAM_TIMES("Whale.ITP.ProxyingURLLoader.QueueTime",
+                        base::TimeTicks::Now() - request->queued_time());
+    AdmitRequest(request);
+  }
+}
+
+void WhaleProxyingURLLoaderFactory::AdmitRequest(InProgressRequest* request) {
+  ++active_request_count_;
+  request->set_holds_slot(true);
+  request->Restart();
+}
+
+void WhaleProxyingURLLoaderFactory::ReleaseSlot(InProgressRequest* request) {
+  if (!request->holds_slot()) {
+    return;
+  }
+  request->set_holds_slot(false);
+  DCHECK_GT(active_request_count_, 0u);
+  --active_request_count_;
+  if (!starting_queued_requests_) {
+    StartQueuedRequests();
+  }
+}
+
+void WhaleProxyingURLLoaderFactory::RequeueRequest(
+    InProgressRequest* request,
+    InProgressRequest::QueueKey old_key) {
+  if (queued_requests_.erase(old_key)) {
+    queued_requests_.emplace(request->queue_key(), request);
+  }
+}
+
+void WhaleProxyingURLLoaderFactory::OnLoaderCreated(
+    int32_t request_id,
+    mojo::PendingReceiver<network::mojom::TrustedHeaderClient> receiver) {
+  auto it = network_service_requests_.find(request_id);
+  if (it == network_service_requests_.end()) {
+    return;
+  }
+  it->second->OnLoaderCreated(std::move(receiver));
+}
+
+void WhaleProxyingURLLoaderFactory::OnLoaderForCorsPreflightCreated(
+    const network::ResourceRequest& request,
+    mojo::PendingReceiver<network::mojom::TrustedHeaderClient> receiver) {
+  // Preflight responses aren't exposed to the page; leave them alone.
 }
 
 void WhaleProxyingURLLoaderFactory::Clone(
@@ -522,6 +833,14 @@ void WhaleProxyingURLLoaderFactory::Clone(
   proxy_receivers_.Add(this, std::move(loader_receiver));
 }
 
+size_t WhaleProxyingURLLoaderFactory::EstimateMemoryUsage() const {
+  size_t bytes = sizeof(*this);
+  for (const auto& request : requests_) {
+    bytes += request->EstimateMemoryUsage();
+  }
+  return bytes;
+}
+
 void WhaleProxyingURLLoaderFactory::OnTargetFactoryError() {
   // Stop calls to CreateLoaderAndStart() when |target_factory_| is invalid.
   target_factory_.reset();
@@ -549,9 +868,29 @@ void WhaleProxyingURLLoaderFactory::MaybeRemoveProxy() {
 }
 
 void WhaleProxyingURLLoaderFactory::RemoveRequest(InProgressRequest* request) {
+  if (request->holds_slot()) {
+    DCHECK_GT(active_request_count_, 0u);
+    --active_request_count_;
+  } else if (!request->started()) {
+    queued_requests_.erase(request->queue_key());
+  }
+
+  auto network_it =
+      network_service_requests_.find(request->network_service_request_id());
+  if (network_it != network_service_requests_.end() &&
+      network_it->second == request) {
+    network_service_requests_.erase(network_it);
+  }
+
   auto it = requests_.find(request);
   DCHECK(it != requests_.end());
   requests_.erase(it);
 
+  if (starting_queued_requests_) {
+    return;
+  }
+
+  StartQueuedRequests();
+
   MaybeRemoveProxy();
 }
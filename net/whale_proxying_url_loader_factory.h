@@ -6,11 +6,15 @@
 #ifndef WHALE_WHALE_BROWSER_NET_WHALE_PROXYING_URL_LOADER_FACTORY_H_
 #define WHALE_WHALE_BROWSER_NET_WHALE_PROXYING_URL_LOADER_FACTORY_H_
 
+#include <map>
+#include <utility>
+
 #include "base/containers/unique_ptr_adapters.h"
 #include "base/functional/callback.h"
 #include "base/memory/raw_ptr.h"
 #include "base/memory/ref_counted_delete_on_sequence.h"
 #include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
 #include "mojo/public/cpp/bindings/pending_receiver.h"
 #include "mojo/public/cpp/bindings/pending_remote.h"
 #include "mojo/public/cpp/bindings/receiver_set.h"
@@ -32,13 +36,16 @@ class BrowserContext;
 class RenderFrameHost;
 }  // namespace content
 
-class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
+class WhaleProxyingURLLoaderFactory
+    : public network::mojom::URLLoaderFactory,
+      public network::mojom::TrustedURLLoaderHeaderClient {
  public:
   using DisconnectCallback =
       base::OnceCallback<void(WhaleProxyingURLLoaderFactory*)>;
 
   class InProgressRequest : public network::mojom::URLLoader,
-                            public network::mojom::URLLoaderClient {
+                            public network::mojom::URLLoaderClient,
+                            public network::mojom::TrustedHeaderClient {
    public:
     InProgressRequest(
         WhaleProxyingURLLoaderFactory* factory,
@@ -47,7 +54,7 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
         int render_process_id,
         int frame_tree_node_id,
         uint32_t options,
-        const network::ResourceRequest& request,
+        network::ResourceRequest request,
         content::BrowserContext* browser_context,
         const net::MutableNetworkTrafficAnnotationTag& traffic_annotation,
         mojo::PendingReceiver<network::mojom::URLLoader> loader_receiver,
@@ -58,6 +65,31 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
 
     void Restart();
 
+    // Binds the header client the network service created for this
+    // request's current loader.
+    void OnLoaderCreated(
+        mojo::PendingReceiver<network::mojom::TrustedHeaderClient> receiver);
+
+    // Key ordering this request in the factory's admission queue: higher
+    // priority first, then arrival order.
+    using QueueKey = std::pair<int, uint64_t>;
+    QueueKey queue_key() const { return {-priority_, request_id_}; }
+    net::RequestPriority priority() const { return priority_; }
+    bool started() const { return started_; }
+    int32_t network_service_request_id() const {
+      return network_service_request_id_;
+    }
+    // Whether this request counts against the factory's active request
+    // limit; from admission until its response headers arrive.
+    bool holds_slot() const { return holds_slot_; }
+    void set_holds_slot(bool holds_slot) { holds_slot_ = holds_slot; }
+    base::TimeTicks queued_time() const { return queued_time_; }
+    void set_queued_time(base::TimeTicks time) { queued_time_ = time; }
+
+    // Estimated heap usage of this request, including the copied
+    // ResourceRequest and its WhaleRequestInfo.
+    size_t EstimateMemoryUsage() const;
+
     // network::mojom::URLLoader:
     void FollowRedirect(
         const std::vector<std::string>& removed_headers,
@@ -85,19 +117,34 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
     void OnTransferSizeUpdated(int32_t transfer_size_diff) override;
     void OnComplete(const network::URLLoaderCompletionStatus& status) override;
 
+    // network::mojom::TrustedHeaderClient:
+    void OnBeforeSendHeaders(const net::HttpRequestHeaders& headers,
+                             OnBeforeSendHeadersCallback callback) override;
+    void OnHeadersReceived(const std::string& headers,
+                           const net::IPEndPoint& remote_endpoint,
+                           OnHeadersReceivedCallback callback) override;
+
    private:
     void ContinueToBeforeSendHeaders(int error_code);
     void ContinueToSendHeaders(int error_code);
     void ContinueToStartRequest(int error_code);
     void ContinueToResponseStarted(int error_code);
-    void ContinueToBeforeRedirect(const net::RedirectInfo& redirect_info,
+    void ContinueToBeforeRedirect(net::RedirectInfo redirect_info,
                                   int error_code);
     void HandleResponseOrRedirectHeaders(
         net::CompletionOnceCallback continuation);
     void OnRequestError(const network::URLLoaderCompletionStatus& status);
     void HandleBeforeRequestRedirect();
+    void FlushTransferSizeUpdate();
 
     base::TimeTicks start_time_;
+    base::TimeTicks queued_time_;
+
+    // Priority as last requested by the client. Used to order the request
+    // while it waits for admission.
+    net::RequestPriority priority_;
+    bool started_ = false;
+    bool holds_slot_ = false;
 
     // TODO(iefremov): Get rid of shared_ptr, we should clearly own the pointer.
     std::shared_ptr<WhaleRequestInfo> ctx_;
@@ -124,6 +171,11 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
     // This is the original receiver the original client meant to talk to.
     mojo::Remote<network::mojom::URLLoader> target_loader_;
 
+    // Lets the network service hand us the response headers before it acts
+    // on them, e.g. before HSTS is recorded.
+    mojo::Receiver<network::mojom::TrustedHeaderClient> header_client_receiver_{
+        this};
+
     // NOTE: This is state which ExtensionWebRequestEventRouter needs to have
     // persisted across some phases of this request -- namely between
     // |OnHeadersReceived()| and request completion or restart. Pointers to
@@ -138,20 +190,30 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
 
     bool request_completed_ = false;
 
+    // Transfer size deltas reported by the network service are summed here
+    // and relayed to |target_client_| at most once per
+    // |kTransferSizeFlushInterval|, and always before OnComplete().
+    int32_t pending_transfer_size_diff_ = 0;
+    base::OneShotTimer transfer_size_flush_timer_;
+
     // This stores the parameters to FollowRedirect that came from
     // the client. That way we can combine it with any other changes that
-    // extensions made to headers in their callbacks.
+    // extensions made to headers in their callbacks. It is kept inline and
+    // reset with Clear() so that the buffers are reused across the hops of a
+    // redirect chain.
     struct FollowRedirectParams {
       FollowRedirectParams();
       FollowRedirectParams(const FollowRedirectParams&) = delete;
       FollowRedirectParams& operator=(const FollowRedirectParams&) = delete;
       ~FollowRedirectParams();
+      void Clear();
+      bool pending = false;
       std::vector<std::string> removed_headers;
       net::HttpRequestHeaders modified_headers;
       net::HttpRequestHeaders modified_cors_exempt_headers;
       absl::optional<GURL> new_url;
     };
-    std::unique_ptr<FollowRedirectParams> pending_follow_redirect_params_;
+    FollowRedirectParams pending_follow_redirect_params_;
 
     base::WeakPtrFactory<InProgressRequest> weak_factory_;
   };
@@ -162,6 +224,9 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
       int frame_tree_node_id,
       mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver,
       mojo::PendingRemote<network::mojom::URLLoaderFactory> target_factory,
+      mojo::PendingReceiver<network::mojom::TrustedURLLoaderHeaderClient>
+          header_client_receiver,
+      bool url_rewrite_in_network_service,
       uint64_t request_id,
       DisconnectCallback on_disconnect);
 
@@ -170,12 +235,28 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
       const WhaleProxyingURLLoaderFactory&) = delete;
   ~WhaleProxyingURLLoaderFactory() override;
 
+  // Fills the URL rewrite settings used by the network service stage when
+  // kTrackingBlockerInNetworkService moves the URL rewrite of frame requests
+  // there.
+  static void PopulateURLRewriteSettings(
+      content::BrowserContext* browser_context,
+      content::RenderFrameHost* render_frame_host,
+      network::mojom::URLLoaderFactoryParams* factory_params);
+
+  // Proxies |factory_receiver|, so that its requests go through the tracker
+  // and ad blocking of OnBeforeURLRequest_BlockWork(). For frames that the
+  // network service stage serves under kTrackingBlockerInNetworkService, the
+  // proxy leaves the URL rewrite to the stage. |header_client| is the one of
+  // ContentBrowserClient::WillCreateURLLoaderFactory(). It is taken unless an
+  // earlier proxy did, in which case trackable security headers aren't
+  // stripped.
   static bool MaybeProxyRequest(
       content::BrowserContext* browser_context,
       content::RenderFrameHost* render_frame_host,
       int render_process_id,
-      mojo::PendingReceiver<network::mojom::URLLoaderFactory>*
-          factory_receiver);
+      mojo::PendingReceiver<network::mojom::URLLoaderFactory>* factory_receiver,
+      mojo::PendingRemote<network::mojom::TrustedURLLoaderHeaderClient>*
+          header_client);
 
   // network::mojom::URLLoaderFactory:
   void CreateLoaderAndStart(
@@ -189,22 +270,65 @@ class WhaleProxyingURLLoaderFactory : public network::mojom::URLLoaderFactory {
   void Clone(mojo::PendingReceiver<network::mojom::URLLoaderFactory>
                  loader_receiver) override;
 
+  // network::mojom::TrustedURLLoaderHeaderClient:
+  void OnLoaderCreated(
+      int32_t request_id,
+      mojo::PendingReceiver<network::mojom::TrustedHeaderClient> receiver)
+      override;
+  void OnLoaderForCorsPreflightCreated(
+      const network::ResourceRequest& request,
+      mojo::PendingReceiver<network::mojom::TrustedHeaderClient> receiver)
+      override;
+
+  int frame_tree_node_id() const { return frame_tree_node_id_; }
+  size_t request_count() const { return requests_.size(); }
+  // Estimated heap usage of this factory and its in-flight requests.
+  size_t EstimateMemoryUsage() const;
+
  private:
   void OnTargetFactoryError();
   void OnProxyBindingError();
   void MaybeRemoveProxy();
   void RemoveRequest(InProgressRequest* request);
 
+  // Starts queued requests, highest priority first, while under the active
+  // request limit.
+  void StartQueuedRequests();
+  void AdmitRequest(InProgressRequest* request);
+  // Called once |request| has its response headers; a request reading its
+  // body no longer holds back the queued ones.
+  void ReleaseSlot(InProgressRequest* request);
+  // Moves a queued |request| whose priority changed from |old_key|.
+  void RequeueRequest(InProgressRequest* request,
+                      InProgressRequest::QueueKey old_key);
+
   raw_ptr<content::BrowserContext> browser_context_ = nullptr;
   const int render_process_id_;
   const int frame_tree_node_id_;
+  // True if the network service stage rewrites the URLs of the requests, see
+  // PopulateURLRewriteSettings().
+  const bool url_rewrite_in_network_service_;
 
   mojo::ReceiverSet<network::mojom::URLLoaderFactory> proxy_receivers_;
   mojo::Remote<network::mojom::URLLoaderFactory> target_factory_;
+  mojo::Receiver<network::mojom::TrustedURLLoaderHeaderClient>
+      url_loader_header_client_receiver_{this};
+
+  // Started requests by the request ID the network service knows them by,
+  // for OnLoaderCreated().
+  std::map<int32_t, InProgressRequest*> network_service_requests_;
 
   std::set<std::unique_ptr<InProgressRequest>, base::UniquePtrComparator>
       requests_;
 
+  // Requests waiting for admission, ordered by InProgressRequest::QueueKey.
+  std::map<InProgressRequest::QueueKey, InProgressRequest*> queued_requests_;
+  size_t active_request_count_ = 0;
+  const size_t max_active_requests_;
+  const size_t max_queued_requests_;
+  // True while StartQueuedRequests() is admitting requests.
+  bool starting_queued_requests_ = false;
+
   uint64_t request_id_;
 
   DisconnectCallback disconnect_callback_;
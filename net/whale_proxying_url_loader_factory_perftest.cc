@@ -0,0 +1,332 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/functional/bind.h"
+#include "base/process/process_metrics.h"
+#include "base/run_loop.h"
+#include "base/strings/strcat.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "chrome/test/base/testing_profile.h"
+#include "content/public/test/browser_task_environment.h"
+#include "mojo/public/cpp/bindings/pending_receiver.h"
+#include "mojo/public/cpp/bindings/receiver.h"
+#include "mojo/public/cpp/bindings/receiver_set.h"
+#include "mojo/public/cpp/bindings/remote.h"
+#include "mojo/public/cpp/bindings/self_owned_receiver.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "net/cookies/site_for_cookies.h"
+#include "net/http/http_response_headers.h"
+#include "net/traffic_annotation/network_traffic_annotation_test_helper.h"
+#include "net/url_request/redirect_info.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "services/network/public/cpp/url_loader_completion_status.h"
+#include "services/network/public/mojom/url_loader.mojom.h"
+#include "services/network/public/mojom/url_loader_factory.mojom.h"
+#include "services/network/public/mojom/url_response_head.mojom.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/origin.h"
+#include "whale/whale/browser/net/whale_proxying_url_loader_factory.h"
+
+// Measures the overhead WhaleProxyingURLLoaderFactory adds on top of the
+// network stack. Both the proxy and an in-process fake target factory run on
+// the UI thread; no network access is needed.
+
+namespace {
+
+constexpr char kMetricPrefix[] = "WhaleProxyingURLLoaderFactory.";
+constexpr char kMetricAddedLatency[] = "added_latency_per_request";
+constexpr char kMetricThroughput[] = "requests_per_second";
+constexpr char kMetricMallocDelta[] = "malloc_bytes_delta";
+constexpr char kMetricPeakProxyMemory[] = "peak_proxy_memory";
+
+// Requests that are started before the task queue is drained.
+constexpr size_t kBatchSize = 500;
+
+struct FakeResponse {
+  size_t redirects = 0;
+  size_t body_size = 0;
+};
+
+// Loader created by FakeTargetFactory. Replies immediately, optionally going
+// through |redirects| hops first.
+class FakeURLLoader : public network::mojom::URLLoader {
+ public:
+  FakeURLLoader(const GURL& url,
+                FakeResponse response,
+                mojo::PendingRemote<network::mojom::URLLoaderClient> client)
+      : url_(url), response_(response), client_(std::move(client)) {
+    Advance();
+  }
+
+  // network::mojom::URLLoader:
+  void FollowRedirect(
+      const std::vector<std::string>& removed_headers,
+      const net::HttpRequestHeaders& modified_headers,
+      const net::HttpRequestHeaders& modified_cors_exempt_headers,
+      const absl::optional<GURL>& new_url) override {
+    Advance();
+  }
+  void SetPriority(net::RequestPriority priority,
+                   int32_t intra_priority_value) override {}
+  void PauseReadingBodyFromNet() override {}
+  void ResumeReadingBodyFromNet() override {}
+
+ private:
+  void Advance() {
+    if (response_.redirects > 0) {
+      --response_.redirects;
+      net::RedirectInfo redirect_info;
+      redirect_info.status_code = 302;
+      redirect_info.new_method = "GET";
+      redirect_info.new_url = GURL(base::StringPrintf(
+          "https://redirect%zu.example/?gclid=1", response_.redirects));
+      redirect_info.new_site_for_cookies =
+          net::SiteForCookies::FromUrl(redirect_info.new_url);
+      auto head = network::mojom::URLResponseHead::New();
+      head->headers = net::HttpResponseHeaders::TryToCreate(
+          "HTTP/1.1 302 Found\r\nLocation: " + redirect_info.new_url.spec() +
+          "\r\n\r\n");
+      client_->OnReceiveRedirect(redirect_info, std::move(head));
+      return;
+    }
+
+    mojo::ScopedDataPipeProducerHandle producer;
+    mojo::ScopedDataPipeConsumerHandle consumer;
+    CHECK_EQ(MOJO_RESULT_OK, mojo::CreateDataPipe(
+                                 std::max<size_t>(response_.body_size, 1),
+                                 producer, consumer));
+    if (response_.body_size) {
+      std::string body(response_.body_size, 'x');
+      size_t written = body.size();
+      producer->WriteData(body.data(), &written, MOJO_WRITE_DATA_FLAG_NONE);
+    }
+    auto head = network::mojom::URLResponseHead::New();
+    head->headers =
+        net::HttpResponseHeaders::TryToCreate("HTTP/1.1 200 OK\r\n\r\n");
+    client_->OnReceiveResponse(std::move(head), std::move(consumer),
+                               absl::nullopt);
+    client_->OnTransferSizeUpdated(response_.body_size);
+    client_->OnComplete(network::URLLoaderCompletionStatus(net::OK));
+  }
+
+  const GURL url_;
+  FakeResponse response_;
+  mojo::Remote<network::mojom::URLLoaderClient> client_;
+};
+
+// Answers each request with the response registered for its URL. Loaders are
+// only created once the batch is drained, so the response has to be picked
+// per request rather than set before starting it.
+class FakeTargetFactory : public network::mojom::URLLoaderFactory {
+ public:
+  // Responses are keyed by host and path, since the proxy may strip the query
+  // before the request gets here. Unknown URLs, e.g. redirect targets, get an
+  // empty response.
+  void AddResponse(const GURL& url, FakeResponse response) {
+    responses_[GetKey(url)] = response;
+  }
+
+  // network::mojom::URLLoaderFactory:
+  void CreateLoaderAndStart(
+      mojo::PendingReceiver<network::mojom::URLLoader> loader_receiver,
+      int32_t request_id,
+      uint32_t options,
+      const network::ResourceRequest& request,
+      mojo::PendingRemote<network::mojom::URLLoaderClient> client,
+      const net::MutableNetworkTrafficAnnotationTag& traffic_annotation)
+      override {
+    auto it = responses_.find(GetKey(request.url));
+    mojo::MakeSelfOwnedReceiver(
+        std::make_unique<FakeURLLoader>(
+            request.url,
+            it != responses_.end() ? it->second : FakeResponse(),
+            std::move(client)),
+        std::move(loader_receiver));
+  }
+  void Clone(mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver)
+      override {
+    receivers_.Add(this, std::move(receiver));
+  }
+
+ private:
+  static std::string GetKey(const GURL& url) {
+    return base::StrCat({url.host_piece(), url.path_piece()});
+  }
+
+  std::map<std::string, FakeResponse> responses_;
+  mojo::ReceiverSet<network::mojom::URLLoaderFactory> receivers_;
+};
+
+// Synthetic renderer-side client. Follows every redirect and counts
+// completions.
+class SyntheticClient : public network::mojom::URLLoaderClient {
+ public:
+  SyntheticClient(size_t* completed,
+                  mojo::PendingReceiver<network::mojom::URLLoaderClient>
+                      receiver)
+      : completed_(completed), receiver_(this, std::move(receiver)) {}
+
+  mojo::Remote<network::mojom::URLLoader>& loader() { return loader_; }
+
+  // network::mojom::URLLoaderClient:
+  void OnReceiveEarlyHints(network::mojom::EarlyHintsPtr early_hints) override {
+  }
+  void OnReceiveResponse(
+      network::mojom::URLResponseHeadPtr head,
+      mojo::ScopedDataPipeConsumerHandle body,
+      absl::optional<mojo_base::BigBuffer> cached_metadata) override {}
+  void OnReceiveRedirect(const net::RedirectInfo& redirect_info,
+                         network::mojom::URLResponseHeadPtr head) override {
+    loader_->FollowRedirect({}, {}, {}, absl::nullopt);
+  }
+  void OnUploadProgress(int64_t current_position,
+                        int64_t total_size,
+                        OnUploadProgressCallback callback) override {
+    std::move(callback).Run();
+  }
+  void OnTransferSizeUpdated(int32_t transfer_size_diff) override {}
+  void OnComplete(const network::URLLoaderCompletionStatus& status) override {
+    ++*completed_;
+  }
+
+ private:
+  raw_ptr<size_t> completed_;
+  mojo::Receiver<network::mojom::URLLoaderClient> receiver_;
+  mojo::Remote<network::mojom::URLLoader> loader_;
+};
+
+// A mix of first-party, third-party, tracker-parameter and redirected
+// requests, roughly following what a news or shopping page loads.
+struct RequestTemplate {
+  const char* url;
+  const char* initiator;
+  FakeResponse response;
+};
+
+constexpr RequestTemplate kRequestMix[] = {
+    {"https://www.example.com/static/app.js", "https://www.example.com",
+     {0, 16 * 1024}},
+    {"https://www.example.com/api/feed?page=2", "https://www.example.com",
+     {0, 4 * 1024}},
+    {"https://cdn.example.net/img/hero.webp", "https://www.example.com",
+     {0, 64 * 1024}},
+    {"https://analytics.tracker.test/collect?cid=1&fbclid=abc",
+     "https://www.example.com", {0, 0}},
+    {"https://ads.adnetwork.test/click?gclid=1&utm_source=x",
+     "https://www.example.com", {5, 0}},
+    {"https://pixel.tracker.test/p.gif?mc_eid=1", "https://www.example.com",
+     {1, 43}},
+};
+
+class WhaleProxyingURLLoaderFactoryPerfTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    for (const RequestTemplate& entry : kRequestMix) {
+      target_.AddResponse(GURL(entry.url), entry.response);
+    }
+  }
+
+  // Runs |count| requests through |factory| and returns the elapsed time.
+  base::TimeDelta RunRequests(network::mojom::URLLoaderFactory* factory,
+                              size_t count) {
+    size_t completed = 0;
+    std::vector<std::unique_ptr<SyntheticClient>> clients;
+    clients.reserve(kBatchSize);
+
+    const base::TimeTicks start = base::TimeTicks::Now();
+    for (size_t i = 0; i < count; ++i) {
+      const RequestTemplate& entry = kRequestMix[i % std::size(kRequestMix)];
+
+      network::ResourceRequest request;
+      request.method = "GET";
+      request.url = GURL(entry.url);
+      request.request_initiator = url::Origin::Create(GURL(entry.initiator));
+      request.referrer = GURL(entry.initiator);
+
+      mojo::PendingRemote<network::mojom::URLLoaderClient> client_remote;
+      auto client = std::make_unique<SyntheticClient>(
+          &completed, client_remote.InitWithNewPipeAndPassReceiver());
+      factory->CreateLoaderAndStart(
+          client->loader().BindNewPipeAndPassReceiver(), i, 0, request,
+          std::move(client_remote),
+          net::MutableNetworkTrafficAnnotationTag(
+              TRAFFIC_ANNOTATION_FOR_TESTS));
+      clients.push_back(std::move(client));
+
+      if (clients.size() == kBatchSize || i + 1 == count) {
+        base::RunLoop().RunUntilIdle();
+        if (proxy_) {
+          peak_proxy_memory_ =
+              std::max(peak_proxy_memory_, proxy_->EstimateMemoryUsage());
+        }
+        clients.clear();
+      }
+    }
+    const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+    EXPECT_EQ(count, completed);
+    return elapsed;
+  }
+
+  void RunBenchmark(const std::string& story, size_t count) {
+    mojo::Remote<network::mojom::URLLoaderFactory> direct;
+    target_.Clone(direct.BindNewPipeAndPassReceiver());
+    const base::TimeDelta direct_time = RunRequests(direct.get(), count);
+
+    mojo::Remote<network::mojom::URLLoaderFactory> proxied;
+    mojo::PendingRemote<network::mojom::URLLoaderFactory> target_remote;
+    target_.Clone(target_remote.InitWithNewPipeAndPassReceiver());
+    proxy_ = std::make_unique<WhaleProxyingURLLoaderFactory>(
+        &profile_, /*render_process_id=*/0, /*frame_tree_node_id=*/0,
+        proxied.BindNewPipeAndPassReceiver(), std::move(target_remote),
+        /*header_client_receiver=*/mojo::NullReceiver(),
+        /*url_rewrite_in_network_service=*/false, /*request_id=*/0,
+        base::DoNothing());
+
+    auto metrics = base::ProcessMetrics::CreateCurrentProcessMetrics();
+    const size_t malloc_before = metrics->GetMallocUsage();
+    const base::TimeDelta proxied_time = RunRequests(proxy_.get(), count);
+    const size_t malloc_after = metrics->GetMallocUsage();
+
+    perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+    reporter.RegisterImportantMetric(kMetricAddedLatency, "us");
+    reporter.RegisterImportantMetric(kMetricThroughput, "runs/s");
+    reporter.RegisterImportantMetric(kMetricMallocDelta, "bytes");
+    reporter.RegisterImportantMetric(kMetricPeakProxyMemory, "bytes");
+    reporter.AddResult(kMetricAddedLatency,
+                       (proxied_time - direct_time).InMicrosecondsF() / count);
+    reporter.AddResult(kMetricThroughput, count / proxied_time.InSecondsF());
+    reporter.AddResult(kMetricMallocDelta,
+                       static_cast<size_t>(malloc_after > malloc_before
+                                               ? malloc_after - malloc_before
+                                               : 0));
+    reporter.AddResult(kMetricPeakProxyMemory, peak_proxy_memory_);
+
+    proxy_.reset();
+  }
+
+  content::BrowserTaskEnvironment task_environment_;
+  TestingProfile profile_;
+  FakeTargetFactory target_;
+  std::unique_ptr<WhaleProxyingURLLoaderFactory> proxy_;
+  size_t peak_proxy_memory_ = 0;
+};
+
+}  // namespace
+
+TEST_F(WhaleProxyingURLLoaderFactoryPerfTest, RequestMix10k) {
+  RunBenchmark("request_mix_10k", 10000);
+}
+
+TEST_F(WhaleProxyingURLLoaderFactoryPerfTest, RequestMix100k) {
+  RunBenchmark("request_mix_100k", 100000);
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/net/whale_proxying_url_loader_factory.h"
+
+#include <utility>
+
+#include "base/run_loop.h"
+#include "base/test/scoped_feature_list.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "chrome/test/base/chrome_render_view_host_test_harness.h"
+#include "content/public/browser/render_frame_host.h"
+#include "content/public/browser/render_process_host.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "mojo/public/cpp/bindings/receiver.h"
+#include "mojo/public/cpp/bindings/remote.h"
+#include "net/base/net_errors.h"
+#include "net/traffic_annotation/network_traffic_annotation_test_helper.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "services/network/public/mojom/network_context.mojom.h"
+#include "services/network/public/mojom/url_loader_factory.mojom.h"
+#include "services/network/test/test_url_loader_client.h"
+#include "services/network/test/test_url_loader_factory.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/common/features.h"
+#include "whale/components/tracking_blockers/common/tracker_domain_trie.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
+#include "whale/components/tracking_blockers/tracker_domain_blocklist.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+
+class WhaleProxyingURLLoaderFactoryTest
+    : public ChromeRenderViewHostTestHarness,
+      public whale_blocker::mojom::URLRewriteSettingsObserver {
+ protected:
+  // whale_blocker::mojom::URLRewriteSettingsObserver:
+  void OnURLRewriteSettingsChanged(
+      whale_blocker::mojom::URLRewriteSettingsPtr settings) override {
+    settings_ = std::move(settings);
+  }
+
+  whale_blocker::mojom::URLRewriteSettingsPtr settings_;
+};
+
+TEST_F(WhaleProxyingURLLoaderFactoryTest, FramesRewrittenByStage) {
+  NavigateAndCommit(GURL("https://example.com/"));
+  const int render_process_id = main_rfh()->GetProcess()->GetID();
+
+  {
+    base::test::ScopedFeatureList features(
+        whale_blocker::features::kTrackingBlockerInNetworkService);
+
+    // Frame factories are still proxied for blocking; only the URL rewrite
+    // moves to the stage, which gets the settings below.
+    mojo::PendingRemote<network::mojom::URLLoaderFactory> factory;
+    auto factory_receiver = factory.InitWithNewPipeAndPassReceiver();
+    EXPECT_TRUE(WhaleProxyingURLLoaderFactory::MaybeProxyRequest(
+        profile(), main_rfh(), render_process_id, &factory_receiver,
+        /*header_client=*/nullptr));
+    EXPECT_TRUE(factory_receiver.is_valid());
+
+    auto params = network::mojom::URLLoaderFactoryParams::New();
+    WhaleProxyingURLLoaderFactory::PopulateURLRewriteSettings(
+        profile(), main_rfh(), params.get());
+    ASSERT_TRUE(params->whale_url_rewrite_settings);
+    EXPECT_TRUE(params->whale_url_rewrite_settings->enable_tracking_blocker);
+
+    // Settings changed while the document is alive reach its factory.
+    mojo::Receiver<whale_blocker::mojom::URLRewriteSettingsObserver> receiver(
+        this, std::move(params->whale_url_rewrite_settings_observer));
+    whale_blocker::SetTrackingBlockerControlType(
+        HostContentSettingsMapFactory::GetForProfile(profile()),
+        whale_blocker::ControlType::ALLOW, GURL("https://example.com/"));
+    base::RunLoop().RunUntilIdle();
+    ASSERT_TRUE(settings_);
+    EXPECT_FALSE(settings_->enable_tracking_blocker);
+  }
+
+  // Without the feature the stage gets no settings.
+  auto params = network::mojom::URLLoaderFactoryParams::New();
+  WhaleProxyingURLLoaderFactory::PopulateURLRewriteSettings(
+      profile(), main_rfh(), params.get());
+  EXPECT_FALSE(params->whale_url_rewrite_settings);
+}
+
+TEST_F(WhaleProxyingURLLoaderFactoryTest, FramesBlockedWithStage) {
+  NavigateAndCommit(GURL("https://example.com/"));
+  base::test::ScopedFeatureList features(
+      whale_blocker::features::kTrackingBlockerInNetworkService);
+  auto* blocklist = whale_blocker::TrackerDomainBlocklist::GetInstance();
+  blocklist->SetTrieForTesting(
+      whale_blocker::TrackerDomainTrie::CreateFromBuffer(
+          whale_blocker::TrackerDomainTrie::Build({"tracker.com"})));
+
+  mojo::Remote<network::mojom::URLLoaderFactory> factory;
+  auto factory_receiver = factory.BindNewPipeAndPassReceiver();
+  ASSERT_TRUE(WhaleProxyingURLLoaderFactory::MaybeProxyRequest(
+      profile(), main_rfh(), main_rfh()->GetProcess()->GetID(),
+      &factory_receiver, /*header_client=*/nullptr));
+  network::TestURLLoaderFactory target;
+  target.Clone(std::move(factory_receiver));
+
+  auto start = [&factory](const char* url, blink::mojom::ResourceType type,
+                          network::TestURLLoaderClient* client) {
+    network::ResourceRequest request;
+    request.url = GURL(url);
+    request.request_initiator =
+        url::Origin::Create(GURL("https://example.com/"));
+    request.resource_type = static_cast<int>(type);
+    mojo::PendingRemote<network::mojom::URLLoader> loader;
+    factory->CreateLoaderAndStart(
+        loader.InitWithNewPipeAndPassReceiver(), /*request_id=*/0,
+        network::mojom::kURLLoadOptionNone, request, client->CreateRemote(),
+        net::MutableNetworkTrafficAnnotationTag(TRAFFIC_ANNOTATION_FOR_TESTS));
+    return loader;
+  };
+
+  // Trackers are still blocked by the proxy.
+  network::TestURLLoaderClient tracker_client;
+  auto tracker_loader = start("https://px.tracker.com/p",
+                              blink::mojom::ResourceType::kScript,
+                              &tracker_client);
+  tracker_client.RunUntilComplete();
+  EXPECT_EQ(net::ERR_BLOCKED_BY_CLIENT,
+            tracker_client.completion_status().error_code);
+
+  // The tracking query of a frame request is left to the stage, instead of
+  // being stripped with an internal redirect.
+  network::TestURLLoaderClient frame_client;
+  auto frame_loader = start("https://shop.test/item?fbclid=1",
+                            blink::mojom::ResourceType::kSubFrame,
+                            &frame_client);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(frame_client.has_received_redirect());
+  EXPECT_TRUE(target.IsPending("https://shop.test/item?fbclid=1"));
+
+  blocklist->SetTrieForTesting(nullptr);
+}
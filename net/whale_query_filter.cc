@@ -5,217 +5,117 @@
 
 #include "whale/whale/browser/net/whale_query_filter.h"
 
-#include "base/containers/fixed_flat_map.h"
-#include "base/containers/fixed_flat_set.h"
 #include "base/metrics/histogram_macros.h"
-#include "base/strings/string_piece.h"
-#include "base/strings/string_split.h"
-#include "base/strings/string_util.h"
-#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
-#include "third_party/re2/src/re2/re2.h"
+#include "base/time/time.h"
+#include "content/public/common/url_constants.h"
+#include "extensions/buildflags/buildflags.h"
+#include "extensions/common/constants.h"
 #include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/whale/browser/net/resource_context_data.h"
+#include "whale/whale/browser/net/whale_request_decision_cache.h"
 #include "whale/whale/browser/net/whale_url_context.h"
 
 namespace {
 
-enum class TrackingQueryType {
-  kUTM = 0,
-  kFBCLID = 1,
-  kGCLID = 2,
-  kDCLID = 3,
-  kTWCLID = 4,
-  kIGSHID = 5,
-  kMTK_TOK = 6,
-  kETC = 500,
-  kMaxValue = kETC,
-};
-
-TrackingQueryType StringToTrackingQueryType(const base::StringPiece& type) {
-  if (type == "utm_source") {
-    return TrackingQueryType::kUTM;
-  }
-  if (type == "fbclid") {
-    return TrackingQueryType::kFBCLID;
-  }
-  if (type == "gclid") {
-    return TrackingQueryType::kGCLID;
-  }
-  if (type == "dclid") {
-    return TrackingQueryType::kDCLID;
+bool IsInternalScheme(const GURL& url) {
+#if BUILDFLAG(ENABLE_EXTENSIONS)
+  if (url.SchemeIs(extensions::kExtensionScheme)) {
+    return true;
   }
-  if (type == "twclid") {
-    return TrackingQueryType::kTWCLID;
-  }
-  if (type == "igshid") {
-    return TrackingQueryType::kIGSHID;
+#endif
+  return url.SchemeIs(content::kChromeUIScheme);
+}
+
+whale_blocker::URLRewriteRequest MakeURLRewriteRequest(
+    const WhaleRequestInfo& ctx) {
+  whale_blocker::URLRewriteRequest request(ctx.request_url(), ctx.referrer);
+  request.method = ctx.method;
+  if (ctx.initiator) {
+    request.initiator = &ctx.initiator.value();
   }
-  if (type == "mkt_tok") {
-    return TrackingQueryType::kMTK_TOK;
+  if (ctx.redirect_source) {
+    request.redirect_source = &ctx.redirect_source.value();
   }
-  return TrackingQueryType::kETC;
+  request.internal_redirect = ctx.internal_redirect;
+  request.internal_scheme = IsInternalScheme(ctx.request_url());
+  request.frame_request =
+      ctx.resource_type == blink::mojom::ResourceType::kMainFrame ||
+      ctx.resource_type == blink::mojom::ResourceType::kSubFrame;
+  request.keep_referrer =
+      ctx.tab_origin.scheme() == content::kChromeExtensionScheme;
+  return request;
 }
 
-}  // namespace
-
-static constexpr auto kSimpleQueryStringTrackers =
-    base::MakeFixedFlatSet<base::StringPiece>(
-        {// https://github.com/brave/brave-browser/issues/4239
-         "fbclid", "gclid", "msclkid", "mc_eid",
-         // https://github.com/brave/brave-browser/issues/9879
-         "dclid",
-         // https://github.com/brave/brave-browser/issues/13644
-         "oly_anon_id", "oly_enc_id",
-         // https://github.com/brave/brave-browser/issues/11579
-         "_openstat",
-         // https://github.com/brave/brave-browser/issues/11817
-         "vero_conv", "vero_id",
-         // https://github.com/brave/brave-browser/issues/13647
-         "wickedid",
-         // https://github.com/brave/brave-browser/issues/11578v
-         "yclid",
-         // https://github.com/brave/brave-browser/issues/8975
-         "__s",
-         // https://github.com/brave/brave-browser/issues/17451
-         "rb_clickid",
-         // https://github.com/brave/brave-browser/issues/17452
-         "s_cid",
-         // https://github.com/brave/brave-browser/issues/17507
-         "ml_subscriber", "ml_subscriber_hash",
-         // https://github.com/brave/brave-browser/issues/18020
-         "twclid",
-         // https://github.com/brave/brave-browser/issues/18758
-         "gbraid", "wbraid",
-         // https://github.com/brave/brave-browser/issues/9019
-         "_hsenc", "__hssc", "__hstc", "__hsfp", "hsCtaTracking",
-         // https://github.com/brave/brave-browser/issues/22082
-         "oft_id", "oft_k", "oft_lk", "oft_d", "oft_c", "oft_ck", "oft_ids",
-         "oft_sk",
-         // https://github.com/brave/brave-browser/issues/24988
-         "ss_email_id",
-         // https://github.com/brave/brave-browser/issues/25238
-         "bsft_uid", "bsft_clkid",
-         // https://github.com/brave/brave-browser/issues/25691
-         "guce_referrer", "guce_referrer_sig",
-         // https://github.com/brave/brave-browser/issues/26295
-         "vgo_ee"});
-
-static constexpr auto kConditionalQueryStringTrackers =
-    base::MakeFixedFlatMap<base::StringPiece, base::StringPiece>(
-        {// https://github.com/brave/brave-browser/issues/9018
-         {"mkt_tok", "([uU]nsubscribe|emailWebview)"}});
-
-static constexpr auto kScopedQueryStringTrackers =
-    base::MakeFixedFlatMap<base::StringPiece, base::StringPiece>({
-        // https://github.com/brave/brave-browser/issues/11580
-        {"igshid", "instagram.com"},
-        // https://github.com/brave/brave-browser/issues/26966
-        {"ref_src", "twitter.com"},
-        {"ref_url", "twitter.com"},
-    });
-
-// Remove tracking query parameters from a GURL, leaving all
-// other parts untouched.
-absl::optional<std::string> StripQueryParameter(
-    const base::StringPiece& query,
-    const std::string& spec,
+// ApplyQueryFilter(), with the result shared across tabs through the
+// profile's decision cache when there is one.
+absl::optional<GURL> ApplyCachedQueryFilter(
+    const WhaleRequestInfo& ctx,
+    const GURL& url,
     std::vector<std::string>& removed_tracker) {
-  // We are using custom query string parsing code here. See
-  // https://github.com/brave/brave-core/pull/13726#discussion_r897712350
-  // for more information on why this approach was selected.
-  //
-  // Split query string by ampersands, remove tracking parameters,
-  // then join the remaining query parameters, untouched, back into
-  // a single query string.
-  const std::vector<base::StringPiece> input_kv_strings =
-      SplitStringPiece(query, "&", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
-  std::vector<base::StringPiece> output_kv_strings;
-  int disallowed_count = 0;
-  for (const auto& kv_string : input_kv_strings) {
-    const std::vector<base::StringPiece> pieces = SplitStringPiece(
-        kv_string, "=", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
-    const base::StringPiece& key = pieces.empty() ? "" : pieces[0];
-    if (pieces.size() >= 2 &&
-        (kSimpleQueryStringTrackers.count(key) == 1 ||
-         (kScopedQueryStringTrackers.count(key) == 1 &&
-          GURL(spec).DomainIs(kScopedQueryStringTrackers.at(key).data())) ||
-         (kConditionalQueryStringTrackers.count(key) == 1 &&
-          !re2::RE2::PartialMatch(
-              spec, kConditionalQueryStringTrackers.at(key).data())))) {
-      ++disallowed_count;
+  auto* decision_cache =
+      ResourceContextData::GetDecisionCache(ctx.browser_context);
+  if (!decision_cache) {
+    return whale_blocker::ApplyQueryFilter(url, removed_tracker);
+  }
 
-      UMA_HISTOGRAM_ENUMERATION("Whale.ITP.URLQueryFiltering",
-                                StringToTrackingQueryType(key));
-      removed_tracker.push_back(std::string(key.begin(), key.end()));
-    } else {
-      output_kv_strings.push_back(kv_string);
+  WhaleRequestDecisionCache::Decision& decision = decision_cache->Lookup(ctx);
+  if (!decision.has_query_filter) {
+    decision.has_query_filter = true;
+    auto filtered_url =
+        whale_blocker::ApplyQueryFilter(url, decision.removed_params);
+    if (filtered_url.has_value()) {
+      decision.filtered_url_spec = filtered_url.value().spec();
     }
   }
-  if (disallowed_count > 0) {
-    return base::JoinString(output_kv_strings, "&");
+  if (decision.filtered_url_spec.empty()) {
+    return absl::nullopt;
   }
-  return absl::nullopt;
+  removed_tracker.insert(removed_tracker.end(),
+                         decision.removed_params.begin(),
+                         decision.removed_params.end());
+  return GURL(decision.filtered_url_spec);
 }
 
-void ApplyPotentialQueryStringFilter(
-    std::shared_ptr<WhaleRequestInfo> ctx,
-    std::vector<std::string>& removed_tracker) {
+whale_blocker::URLRewriteResult ComputeURLRewrite(
+    const WhaleRequestInfo& ctx,
+    bool allow_referrers) {
+  whale_blocker::mojom::URLRewriteSettings settings(
+      ctx.enable_tracking_blocker, allow_referrers);
+  const whale_blocker::URLRewriteRequest request = MakeURLRewriteRequest(ctx);
   // TODO(jwoo.park): Need to keep track the benchmark Brave browser's UMA.
   // There histogram is "Brave.SiteHacks.QueryFilter".
-  SCOPED_UMA_HISTOGRAM_TIMER("Whale.ITP.SiteHacks.QueryFilter");
-  if (!ctx->enable_tracking_blocker) {
-    // Don't apply the filter if the destination URL has shields down.
-    return;
-  }
-
-  if (ctx->method != "GET") {
-    return;
+  // Timed for every request with a query, including those the filter then
+  // skips, as before the rewrites were fused.
+  const bool timed = !request.internal_scheme && ctx.request_url().has_query();
+  const base::TimeTicks start = base::TimeTicks::Now();
+  whale_blocker::URLRewriteResult result = whale_blocker::ComputeURLRewrite(
+      settings, request,
+      [&ctx](const GURL& url, std::vector<std::string>& removed_tracker) {
+        return ApplyCachedQueryFilter(ctx, url, removed_tracker);
+      });
+  if (timed) {
+    UMA_HISTOGRAM_TIMES("Whale.ITP.SiteHacks.QueryFilter",
+                        base::TimeTicks::Now() - start);
   }
+  return result;
+}
 
-  if (ctx->redirect_source.is_valid()) {
-    if (ctx->internal_redirect) {
-      // Ignore internal redirects since we trigger them.
-      return;
-    }
+}  // namespace
 
-    if (net::registry_controlled_domains::SameDomainOrHost(
-            ctx->redirect_source, ctx->request_url,
-            net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES)) {
-      // Same-site redirects are exempted.
-      return;
-    }
-  } else if (ctx->initiator_url.is_valid() &&
-             net::registry_controlled_domains::SameDomainOrHost(
-                 ctx->initiator_url, ctx->request_url,
-                 net::registry_controlled_domains::
-                     INCLUDE_PRIVATE_REGISTRIES)) {
-    // Same-site requests are exempted.
-    return;
-  }
-  auto filtered_url = ApplyQueryFilter(ctx->request_url, removed_tracker);
-  if (filtered_url.has_value()) {
-    ctx->new_url_spec = filtered_url.value().spec();
-  }
+whale_blocker::URLRewriteResult ComputeURLRewriteForContext(
+    const WhaleRequestInfo& ctx) {
+  return ComputeURLRewrite(ctx, ctx.allow_referrers);
 }
 
-absl::optional<GURL> ApplyQueryFilter(
-    const GURL& original_url,
+void ApplyPotentialQueryStringFilter(
+    std::shared_ptr<WhaleRequestInfo> ctx,
     std::vector<std::string>& removed_tracker) {
-  const auto& query = original_url.query_piece();
-  const std::string& spec = original_url.spec();
-  const auto clean_query_value =
-      StripQueryParameter(query, spec, removed_tracker);
-  if (!clean_query_value.has_value()) {
-    return absl::nullopt;
-  }
-  const auto& clean_query = clean_query_value.value();
-  if (clean_query.length() < query.length()) {
-    GURL::Replacements replacements;
-    if (clean_query.empty()) {
-      replacements.ClearQuery();
-    } else {
-      replacements.SetQueryStr(clean_query);
-    }
-    return original_url.ReplaceComponents(replacements);
+  // Referrers are left alone here.
+  whale_blocker::URLRewriteResult rewrite =
+      ComputeURLRewrite(*ctx, /*allow_referrers=*/true);
+  if (rewrite.new_url) {
+    ctx->new_url_spec = rewrite.new_url->spec();
+    removed_tracker = std::move(rewrite.removed_trackers);
   }
-  return absl::nullopt;
 }
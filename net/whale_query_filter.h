@@ -6,16 +6,24 @@
 #ifndef WHALE_WHALE_BROWSER_NET_WHALE_QUERY_FILTER_H_
 #define WHALE_WHALE_BROWSER_NET_WHALE_QUERY_FILTER_H_
 
-#include "third_party/abseil-cpp/absl/types/optional.h"
+#include <memory>
+#include <string>
+#include <vector>
 
-class GURL;
+#include "whale/components/tracking_blockers/common/query_string_filter.h"
+#include "whale/components/tracking_blockers/common/url_rewriter.h"
 
 struct WhaleRequestInfo;
 
-absl::optional<GURL> ApplyQueryFilter(
-    const GURL& original_url,
-    std::vector<std::string>& removed_tracker);
+using whale_blocker::ApplyQueryFilter;
 
+// Runs the tracking blocker URL rewrites (referrer capping, query filter) for
+// |ctx| from a single classification of the request.
+whale_blocker::URLRewriteResult ComputeURLRewriteForContext(
+    const WhaleRequestInfo& ctx);
+
+// Applies only the query filter, setting |ctx->new_url_spec| if tracking
+// parameters were removed.
 void ApplyPotentialQueryStringFilter(std::shared_ptr<WhaleRequestInfo> ctx,
                                      std::vector<std::string>& removed_tracker);
 
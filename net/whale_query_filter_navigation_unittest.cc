@@ -0,0 +1,73 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/net/whale_site_hacks_network_delegate_helper.h"
+
+#include <memory>
+#include <vector>
+
+#include "build/build_config.h"
+#include "chrome/test/base/chrome_render_view_host_test_harness.h"
+#include "content/public/browser/navigation_handle.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/navigation_simulator.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+#if !BUILDFLAG(IS_ANDROID)
+
+using WhaleQueryFilterNavigationTest = ChromeRenderViewHostTestHarness;
+
+TEST_F(WhaleQueryFilterNavigationTest, LoadsFilteredURL) {
+  NavigateAndCommit(GURL("https://example.com/"));
+
+  const GURL filtered_url("https://shop.test/item?id=2");
+  std::unique_ptr<content::NavigationSimulator> simulator =
+      content::NavigationSimulator::CreateRendererInitiated(
+          GURL("https://shop.test/item?fbclid=1&id=2"), main_rfh());
+  simulator->Start();
+
+  // The throttles and the loader only see the filtered URL, and the
+  // navigation is still the one the renderer started.
+  content::NavigationHandle* handle = simulator->GetNavigationHandle();
+  EXPECT_EQ(filtered_url, handle->GetURL());
+  EXPECT_EQ(std::vector<GURL>{filtered_url}, handle->GetRedirectChain());
+  EXPECT_TRUE(handle->IsRendererInitiated());
+
+  simulator->Commit();
+  EXPECT_EQ(filtered_url, web_contents()->GetLastCommittedURL());
+}
+
+TEST_F(WhaleQueryFilterNavigationTest, LoadsURLWithoutTrackers) {
+  NavigateAndCommit(GURL("https://example.com/"));
+
+  const GURL url("https://shop.test/item?id=2");
+  std::unique_ptr<content::NavigationSimulator> simulator =
+      content::NavigationSimulator::CreateRendererInitiated(url, main_rfh());
+  simulator->Start();
+  EXPECT_EQ(url, simulator->GetNavigationHandle()->GetURL());
+
+  simulator->Commit();
+  EXPECT_EQ(url, web_contents()->GetLastCommittedURL());
+}
+
+TEST_F(WhaleQueryFilterNavigationTest, LeavesServerRedirectsToProxy) {
+  NavigateAndCommit(GURL("https://example.com/"));
+
+  std::unique_ptr<content::NavigationSimulator> simulator =
+      content::NavigationSimulator::CreateRendererInitiated(
+          GURL("https://click.test/c"), main_rfh());
+  simulator->Start();
+
+  // The proxy strips the parameters of a redirect target with an internal
+  // redirect; the navigation itself follows the server's URL.
+  const GURL target("https://shop.test/item?gclid=1");
+  simulator->Redirect(target);
+  content::NavigationHandle* handle = simulator->GetNavigationHandle();
+  EXPECT_EQ(target, handle->GetURL());
+  EXPECT_EQ((std::vector<GURL>{GURL("https://click.test/c"), target}),
+            handle->GetRedirectChain());
+}
+
+#endif  // !BUILDFLAG(IS_ANDROID)
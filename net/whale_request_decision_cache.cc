@@ -0,0 +1,161 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/net/whale_request_decision_cache.h"
+
+#include <functional>
+
+#include "base/functional/bind.h"
+#include "base/hash/hash.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/trace_event/memory_usage_estimator.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/ad_filter_list.h"
+#include "whale/components/tracking_blockers/tracker_domain_blocklist.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/net/whale_url_context.h"
+
+namespace {
+
+constexpr size_t kMaxCachedLevels = 256;
+constexpr size_t kMaxCachedDecisions = 4096;
+
+uint64_t GetRulesGeneration() {
+  return whale_blocker::TrackerDomainBlocklist::GetInstance()->generation() +
+         whale_blocker::AdFilterList::GetInstance()->generation();
+}
+
+}  // namespace
+
+WhaleRequestDecisionCache::Decision::Decision() = default;
+WhaleRequestDecisionCache::Decision::Decision(const Decision&) = default;
+WhaleRequestDecisionCache::Decision&
+WhaleRequestDecisionCache::Decision::operator=(const Decision&) = default;
+WhaleRequestDecisionCache::Decision::~Decision() = default;
+
+bool WhaleRequestDecisionCache::Key::operator==(const Key& other) const {
+  return url_hash == other.url_hash && level == other.level &&
+         resource_type == other.resource_type && top_host == other.top_host;
+}
+
+size_t WhaleRequestDecisionCache::KeyHash::operator()(const Key& key) const {
+  return base::HashInts(
+      base::HashInts(key.url_hash, std::hash<std::string>()(key.top_host)),
+      (static_cast<size_t>(key.level) << 8) |
+          static_cast<size_t>(key.resource_type));
+}
+
+WhaleRequestDecisionCache::WhaleRequestDecisionCache(
+    content::BrowserContext* browser_context)
+    : browser_context_(browser_context),
+      map_(HostContentSettingsMapFactory::GetForProfile(browser_context)),
+      levels_(kMaxCachedLevels),
+      decisions_(kMaxCachedDecisions),
+      rules_generation_(GetRulesGeneration()) {
+  observation_.Observe(map_.get());
+  // Bulk exception imports clear once at the end instead of per pattern.
+  batch_subscription_ = whale_blocker::AddTrackingBlockerBatchCallback(
+      browser_context,
+      base::BindRepeating(&WhaleRequestDecisionCache::OnBatchUpdate,
+                          base::Unretained(this)));
+}
+
+WhaleRequestDecisionCache::~WhaleRequestDecisionCache() = default;
+
+// static
+WhaleRequestDecisionCache::Level WhaleRequestDecisionCache::ComputeLevel(
+    HostContentSettingsMap* map,
+    const GURL& url) {
+  switch (whale_blocker::GetTrackingBlockerControlType(map, url)) {
+    case whale_blocker::ControlType::ALLOW:
+      return Level::kDisabled;
+    case whale_blocker::ControlType::BLOCK:
+      return Level::kMax;
+    default:
+      return Level::kStandard;
+  }
+}
+
+WhaleRequestDecisionCache::Level WhaleRequestDecisionCache::GetLevel(
+    const url::Origin& tab_origin) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  std::string key = tab_origin.Serialize();
+  auto it = levels_.Get(key);
+  if (it != levels_.end()) {
+    return it->second;
+  }
+  const Level level = ComputeLevel(map_.get(), tab_origin.GetURL());
+  levels_.Put(std::move(key), level);
+  return level;
+}
+
+WhaleRequestDecisionCache::Decision& WhaleRequestDecisionCache::Lookup(
+    const WhaleRequestInfo& ctx) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  MaybeClearForRulesChange();
+
+  const std::string& spec = ctx.request_url().possibly_invalid_spec();
+  Key key{std::hash<std::string>()(spec), ctx.tab_origin.host(),
+          !ctx.enable_tracking_blocker
+              ? Level::kDisabled
+              : (ctx.allow_referrers ? Level::kStandard : Level::kMax),
+          ctx.resource_type};
+  auto it = decisions_.Get(key);
+  if (it != decisions_.end() && it->second.url_spec == spec) {
+    UMA_HISTOGRAM_BOOLEAN("Whale.ITP.RequestDecisionCache.Hit", true);
+    return it->second;
+  }
+  UMA_HISTOGRAM_BOOLEAN("Whale.ITP.RequestDecisionCache.Hit", false);
+
+  Decision decision;
+  decision.url_spec = spec;
+  return decisions_.Put(std::move(key), std::move(decision))->second;
+}
+
+void WhaleRequestDecisionCache::Clear() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  levels_.Clear();
+  decisions_.Clear();
+}
+
+size_t WhaleRequestDecisionCache::EstimateMemoryUsage() const {
+  size_t bytes = levels_.size() * (sizeof(std::string) + sizeof(Level));
+  for (const auto& [key, decision] : decisions_) {
+    bytes += sizeof(key) + sizeof(decision) +
+             base::trace_event::EstimateMemoryUsage(key.top_host) +
+             base::trace_event::EstimateMemoryUsage(decision.url_spec) +
+             base::trace_event::EstimateMemoryUsage(
+                 decision.filtered_url_spec) +
+             base::trace_event::EstimateMemoryUsage(decision.removed_params);
+  }
+  return bytes;
+}
+
+void WhaleRequestDecisionCache::MaybeClearForRulesChange() {
+  const uint64_t generation = GetRulesGeneration();
+  if (generation != rules_generation_) {
+    rules_generation_ = generation;
+    decisions_.Clear();
+  }
+}
+
+void WhaleRequestDecisionCache::OnContentSettingChanged(
+    const ContentSettingsPattern& primary_pattern,
+    const ContentSettingsPattern& secondary_pattern,
+    ContentSettingsTypeSet content_type_set) {
+  if (content_type_set.ContainsAllTypes() ||
+      content_type_set.GetType() == ContentSettingsType::TRACKING_BLOCKER) {
+    if (whale_blocker::IsTrackingBlockerBatchCommitting(browser_context_)) {
+      return;
+    }
+    Clear();
+  }
+}
+
+void WhaleRequestDecisionCache::OnBatchUpdate(
+    const std::vector<ContentSettingsPattern>& patterns) {
+  Clear();
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_WHALE_BROWSER_NET_WHALE_REQUEST_DECISION_CACHE_H_
+#define WHALE_WHALE_BROWSER_NET_WHALE_REQUEST_DECISION_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/callback_list.h"
+#include "base/containers/lru_cache.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/scoped_observation.h"
+#include "base/sequence_checker.h"
+#include "components/content_settings/core/browser/content_settings_observer.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+
+class GURL;
+struct WhaleRequestInfo;
+
+namespace content {
+class BrowserContext;
+}
+
+namespace url {
+class Origin;
+}
+
+// Per-profile cache of tracking blocker decisions, shared by the request
+// proxies of every tab so that the same third-party URLs (analytics, CDNs,
+// pixels) are evaluated once per top-level host rather than once per
+// request. Cleared when TRACKING_BLOCKER settings or the filter lists
+// change. Must be used on the UI thread.
+class WhaleRequestDecisionCache : public content_settings::Observer {
+ public:
+  enum class Level : uint8_t {
+    kDisabled,
+    kStandard,
+    kMax,
+  };
+
+  struct Decision {
+    enum class Block : uint8_t {
+      kNone,
+      kTracker,
+      kAd,
+    };
+
+    Decision();
+    Decision(const Decision&);
+    Decision& operator=(const Decision&);
+    ~Decision();
+
+    // Guards against hash collisions between request URLs.
+    std::string url_spec;
+
+    // Outcome of the tracker domain and ad filter lists.
+    bool has_block = false;
+    Block block = Block::kNone;
+
+    // Outcome of whale_blocker::ApplyQueryFilter(); |filtered_url_spec| is
+    // empty if nothing was removed.
+    bool has_query_filter = false;
+    std::string filtered_url_spec;
+    std::vector<std::string> removed_params;
+  };
+
+  explicit WhaleRequestDecisionCache(content::BrowserContext* browser_context);
+  WhaleRequestDecisionCache(const WhaleRequestDecisionCache&) = delete;
+  WhaleRequestDecisionCache& operator=(const WhaleRequestDecisionCache&) =
+      delete;
+  ~WhaleRequestDecisionCache() override;
+
+  static Level ComputeLevel(HostContentSettingsMap* map, const GURL& url);
+
+  // Tracking blocker level of a tab showing |tab_origin|.
+  Level GetLevel(const url::Origin& tab_origin);
+
+  // Returns the decision for |ctx|'s request, creating an empty one on a
+  // miss. Valid until the next call.
+  Decision& Lookup(const WhaleRequestInfo& ctx);
+
+  void Clear();
+
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  struct Key {
+    bool operator==(const Key& other) const;
+
+    size_t url_hash;
+    std::string top_host;
+    Level level;
+    blink::mojom::ResourceType resource_type;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  // Clears everything if a filter list was swapped since the last call.
+  void MaybeClearForRulesChange();
+
+  // content_settings::Observer:
+  void OnContentSettingChanged(
+      const ContentSettingsPattern& primary_pattern,
+      const ContentSettingsPattern& secondary_pattern,
+      ContentSettingsTypeSet content_type_set) override;
+
+  void OnBatchUpdate(const std::vector<ContentSettingsPattern>& patterns);
+
+  raw_ptr<content::BrowserContext> browser_context_;
+  scoped_refptr<HostContentSettingsMap> map_;
+  base::HashingLRUCache<std::string, Level> levels_;
+  base::HashingLRUCache<Key, Decision, KeyHash> decisions_;
+  uint64_t rules_generation_ = 0;
+
+  base::ScopedObservation<HostContentSettingsMap, content_settings::Observer>
+      observation_{this};
+  base::CallbackListSubscription batch_subscription_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+#endif  // WHALE_WHALE_BROWSER_NET_WHALE_REQUEST_DECISION_CACHE_H_
@@ -0,0 +1,50 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/net/whale_request_decision_cache.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/net/whale_tracking_blocker_test_util.h"
+#include "whale/whale/browser/net/whale_url_context.h"
+
+using WhaleRequestDecisionCacheTest = WhaleTrackingBlockerProfileTest;
+
+TEST_F(WhaleRequestDecisionCacheTest, SharedAcrossTabs) {
+  HostContentSettingsMap* map = this->map();
+  WhaleRequestDecisionCache cache(profile());
+
+  const url::Origin tab_origin =
+      url::Origin::Create(GURL("https://example.com/"));
+  EXPECT_EQ(WhaleRequestDecisionCache::Level::kStandard,
+            cache.GetLevel(tab_origin));
+
+  WhaleRequestInfo ctx(GURL("https://cdn.net/pixel.gif?fbclid=1"));
+  ctx.tab_origin = tab_origin;
+  ctx.resource_type = blink::mojom::ResourceType::kImage;
+  WhaleRequestDecisionCache::Decision& decision = cache.Lookup(ctx);
+  EXPECT_FALSE(decision.has_block);
+  decision.has_block = true;
+  decision.block = WhaleRequestDecisionCache::Decision::Block::kAd;
+
+  // Requests from other tabs on the same host share the decision.
+  WhaleRequestInfo same_ctx(GURL("https://cdn.net/pixel.gif?fbclid=1"));
+  same_ctx.tab_origin = tab_origin;
+  same_ctx.resource_type = blink::mojom::ResourceType::kImage;
+  EXPECT_TRUE(cache.Lookup(same_ctx).has_block);
+
+  // A different top-level host doesn't.
+  same_ctx.tab_origin = url::Origin::Create(GURL("https://other.com/"));
+  EXPECT_FALSE(cache.Lookup(same_ctx).has_block);
+
+  // Changing the setting drops cached levels and decisions.
+  whale_blocker::SetTrackingBlockerControlType(
+      map, whale_blocker::ControlType::BLOCK, tab_origin.GetURL());
+  EXPECT_EQ(WhaleRequestDecisionCache::Level::kMax,
+            cache.GetLevel(tab_origin));
+  EXPECT_FALSE(cache.Lookup(ctx).has_block);
+}
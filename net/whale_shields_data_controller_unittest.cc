@@ -0,0 +1,136 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_shields_data_controller.h"
+
+#include <string>
+#include <vector>
+
+#include "chrome/test/base/chrome_render_view_host_test_harness.h"
+#include "content/public/test/browser_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "whale/whale/browser/net/whale_block_event_queue.h"
+
+namespace {
+
+using Delta = whale::WhaleShieldsDataController::BlockedResourcesDelta;
+
+class DeltaRecorder : public whale::WhaleShieldsDataController::Observer {
+ public:
+  void OnResourcesChanged() override { ++changed_count; }
+  void OnBlockedResourcesDelta(const Delta& delta) override {
+    deltas.push_back(delta);
+  }
+
+  int changed_count = 0;
+  std::vector<Delta> deltas;
+};
+
+}  // namespace
+
+class WhaleShieldsDataControllerTest : public ChromeRenderViewHostTestHarness {
+ public:
+  WhaleShieldsDataControllerTest()
+      : ChromeRenderViewHostTestHarness(
+            content::BrowserTaskEnvironment::TimeSource::MOCK_TIME) {}
+
+  void SetUp() override {
+    ChromeRenderViewHostTestHarness::SetUp();
+    NavigateAndCommit(GURL("https://example.com/"));
+    whale::WhaleShieldsDataController::CreateForWebContents(web_contents());
+    controller()->AddObserver(&recorder_);
+  }
+
+  void TearDown() override {
+    controller()->RemoveObserver(&recorder_);
+    ChromeRenderViewHostTestHarness::TearDown();
+  }
+
+  whale::WhaleShieldsDataController* controller() {
+    return whale::WhaleShieldsDataController::FromWebContents(web_contents());
+  }
+
+ protected:
+  DeltaRecorder recorder_;
+};
+
+TEST_F(WhaleShieldsDataControllerTest, CoalescesBlocks) {
+  const base::TimeDelta interval =
+      whale::WhaleShieldsDataController::kResourcesChangedInterval;
+
+  // The first block is reported right away.
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/a.js");
+  ASSERT_EQ(1u, recorder_.deltas.size());
+  EXPECT_EQ(1, recorder_.changed_count);
+  EXPECT_FALSE(recorder_.deltas[0].cleared);
+  EXPECT_EQ(std::vector<std::string>({"https://ad.test/a.js"}),
+            recorder_.deltas[0].added_ads);
+
+  // Later ones within the interval are delivered together, without the
+  // entries that were already listed.
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/a.js");
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/b.js");
+  controller()->HandleItemBlocked(BlockType::Trackers, "https://t.test/p");
+  controller()->HandleURLParamsBlocked({"fbclid"});
+  EXPECT_EQ(1u, recorder_.deltas.size());
+  task_environment()->FastForwardBy(interval);
+  ASSERT_EQ(2u, recorder_.deltas.size());
+  EXPECT_EQ(2, recorder_.changed_count);
+  EXPECT_EQ(std::vector<std::string>({"https://ad.test/b.js"}),
+            recorder_.deltas[1].added_ads);
+  EXPECT_EQ(std::vector<std::string>({"https://t.test/p", "fbclid"}),
+            recorder_.deltas[1].added_trackers);
+
+  // Duplicates alone don't notify.
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/b.js");
+  task_environment()->FastForwardBy(interval * 2);
+  EXPECT_EQ(2u, recorder_.deltas.size());
+
+  // After a quiet interval the next block goes out right away again.
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/c.js");
+  EXPECT_EQ(3u, recorder_.deltas.size());
+}
+
+TEST_F(WhaleShieldsDataControllerTest, ClearIsImmediate) {
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/a.js");
+  controller()->HandleItemBlocked(BlockType::Ads, "https://ad.test/b.js");
+  ASSERT_EQ(1u, recorder_.deltas.size());
+
+  // The pending addition is dropped with the lists.
+  controller()->ClearAllResourcesList();
+  ASSERT_EQ(2u, recorder_.deltas.size());
+  EXPECT_TRUE(recorder_.deltas[1].cleared);
+  EXPECT_TRUE(recorder_.deltas[1].added_ads.empty());
+  EXPECT_EQ(0, controller()->GetBlockedAdsCount());
+
+  task_environment()->FastForwardBy(
+      whale::WhaleShieldsDataController::kResourcesChangedInterval);
+  EXPECT_EQ(2u, recorder_.deltas.size());
+}
+
+TEST_F(WhaleShieldsDataControllerTest, DropsEventsOfPreviousDocument) {
+  // SetUp() navigated before the controller existed.
+  NavigateAndCommit(GURL("https://example.com/a"));
+  const int64_t old_navigation_id = controller()->navigation_id();
+  ASSERT_NE(0, old_navigation_id);
+  NavigateAndCommit(GURL("https://example.com/b"));
+  EXPECT_LT(old_navigation_id, controller()->navigation_id());
+  const size_t delta_count = recorder_.deltas.size();
+
+  const int frame_tree_node_id = main_rfh()->GetFrameTreeNodeId();
+  auto* queue = WhaleBlockEventQueue::GetInstance();
+  queue->Push({frame_tree_node_id, old_navigation_id, BlockType::Ads,
+               "https://ad.test/old.js"});
+  task_environment()->RunUntilIdle();
+  EXPECT_EQ(delta_count, recorder_.deltas.size());
+  EXPECT_EQ(0, controller()->GetBlockedAdsCount());
+
+  queue->Push({frame_tree_node_id, controller()->navigation_id(),
+               BlockType::Ads, "https://ad.test/current.js"});
+  queue->Push(
+      {frame_tree_node_id, 0, BlockType::Ads, "https://ad.test/main.js"});
+  task_environment()->RunUntilIdle();
+  EXPECT_EQ(2, controller()->GetBlockedAdsCount());
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_shields_settings_dispatcher.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "chrome/test/base/chrome_render_view_host_test_harness.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/navigation_simulator.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "whale/whale/browser/ui/whale_shields_data_controller.h"
+
+namespace {
+
+// A tab with a shields controller that counts the tracking blocker changes
+// it is told about.
+class TestTab : public whale::WhaleShieldsDataController::Observer {
+ public:
+  TestTab(std::unique_ptr<content::WebContents> web_contents, const GURL& url)
+      : web_contents_(std::move(web_contents)) {
+    Navigate(url);
+    whale::WhaleShieldsDataController::CreateForWebContents(
+        web_contents_.get());
+    controller()->AddObserver(this);
+  }
+  ~TestTab() override { controller()->RemoveObserver(this); }
+
+  void Navigate(const GURL& url) {
+    content::NavigationSimulator::NavigateAndCommitFromBrowser(
+        web_contents_.get(), url);
+  }
+
+  whale::WhaleShieldsDataController* controller() {
+    return whale::WhaleShieldsDataController::FromWebContents(
+        web_contents_.get());
+  }
+
+  // Returns the number of changes since the last call.
+  int TakeChangedCount() { return std::exchange(changed_count_, 0); }
+
+  // whale::WhaleShieldsDataController::Observer:
+  void OnResourcesChanged() override {}
+  void OnTrackingBlockerEnabledChanged() override { ++changed_count_; }
+
+ private:
+  std::unique_ptr<content::WebContents> web_contents_;
+  int changed_count_ = 0;
+};
+
+}  // namespace
+
+class WhaleShieldsSettingsDispatcherTest
+    : public ChromeRenderViewHostTestHarness {
+ public:
+  void TearDown() override {
+    tabs_.clear();
+    ChromeRenderViewHostTestHarness::TearDown();
+  }
+
+  TestTab* AddTab(const char* url) {
+    tabs_.push_back(std::make_unique<TestTab>(CreateTestWebContents(),
+                                              GURL(url)));
+    return tabs_.back().get();
+  }
+
+  void Block(const char* pattern) {
+    ContentSettingsPattern primary =
+        ContentSettingsPattern::FromString(pattern);
+    ASSERT_TRUE(primary.IsValid()) << pattern;
+    HostContentSettingsMapFactory::GetForProfile(profile())
+        ->SetContentSettingCustomScope(primary,
+                                       ContentSettingsPattern::Wildcard(),
+                                       ContentSettingsType::TRACKING_BLOCKER,
+                                       CONTENT_SETTING_BLOCK);
+  }
+
+  whale::WhaleShieldsSettingsDispatcher* dispatcher() {
+    return whale::WhaleShieldsSettingsDispatcher::GetForBrowserContext(
+        profile());
+  }
+
+ private:
+  std::vector<std::unique_ptr<TestTab>> tabs_;
+};
+
+TEST_F(WhaleShieldsSettingsDispatcherTest, WildcardPattern) {
+  TestTab* root = AddTab("https://example.com/");
+  TestTab* sub = AddTab("https://www.example.com/");
+  TestTab* other = AddTab("https://other.test/");
+  EXPECT_EQ(3u, dispatcher()->controller_count());
+
+  Block("[*.]example.com");
+  EXPECT_EQ(1, root->TakeChangedCount());
+  EXPECT_EQ(1, sub->TakeChangedCount());
+  EXPECT_EQ(0, other->TakeChangedCount());
+
+  // Same bucket, but the pattern doesn't match the other host.
+  Block("www.example.com");
+  EXPECT_EQ(0, root->TakeChangedCount());
+  EXPECT_EQ(1, sub->TakeChangedCount());
+  EXPECT_EQ(0, other->TakeChangedCount());
+
+  Block("*");
+  EXPECT_EQ(1, root->TakeChangedCount());
+  EXPECT_EQ(1, sub->TakeChangedCount());
+  EXPECT_EQ(1, other->TakeChangedCount());
+}
+
+TEST_F(WhaleShieldsSettingsDispatcherTest, PublicSuffixPattern) {
+  TestTab* first = AddTab("https://first.co.uk/");
+  TestTab* second = AddTab("https://www.second.co.uk/");
+  TestTab* other = AddTab("https://other.test/");
+
+  // Spans the buckets of every site under the suffix.
+  Block("[*.]co.uk");
+  EXPECT_EQ(1, first->TakeChangedCount());
+  EXPECT_EQ(1, second->TakeChangedCount());
+  EXPECT_EQ(0, other->TakeChangedCount());
+
+  Block("[*.]second.co.uk");
+  EXPECT_EQ(0, first->TakeChangedCount());
+  EXPECT_EQ(1, second->TakeChangedCount());
+  EXPECT_EQ(0, other->TakeChangedCount());
+}
+
+TEST_F(WhaleShieldsSettingsDispatcherTest, IPHost) {
+  TestTab* ip = AddTab("http://192.168.0.1/");
+  TestTab* other_ip = AddTab("http://192.168.0.2/");
+  TestTab* ipv6 = AddTab("http://[::1]/");
+
+  Block("192.168.0.1");
+  EXPECT_EQ(1, ip->TakeChangedCount());
+  EXPECT_EQ(0, other_ip->TakeChangedCount());
+  EXPECT_EQ(0, ipv6->TakeChangedCount());
+
+  Block("[::1]");
+  EXPECT_EQ(0, ip->TakeChangedCount());
+  EXPECT_EQ(0, other_ip->TakeChangedCount());
+  EXPECT_EQ(1, ipv6->TakeChangedCount());
+}
+
+TEST_F(WhaleShieldsSettingsDispatcherTest, TabMovesOnNavigation) {
+  TestTab* tab = AddTab("https://a.test/");
+
+  tab->Navigate(GURL("https://b.test/"));
+  EXPECT_EQ(1u, dispatcher()->controller_count());
+  Block("a.test");
+  EXPECT_EQ(0, tab->TakeChangedCount());
+  Block("b.test");
+  EXPECT_EQ(1, tab->TakeChangedCount());
+
+  // Same-site navigations keep the bucket.
+  tab->Navigate(GURL("https://www.b.test/"));
+  Block("[*.]b.test");
+  EXPECT_EQ(1, tab->TakeChangedCount());
+}
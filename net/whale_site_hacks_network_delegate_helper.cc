@@ -5,93 +5,267 @@
 
 #include "whale/whale/browser/net/whale_site_hacks_network_delegate_helper.h"
 
+#include <algorithm>
 #include <utility>
 
+#include "base/strings/string_util.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
 #include "content/public/browser/browser_thread.h"
+#include "content/public/browser/navigation_handle.h"
+#include "content/public/browser/render_frame_host.h"
 #include "content/public/browser/web_contents.h"
-#include "content/public/common/referrer.h"
-#include "content/public/common/url_constants.h"
-#include "extensions/buildflags/buildflags.h"
-#include "extensions/common/constants.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_response_headers.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/ad_filter_list.h"
+#include "whale/components/tracking_blockers/common/exemption_table.h"
+#include "whale/components/tracking_blockers/common/registrable_domain_cache.h"
+#include "whale/components/tracking_blockers/tracker_domain_blocklist.h"
 #include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/net/resource_context_data.h"
+#include "whale/whale/browser/net/whale_block_event_queue.h"
 #include "whale/whale/browser/net/whale_query_filter.h"
+#include "whale/whale/browser/net/whale_request_decision_cache.h"
 #include "whale/whale/browser/ui/whale_shields_data_controller.h"
 
 namespace {
 
-bool IsInternalScheme(std::shared_ptr<WhaleRequestInfo> ctx) {
-  DCHECK(ctx);
-#if BUILDFLAG(ENABLE_EXTENSIONS)
-  if (ctx->request_url.SchemeIs(extensions::kExtensionScheme)) {
-    return true;
+constexpr const char* kTrackableSecurityHeaders[] = {
+    "Strict-Transport-Security", "Expect-CT", "Public-Key-Pins",
+    "Public-Key-Pins-Report-Only"};
+
+void NotifyURLParamsBlocked(int frame_tree_node_id,
+                            int64_t navigation_id,
+                            const std::vector<std::string>& removed_trackers) {
+  for (const auto& param : removed_trackers) {
+    WhaleBlockEventQueue::GetInstance()->Push(
+        {frame_tree_node_id, navigation_id, BlockType::URLParams, param});
   }
-#endif
-  return ctx->request_url.SchemeIs(content::kChromeUIScheme);
 }
 
-} //  namespace
+void NotifyItemBlocked(int frame_tree_node_id,
+                       int64_t navigation_id,
+                       BlockType block_type,
+                       const GURL& url) {
+  WhaleBlockEventQueue::GetInstance()->Push(
+      {frame_tree_node_id, navigation_id, block_type, url.spec()});
+}
 
-bool ApplyPotentialReferrerBlock(std::shared_ptr<WhaleRequestInfo> ctx) {
-  if (ctx->allow_referrers) {
-    return false;
-  }
-  if (ctx->tab_origin.SchemeIs(content::kChromeExtensionScheme)) {
-    return false;
+whale_blocker::AdFilterEngine::ResourceType ToAdFilterResourceType(
+    blink::mojom::ResourceType resource_type) {
+  using whale_blocker::AdFilterEngine;
+  switch (resource_type) {
+    case blink::mojom::ResourceType::kScript:
+    case blink::mojom::ResourceType::kWorker:
+    case blink::mojom::ResourceType::kSharedWorker:
+    case blink::mojom::ResourceType::kServiceWorker:
+      return AdFilterEngine::kScript;
+    case blink::mojom::ResourceType::kImage:
+    case blink::mojom::ResourceType::kFavicon:
+      return AdFilterEngine::kImage;
+    case blink::mojom::ResourceType::kStylesheet:
+      return AdFilterEngine::kStylesheet;
+    case blink::mojom::ResourceType::kXhr:
+      return AdFilterEngine::kXmlHttpRequest;
+    case blink::mojom::ResourceType::kSubFrame:
+      return AdFilterEngine::kSubdocument;
+    case blink::mojom::ResourceType::kPing:
+      return AdFilterEngine::kPing;
+    case blink::mojom::ResourceType::kMedia:
+      return AdFilterEngine::kMedia;
+    case blink::mojom::ResourceType::kFontResource:
+      return AdFilterEngine::kFont;
+    default:
+      return AdFilterEngine::kOther;
   }
+}
 
-  if (ctx->resource_type == blink::mojom::ResourceType::kMainFrame ||
-      ctx->resource_type == blink::mojom::ResourceType::kSubFrame) {
-    // Frame navigations are handled in content::NavigationRequest.
-    return false;
+WhaleRequestDecisionCache::Decision::Block ComputeBlock(
+    const WhaleRequestInfo& ctx) {
+  using Block = WhaleRequestDecisionCache::Decision::Block;
+  // "tracker.com." is the same host as "tracker.com"; match it without the
+  // dot so that it doesn't slip past the host rules of either list.
+  GURL dotless_url;
+  base::StringPiece host = ctx.request_url().host_piece();
+  if (host.size() > 1 && host.back() == '.') {
+    host.remove_suffix(1);
+    GURL::Replacements replacements;
+    replacements.SetHostStr(host);
+    dotless_url = ctx.request_url().ReplaceComponents(replacements);
   }
+  const GURL& url = dotless_url.is_valid() ? dotless_url : ctx.request_url();
 
-  content::Referrer new_referrer;
-  if (whale_blocker::MaybeChangeReferrer(GURL(ctx->referrer),
-          ctx->request_url, &new_referrer)) {
-    ctx->new_referrer = new_referrer.url;
-    return true;
+  if (whale_blocker::IsExempt(whale_blocker::ExemptionFeature::kBlocking,
+                              url)) {
+    return Block::kNone;
   }
-  return false;
+  const bool third_party =
+      !whale_blocker::IsSameDomainOrHost(ctx.tab_origin, url);
+  if (third_party &&
+      whale_blocker::TrackerDomainBlocklist::GetInstance()->Matches(
+          url.host_piece())) {
+    return Block::kTracker;
+  }
+  if (whale_blocker::AdFilterList::GetInstance()->Match(
+          url, ctx.tab_origin.host(),
+          ToAdFilterResourceType(ctx.resource_type), third_party) ==
+      whale_blocker::AdFilterEngine::Decision::kBlock) {
+    return Block::kAd;
+  }
+  return Block::kNone;
 }
 
+} //  namespace
+
 int OnBeforeURLRequest_SiteHacksWork(
     std::shared_ptr<WhaleRequestInfo> ctx,
     raw_ptr<GURL> new_url) {
 #if BUILDFLAG(IS_ANDROID)
   return net::OK;
 #else
-  ApplyPotentialReferrerBlock(ctx);
-  if (IsInternalScheme(ctx)) {
+  ctx->new_url = new_url;
+
+  whale_blocker::URLRewriteResult rewrite = ComputeURLRewriteForContext(*ctx);
+  if (rewrite.new_referrer) {
+    ctx->new_referrer = std::move(rewrite.new_referrer);
+  }
+  if (rewrite.new_url && *rewrite.new_url != ctx->request_url()) {
+    ctx->new_url_spec = rewrite.new_url->spec();
+    *new_url = std::move(*rewrite.new_url);
+    NotifyURLParamsBlocked(ctx->frame_tree_node_id, ctx->navigation_id,
+                           rewrite.removed_trackers);
+  }
+  return net::OK;
+#endif
+}
+
+int OnBeforeURLRequest_BlockWork(std::shared_ptr<WhaleRequestInfo> ctx) {
+  if (!ctx->enable_tracking_blocker ||
+      !ctx->request_url().SchemeIsHTTPOrHTTPS()) {
+    return net::OK;
+  }
+  // Top-level navigations are always allowed; the user asked for the page.
+  if (ctx->resource_type == blink::mojom::ResourceType::kMainFrame ||
+      ctx->tab_origin.opaque()) {
     return net::OK;
   }
-  ctx->new_url = new_url;
 
-  if (ctx->request_url.DomainIs("naver.com")) {
+  using Block = WhaleRequestDecisionCache::Decision::Block;
+  Block block;
+  auto* decision_cache =
+      ResourceContextData::GetDecisionCache(ctx->browser_context);
+  WhaleRequestDecisionCache::Decision* decision =
+      decision_cache ? &decision_cache->Lookup(*ctx) : nullptr;
+  if (decision && decision->has_block) {
+    block = decision->block;
+  } else {
+    block = ComputeBlock(*ctx);
+    if (decision) {
+      decision->has_block = true;
+      decision->block = block;
+    }
+  }
+
+  if (block == Block::kNone) {
+    return net::OK;
+  }
+  NotifyItemBlocked(ctx->frame_tree_node_id, ctx->navigation_id,
+                    block == Block::kTracker ? BlockType::Trackers
+                                             : BlockType::Ads,
+                    ctx->request_url());
+  return net::ERR_BLOCKED_BY_CLIENT;
+}
+
+bool ShouldFilterResponseHeaders(const WhaleRequestInfo& ctx) {
+  return ctx.enable_tracking_blocker && !ctx.tab_origin.opaque() &&
+         !whale_blocker::IsSameDomainOrHost(ctx.tab_origin,
+                                            ctx.request_url());
+}
+
+bool MayHaveTrackableSecurityHeaders(base::StringPiece raw_headers) {
+  for (base::StringPiece name : kTrackableSecurityHeaders) {
+    auto it = std::search(raw_headers.begin(), raw_headers.end(),
+                          name.begin(), name.end(), [](char a, char b) {
+                            return base::ToLowerASCII(a) ==
+                                   base::ToLowerASCII(b);
+                          });
+    if (it != raw_headers.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int OnHeadersReceived_SiteHacksWork(std::shared_ptr<WhaleRequestInfo> ctx,
+                                    net::HttpResponseHeaders* headers) {
+  if (!headers || !ShouldFilterResponseHeaders(*ctx)) {
     return net::OK;
   }
 
-  if (ctx->request_url.has_query()) {
-    std::vector<std::string> removed_trackers;
-    ApplyPotentialQueryStringFilter(ctx, removed_trackers);
-
-    if (!ctx->new_url_spec.empty() &&
-        (ctx->new_url_spec != ctx->request_url.spec())) {
-      *new_url = GURL(ctx->new_url_spec);
-      content::WebContents* web_contents =
-          content::WebContents::FromFrameTreeNodeId(ctx->frame_tree_node_id);
-      if (!web_contents) {
-        return net::OK;
-      }
-      auto* shields_data_ctrlr =
-          whale::WhaleShieldsDataController::FromWebContents(web_contents);
-      // |shields_data_ctrlr| can be null if the |web_contents| is generated in
-      // component layer - We don't attach any tab helpers in this case.
-      if (!shields_data_ctrlr) {
-        return net::OK;
-      }
-      shields_data_ctrlr->HandleURLParamsBlocked(removed_trackers);
+  // Most responses carry none of these headers; check before touching the
+  // header block so that the common case doesn't allocate.
+  bool has_trackable_header = false;
+  for (const char* name : kTrackableSecurityHeaders) {
+    if (headers->HasHeader(name)) {
+      has_trackable_header = true;
+      break;
     }
   }
+  if (!has_trackable_header) {
+    return net::OK;
+  }
+
+  headers->RemoveHeaders({std::begin(kTrackableSecurityHeaders),
+                          std::end(kTrackableSecurityHeaders)});
   return net::OK;
+}
+
+bool MaybeStripTrackingQueryForNavigation(
+    content::NavigationHandle* navigation_handle,
+    GURL* new_url) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  DCHECK(new_url);
+#if BUILDFLAG(IS_ANDROID)
+  return false;
+#else
+  const GURL& url = navigation_handle->GetURL();
+  if (!url.has_query() || !url.SchemeIsHTTPOrHTTPS()) {
+    return false;
+  }
+
+  // Same checks as the proxy does for the request, so that the proxy finds
+  // nothing left to strip and doesn't issue an internal redirect.
+  auto ctx = std::make_shared<WhaleRequestInfo>(url);
+  ctx->method = navigation_handle->IsPost() ? "POST" : "GET";
+  const absl::optional<url::Origin>& initiator =
+      navigation_handle->GetInitiatorOrigin();
+  if (initiator && !initiator->opaque()) {
+    ctx->initiator = initiator;
+  }
+  ctx->resource_type = navigation_handle->IsInMainFrame()
+                           ? blink::mojom::ResourceType::kMainFrame
+                           : blink::mojom::ResourceType::kSubFrame;
+  ctx->tab_origin = url::Origin::Create(
+      navigation_handle->IsInMainFrame()
+          ? url
+          : navigation_handle->GetParentFrameOrOuterDocument()
+                ->GetMainFrame()
+                ->GetLastCommittedURL());
+  auto* map = HostContentSettingsMapFactory::GetForProfile(
+      navigation_handle->GetWebContents()->GetBrowserContext());
+  ctx->enable_tracking_blocker =
+      whale_blocker::GetTrackingBlockerEnabled(map, ctx->tab_origin.GetURL());
+
+  std::vector<std::string> removed_trackers;
+  ApplyPotentialQueryStringFilter(ctx, removed_trackers);
+  if (ctx->new_url_spec.empty() || ctx->new_url_spec == url.spec()) {
+    return false;
+  }
+
+  *new_url = GURL(ctx->new_url_spec);
+  NotifyURLParamsBlocked(navigation_handle->GetFrameTreeNodeId(),
+                         navigation_handle->GetNavigationId(),
+                         removed_trackers);
+  return true;
 #endif
 }
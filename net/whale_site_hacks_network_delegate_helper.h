@@ -8,12 +8,53 @@
 
 #include <memory>
 
+#include "base/strings/string_piece.h"
 #include "content/public/browser/browser_thread.h"
 #include "whale/whale/browser/net/whale_url_context.h"
 
+namespace content {
+class NavigationHandle;
+}
 
-bool ApplyPotentialReferrerBlock(std::shared_ptr<WhaleRequestInfo> ctx);
+namespace net {
+class HttpResponseHeaders;
+}
+
+// Caps the referrer and strips tracking query parameters, setting |new_url|
+// if the request has to be redirected.
 int OnBeforeURLRequest_SiteHacksWork(
     std::shared_ptr<WhaleRequestInfo> ctx, raw_ptr<GURL> new_url);
 
+// Returns net::ERR_BLOCKED_BY_CLIENT for subresource requests to third-party
+// hosts on the tracker domain list or matched by the ad filter list, and
+// records them in the tab's shields data. Returns net::OK otherwise.
+int OnBeforeURLRequest_BlockWork(std::shared_ptr<WhaleRequestInfo> ctx);
+
+// Returns true if the response headers of |ctx| have to go through
+// OnHeadersReceived_SiteHacksWork(): the tracking blocker is on and the
+// request is third-party. Other requests don't opt into the proxy's
+// TrustedHeaderClient.
+bool ShouldFilterResponseHeaders(const WhaleRequestInfo& ctx);
+
+// Returns true if |raw_headers| may carry one of the headers that
+// OnHeadersReceived_SiteHacksWork() strips. Only their names are looked for,
+// so that most responses are passed on without being parsed.
+bool MayHaveTrackableSecurityHeaders(base::StringPiece raw_headers);
+
+// Strips headers that can be used to track users across sites (HSTS, HPKP,
+// Expect-CT) from third-party responses. |headers| is edited in place and only
+// rewritten if one of them is actually present. Must run on the headers the
+// network service has yet to process, see the proxy's TrustedHeaderClient.
+int OnHeadersReceived_SiteHacksWork(std::shared_ptr<WhaleRequestInfo> ctx,
+                                    net::HttpResponseHeaders* headers);
+
+// Applies the query string filter to a frame navigation before its throttles
+// run and its loader is created. Returns true and sets |new_url| if tracking
+// parameters were removed. Reached through the MaybeStripTrackingQuery content
+// hook, see navigation_request_whale.cc; server redirects are left to the
+// proxy.
+bool MaybeStripTrackingQueryForNavigation(
+    content::NavigationHandle* navigation_handle,
+    GURL* new_url);
+
 #endif  // WHALE_WHALE_BROWSER_NET_WHALE_SITE_HACKS_NETWORK_DELEGATE_HELPER_H_
@@ -0,0 +1,126 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+
+#include "base/functional/bind.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/bind.h"
+#include "base/test/scoped_feature_list.h"
+#include "chrome/browser/ui/browser.h"
+#include "chrome/browser/ui/tabs/tab_strip_model.h"
+#include "chrome/test/base/in_process_browser_test.h"
+#include "chrome/test/base/ui_test_utils.h"
+#include "content/public/browser/browser_context.h"
+#include "content/public/browser/storage_partition.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/browser_test.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/content_mock_cert_verifier.h"
+#include "net/base/features.h"
+#include "net/dns/mock_host_resolver.h"
+#include "net/test/embedded_test_server/embedded_test_server.h"
+#include "net/test/embedded_test_server/http_request.h"
+#include "net/test/embedded_test_server/http_response.h"
+#include "services/network/public/mojom/network_context.mojom.h"
+
+namespace {
+
+constexpr char kHSTSPath[] = "/hsts";
+
+std::unique_ptr<net::test_server::HttpResponse> HandleHSTSRequest(
+    const net::test_server::HttpRequest& request) {
+  if (request.relative_url != kHSTSPath) {
+    return nullptr;
+  }
+  auto response = std::make_unique<net::test_server::BasicHttpResponse>();
+  response->set_content_type("text/html");
+  response->set_content("<html></html>");
+  response->AddCustomHeader("Strict-Transport-Security", "max-age=600");
+  response->AddCustomHeader("Access-Control-Allow-Origin", "*");
+  return response;
+}
+
+}  // namespace
+
+class TrackableSecurityHeadersTest : public InProcessBrowserTest {
+ public:
+  void SetUpOnMainThread() override {
+    InProcessBrowserTest::SetUpOnMainThread();
+    mock_cert_verifier_.mock_cert_verifier()->set_default_result(net::OK);
+    host_resolver()->AddRule("*", "127.0.0.1");
+    https_server_ = std::make_unique<net::EmbeddedTestServer>(
+        net::test_server::EmbeddedTestServer::TYPE_HTTPS);
+    https_server_->SetSSLConfig(net::EmbeddedTestServer::CERT_TEST_NAMES);
+    https_server_->RegisterRequestHandler(
+        base::BindRepeating(&HandleHSTSRequest));
+    ASSERT_TRUE(https_server_->Start());
+  }
+
+  void SetUpCommandLine(base::CommandLine* command_line) override {
+    feature_list_.InitAndEnableFeature(net::features::kTrackingBlocker);
+    InProcessBrowserTest::SetUpCommandLine(command_line);
+    mock_cert_verifier_.SetUpCommandLine(command_line);
+  }
+
+  void SetUpInProcessBrowserTestFixture() override {
+    InProcessBrowserTest::SetUpInProcessBrowserTestFixture();
+    mock_cert_verifier_.SetUpInProcessBrowserTestFixture();
+  }
+
+  void TearDownInProcessBrowserTestFixture() override {
+    InProcessBrowserTest::TearDownInProcessBrowserTestFixture();
+    mock_cert_verifier_.TearDownInProcessBrowserTestFixture();
+  }
+
+  content::WebContents* web_contents() {
+    return browser()->tab_strip_model()->GetActiveWebContents();
+  }
+
+  bool IsHSTSActiveForHost(const std::string& host) {
+    base::RunLoop run_loop;
+    bool active = false;
+    web_contents()
+        ->GetBrowserContext()
+        ->GetDefaultStoragePartition()
+        ->GetNetworkContext()
+        ->IsHSTSActiveForHost(host,
+                              base::BindLambdaForTesting([&](bool result) {
+                                active = result;
+                                run_loop.Quit();
+                              }));
+    run_loop.Run();
+    return active;
+  }
+
+ protected:
+  std::unique_ptr<net::EmbeddedTestServer> https_server_;
+  base::test::ScopedFeatureList feature_list_;
+
+ private:
+  content::ContentMockCertVerifier mock_cert_verifier_;
+};
+
+// The header is stripped before the network service sees it, so a third
+// party can't use HSTS to store a bit per subdomain.
+IN_PROC_BROWSER_TEST_F(TrackableSecurityHeadersTest, ThirdPartyHSTSIgnored) {
+  ASSERT_TRUE(ui_test_utils::NavigateToURL(
+      browser(), https_server_->GetURL("a.test", "/")));
+  const GURL hsts_url = https_server_->GetURL("b.test", kHSTSPath);
+  ASSERT_TRUE(content::ExecJs(
+      web_contents(),
+      base::StringPrintf("fetch('%s').then(response => response.text())",
+                         hsts_url.spec().c_str())));
+
+  EXPECT_FALSE(IsHSTSActiveForHost("b.test"));
+}
+
+IN_PROC_BROWSER_TEST_F(TrackableSecurityHeadersTest, FirstPartyHSTSKept) {
+  ASSERT_TRUE(ui_test_utils::NavigateToURL(
+      browser(), https_server_->GetURL("b.test", kHSTSPath)));
+
+  EXPECT_TRUE(IsHSTSActiveForHost("b.test"));
+}
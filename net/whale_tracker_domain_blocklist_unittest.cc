@@ -0,0 +1,170 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/tracker_domain_blocklist.h"
+
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "content/public/test/browser_task_environment.h"
+#include "net/base/net_errors.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/ad_filter_list.h"
+#include "whale/components/tracking_blockers/common/ad_filter_engine.h"
+#include "whale/components/tracking_blockers/common/tracker_domain_trie.h"
+#include "whale/whale/browser/net/whale_site_hacks_network_delegate_helper.h"
+#include "whale/whale/browser/net/whale_url_context.h"
+
+using whale_blocker::TrackerDomainTrie;
+
+namespace {
+
+// Returns a copy of |data| with the |index|th node replaced by |node|.
+std::vector<uint8_t> WithNode(const std::vector<uint8_t>& data,
+                              size_t index,
+                              const TrackerDomainTrie::Node& node) {
+  std::vector<uint8_t> result = data;
+  memcpy(result.data() + sizeof(TrackerDomainTrie::Header) +
+             index * sizeof(TrackerDomainTrie::Node),
+         &node, sizeof(node));
+  return result;
+}
+
+TrackerDomainTrie::Node NodeAt(const std::vector<uint8_t>& data,
+                               size_t index) {
+  TrackerDomainTrie::Node node;
+  memcpy(&node,
+         data.data() + sizeof(TrackerDomainTrie::Header) +
+             index * sizeof(TrackerDomainTrie::Node),
+         sizeof(node));
+  return node;
+}
+
+}  // namespace
+
+TEST(WhaleTrackerDomainBlocklist, TrieMatchesSubdomains) {
+  const std::vector<uint8_t> data = TrackerDomainTrie::Build(
+      {"tracker.test", "ads.example.com", "Metrics.Test."});
+  auto trie = TrackerDomainTrie::CreateFromBuffer(data);
+  ASSERT_TRUE(trie);
+
+  EXPECT_TRUE(trie->Matches("tracker.test"));
+  EXPECT_TRUE(trie->Matches("cdn.tracker.test"));
+  EXPECT_TRUE(trie->Matches("ads.example.com"));
+  EXPECT_TRUE(trie->Matches("metrics.test"));
+  EXPECT_FALSE(trie->Matches("example.com"));
+  EXPECT_FALSE(trie->Matches("www.example.com"));
+  EXPECT_FALSE(trie->Matches("nottracker.test"));
+  EXPECT_FALSE(trie->Matches("test"));
+  EXPECT_FALSE(trie->Matches(""));
+
+  // Truncated buffers are rejected.
+  EXPECT_FALSE(TrackerDomainTrie::CreateFromBuffer(
+      base::make_span(data).first(data.size() - 1)));
+}
+
+TEST(WhaleTrackerDomainBlocklist, CorruptTrieRejected) {
+  // Breadth-first: root, "com", "test", "example", "tracker", "ads".
+  const std::vector<uint8_t> data =
+      TrackerDomainTrie::Build({"tracker.test", "ads.example.com"});
+  ASSERT_TRUE(TrackerDomainTrie::CreateFromBuffer(data));
+
+  // A leaf whose |first_child| is out of range would make FindChild() take
+  // an out-of-range subspan, even though it has no children.
+  TrackerDomainTrie::Node leaf = NodeAt(data, 4);
+  ASSERT_EQ(0u, leaf.child_count);
+  leaf.first_child = 0xffffff00;
+  EXPECT_FALSE(TrackerDomainTrie::CreateFromBuffer(WithNode(data, 4, leaf)));
+
+  // Children ranges running past the nodes.
+  TrackerDomainTrie::Node root = NodeAt(data, 0);
+  root.child_count = 0xffffffff;
+  EXPECT_FALSE(TrackerDomainTrie::CreateFromBuffer(WithNode(data, 0, root)));
+
+  // A node that is its own child.
+  TrackerDomainTrie::Node parent = NodeAt(data, 1);
+  ASSERT_GT(parent.child_count, 0u);
+  parent.first_child = 1;
+  EXPECT_FALSE(TrackerDomainTrie::CreateFromBuffer(WithNode(data, 1, parent)));
+
+  // Labels past the label storage.
+  TrackerDomainTrie::Node label = NodeAt(data, 1);
+  label.label_offset = 0xfffffff0;
+  EXPECT_FALSE(TrackerDomainTrie::CreateFromBuffer(WithNode(data, 1, label)));
+}
+
+TEST(WhaleTrackerDomainBlocklist, ThirdPartyTrackerBlocked) {
+  // OnBeforeURLRequest_BlockWork() expects to run on the UI thread.
+  content::BrowserTaskEnvironment task_environment;
+  auto* blocklist = whale_blocker::TrackerDomainBlocklist::GetInstance();
+  blocklist->SetTrieForTesting(TrackerDomainTrie::CreateFromBuffer(
+      TrackerDomainTrie::Build({"tracker.com"})));
+
+  auto make_ctx = [](const char* url, const char* tab_url) {
+    auto whale_request_info = std::make_shared<WhaleRequestInfo>(GURL(url));
+    whale_request_info->tab_origin = url::Origin::Create(GURL(tab_url));
+    whale_request_info->resource_type = blink::mojom::ResourceType::kScript;
+    whale_request_info->enable_tracking_blocker = true;
+    return whale_request_info;
+  };
+
+  EXPECT_EQ(net::ERR_BLOCKED_BY_CLIENT,
+            OnBeforeURLRequest_BlockWork(
+                make_ctx("https://px.tracker.com/p", "https://example.com/")));
+
+  // First-party requests to a listed site are allowed.
+  EXPECT_EQ(net::OK,
+            OnBeforeURLRequest_BlockWork(make_ctx(
+                "https://px.tracker.com/p", "https://www.tracker.com/")));
+
+  // Unlisted third parties are allowed.
+  EXPECT_EQ(net::OK, OnBeforeURLRequest_BlockWork(make_ctx(
+                         "https://cdn.net/app.js", "https://example.com/")));
+
+  // Nothing is blocked while the tracking blocker is off.
+  auto disabled = make_ctx("https://px.tracker.com/p", "https://example.com/");
+  disabled->enable_tracking_blocker = false;
+  EXPECT_EQ(net::OK, OnBeforeURLRequest_BlockWork(disabled));
+
+  blocklist->SetTrieForTesting(nullptr);
+}
+
+TEST(WhaleTrackerDomainBlocklist, TrailingDotHostBlocked) {
+  content::BrowserTaskEnvironment task_environment;
+  auto* blocklist = whale_blocker::TrackerDomainBlocklist::GetInstance();
+  blocklist->SetTrieForTesting(TrackerDomainTrie::CreateFromBuffer(
+      TrackerDomainTrie::Build({"tracker.com"})));
+  auto* ad_filter_list = whale_blocker::AdFilterList::GetInstance();
+  ad_filter_list->SetEngineForTesting(
+      whale_blocker::AdFilterEngine::CreateFromBuffer(
+          whale_blocker::AdFilterEngine::Build({"||ads.example.net^"})));
+
+  auto make_ctx = [](const char* url) {
+    auto whale_request_info = std::make_shared<WhaleRequestInfo>(GURL(url));
+    whale_request_info->tab_origin =
+        url::Origin::Create(GURL("https://example.com/"));
+    whale_request_info->resource_type = blink::mojom::ResourceType::kScript;
+    whale_request_info->enable_tracking_blocker = true;
+    return whale_request_info;
+  };
+
+  // The dot names the same host; it mustn't get past either list.
+  for (const char* url : {"https://tracker.com./x", "https://px.tracker.com./x",
+                          "https://ads.example.net./a.js"}) {
+    EXPECT_EQ(net::ERR_BLOCKED_BY_CLIENT,
+              OnBeforeURLRequest_BlockWork(make_ctx(url)))
+        << url;
+  }
+  EXPECT_EQ(net::OK,
+            OnBeforeURLRequest_BlockWork(make_ctx("https://cdn.net./app.js")));
+
+  ad_filter_list->SetEngineForTesting(nullptr);
+  blocklist->SetTrieForTesting(nullptr);
+}
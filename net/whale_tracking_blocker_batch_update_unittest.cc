@@ -0,0 +1,71 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <vector>
+
+#include "base/test/bind.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/net/whale_tracking_blocker_test_util.h"
+
+using WhaleTrackingBlockerBatchUpdateTest = WhaleTrackingBlockerProfileTest;
+
+TEST_F(WhaleTrackingBlockerBatchUpdateTest, CommitsOnce) {
+  HostContentSettingsMap* map = this->map();
+  whale_blocker::SetTrackingBlockerControlType(
+      map, whale_blocker::ControlType::BLOCK, GURL("https://c.com/"));
+
+  int batch_count = 0;
+  std::vector<ContentSettingsPattern> changed;
+  auto subscription = whale_blocker::AddTrackingBlockerBatchCallback(
+      profile(), base::BindLambdaForTesting(
+                     [&](const std::vector<ContentSettingsPattern>& patterns) {
+                       EXPECT_FALSE(
+                           whale_blocker::IsTrackingBlockerBatchCommitting(
+                               profile()));
+                       ++batch_count;
+                       changed = patterns;
+                     }));
+
+  whale_blocker::TrackingBlockerBatchUpdate batch(profile());
+  batch.SetControlType(whale_blocker::ControlType::BLOCK,
+                       GURL("https://a.com/"));
+  // The last update for a host wins.
+  batch.SetControlType(whale_blocker::ControlType::BLOCK,
+                       GURL("https://b.com/"));
+  batch.SetControlType(whale_blocker::ControlType::ALLOW,
+                       GURL("https://b.com/x"));
+  // Already set, so not written again.
+  batch.SetControlType(whale_blocker::ControlType::BLOCK,
+                       GURL("https://c.com/"));
+  // Nothing to reset.
+  batch.Reset(GURL("https://d.com/"));
+  batch.SetControlType(whale_blocker::ControlType::BLOCK,
+                       GURL("chrome://settings/"));
+  EXPECT_EQ(4u, batch.pending_count());
+  EXPECT_EQ(0, batch_count);
+
+  EXPECT_EQ(2u, batch.Commit());
+  EXPECT_EQ(1, batch_count);
+  EXPECT_EQ(2u, changed.size());
+  EXPECT_EQ(whale_blocker::ControlType::BLOCK,
+            whale_blocker::GetTrackingBlockerControlType(
+                map, GURL("https://a.com/")));
+  EXPECT_EQ(whale_blocker::ControlType::ALLOW,
+            whale_blocker::GetTrackingBlockerControlType(
+                map, GURL("https://b.com/")));
+
+  batch.Reset(GURL("https://a.com/"));
+  EXPECT_EQ(1u, batch.Commit());
+  EXPECT_EQ(2, batch_count);
+  EXPECT_EQ(whale_blocker::ControlType::DEFAULT,
+            whale_blocker::GetTrackingBlockerControlType(
+                map, GURL("https://a.com/")));
+
+  // Empty commits don't notify.
+  EXPECT_EQ(0u, batch.Commit());
+  EXPECT_EQ(2, batch_count);
+}
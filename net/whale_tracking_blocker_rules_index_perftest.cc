@@ -0,0 +1,121 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/rand_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "components/content_settings/core/common/content_settings.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_index.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker_utils.h"
+
+// Compares GetTrackingBlockerContentSettingFromRules() against
+// TrackingBlockerRulesIndex on synthetic per-site exception lists.
+
+namespace {
+
+using whale_blocker::TrackingBlockerRulesIndex;
+
+constexpr char kMetricPrefix[] = "WhaleTrackingBlockerRules.";
+constexpr char kMetricBuildTime[] = "index_build_time";
+constexpr char kMetricLinearQuery[] = "linear_query_time";
+constexpr char kMetricIndexedQuery[] = "indexed_query_time";
+
+constexpr size_t kQueryCount = 20000;
+
+std::string SiteHost(size_t i) {
+  return base::StringPrintf("site%zu.example%zu.com", i, i % 97);
+}
+
+ContentSettingsForOneType GenerateRules(size_t count) {
+  ContentSettingsForOneType rules;
+  rules.reserve(count + 1);
+  for (size_t i = 0; i < count; ++i) {
+    const std::string pattern =
+        i % 4 ? "*://" + SiteHost(i) + "/*" : "[*.]" + SiteHost(i);
+    rules.emplace_back(ContentSettingsPattern::FromString(pattern),
+                       ContentSettingsPattern::Wildcard(),
+                       base::Value(i % 2 ? CONTENT_SETTING_ALLOW
+                                         : CONTENT_SETTING_BLOCK),
+                       std::string(), false);
+  }
+  // The default rule comes last, as in GetSettingsForOneType().
+  rules.emplace_back(ContentSettingsPattern::Wildcard(),
+                     ContentSettingsPattern::Wildcard(),
+                     base::Value(CONTENT_SETTING_ASK), std::string(), false);
+  return rules;
+}
+
+std::vector<GURL> GenerateQueries(size_t rule_count) {
+  std::vector<GURL> queries;
+  queries.reserve(kQueryCount);
+  for (size_t i = 0; i < kQueryCount; ++i) {
+    // Half hit a listed site, half fall through to the default rule.
+    const std::string host =
+        i % 2 ? "www." + SiteHost(base::RandInt(0, rule_count - 1))
+              : "unlisted" + base::NumberToString(i) + ".net";
+    queries.emplace_back("https://" + host + "/page");
+  }
+  return queries;
+}
+
+void RunTest(const std::string& story, size_t rule_count) {
+  const ContentSettingsForOneType rules = GenerateRules(rule_count);
+  const std::vector<GURL> queries = GenerateQueries(rule_count);
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  TrackingBlockerRulesIndex index(rules);
+  const base::TimeDelta build_time = base::TimeTicks::Now() - start;
+
+  size_t mismatches = 0;
+  std::vector<ContentSetting> linear_results;
+  linear_results.reserve(queries.size());
+  start = base::TimeTicks::Now();
+  for (const GURL& url : queries) {
+    linear_results.push_back(
+        whale_blocker::GetTrackingBlockerContentSettingFromRules(rules, url));
+  }
+  const base::TimeDelta linear_time = base::TimeTicks::Now() - start;
+
+  std::vector<ContentSetting> indexed_results;
+  indexed_results.reserve(queries.size());
+  start = base::TimeTicks::Now();
+  for (const GURL& url : queries) {
+    indexed_results.push_back(index.GetContentSetting(url));
+  }
+  const base::TimeDelta indexed_time = base::TimeTicks::Now() - start;
+
+  for (size_t i = 0; i < queries.size(); ++i) {
+    mismatches += linear_results[i] != indexed_results[i];
+  }
+  EXPECT_EQ(0u, mismatches);
+
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+  reporter.RegisterImportantMetric(kMetricBuildTime, "ms");
+  reporter.RegisterImportantMetric(kMetricLinearQuery, "ns");
+  reporter.RegisterImportantMetric(kMetricIndexedQuery, "ns");
+  reporter.AddResult(kMetricBuildTime, build_time.InMillisecondsF());
+  reporter.AddResult(kMetricLinearQuery,
+                     linear_time.InNanosecondsF() / queries.size());
+  reporter.AddResult(kMetricIndexedQuery,
+                     indexed_time.InNanosecondsF() / queries.size());
+}
+
+}  // namespace
+
+TEST(WhaleTrackingBlockerRulesPerfTest, Rules1k) {
+  RunTest("rules_1k", 1000);
+}
+
+TEST(WhaleTrackingBlockerRulesPerfTest, Rules10k) {
+  RunTest("rules_10k", 10000);
+}
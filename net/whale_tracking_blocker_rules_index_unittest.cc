@@ -0,0 +1,46 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_index.h"
+
+#include <string>
+
+#include "base/values.h"
+#include "components/content_settings/core/common/content_settings.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker_utils.h"
+
+TEST(WhaleTrackingBlockerRulesIndex, KeepsPrecedence) {
+  ContentSettingsForOneType rules;
+  auto add_rule = [&](const std::string& pattern, ContentSetting setting) {
+    rules.emplace_back(ContentSettingsPattern::FromString(pattern),
+                       ContentSettingsPattern::Wildcard(),
+                       base::Value(setting), std::string(), false);
+  };
+  add_rule("https://www.example.com:443/*", CONTENT_SETTING_BLOCK);
+  add_rule("[*.]example.com", CONTENT_SETTING_ALLOW);
+  add_rule("*://sub.example.com/*", CONTENT_SETTING_BLOCK);
+  add_rule("*://192.168.0.1/*", CONTENT_SETTING_ALLOW);
+  add_rule("http://*", CONTENT_SETTING_BLOCK);
+  add_rule("*", CONTENT_SETTING_ASK);
+  whale_blocker::TrackingBlockerRulesIndex index(rules);
+
+  for (const char* url :
+       {"https://www.example.com/", "http://www.example.com/",
+        "https://sub.example.com/", "https://a.sub.example.com./",
+        "https://example.com/", "http://192.168.0.1/", "http://other.com/",
+        "https://other.com/", "https://com/", "file:///tmp/x"}) {
+    EXPECT_EQ(
+        whale_blocker::GetTrackingBlockerContentSettingFromRules(rules,
+                                                                 GURL(url)),
+        index.GetContentSetting(GURL(url)))
+        << url;
+  }
+  EXPECT_EQ(CONTENT_SETTING_ALLOW,
+            index.GetContentSetting(GURL("https://sub.example.com/")));
+  EXPECT_EQ(CONTENT_SETTING_ASK,
+            index.GetContentSetting(GURL("https://other.com/")));
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_table.h"
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/read_only_shared_memory_region.h"
+#include "base/values.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "components/content_settings/core/common/content_settings.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker_utils.h"
+#include "whale/components/tracking_blockers/tracking_blocker_rules_publisher.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/net/whale_tracking_blocker_test_util.h"
+
+using WhaleTrackingBlockerRulesTableTest = WhaleTrackingBlockerProfileTest;
+
+namespace {
+
+std::unique_ptr<whale_blocker::TrackingBlockerRulesTable> CreateTable(
+    const ContentSettingsForOneType& rules) {
+  const std::vector<uint8_t> data =
+      whale_blocker::TrackingBlockerRulesTable::Build(rules, 1);
+  base::MappedReadOnlyRegion mapped =
+      base::ReadOnlySharedMemoryRegion::Create(data.size());
+  if (!mapped.IsValid()) {
+    return nullptr;
+  }
+  memcpy(mapped.mapping.memory(), data.data(), data.size());
+  return whale_blocker::TrackingBlockerRulesTable::Create(mapped.region);
+}
+
+}  // namespace
+
+TEST(WhaleTrackingBlockerRulesTable, MatchesLikePatterns) {
+  ContentSettingsForOneType rules;
+  auto add_rule = [&](const std::string& pattern, ContentSetting setting) {
+    rules.emplace_back(ContentSettingsPattern::FromString(pattern),
+                       ContentSettingsPattern::Wildcard(),
+                       base::Value(setting), std::string(), false);
+  };
+  add_rule("https://www.example.com:8443", CONTENT_SETTING_BLOCK);
+  add_rule("https://[*.]example.com", CONTENT_SETTING_ALLOW);
+  add_rule("*://sub.example.com/*", CONTENT_SETTING_BLOCK);
+  add_rule("*://192.168.0.1/*", CONTENT_SETTING_ALLOW);
+  add_rule("*://[::1]:8080/*", CONTENT_SETTING_BLOCK);
+  add_rule("http://*", CONTENT_SETTING_BLOCK);
+  add_rule("file:///tmp/x", CONTENT_SETTING_ALLOW);
+  add_rule("*", CONTENT_SETTING_ASK);
+  auto table = CreateTable(rules);
+  ASSERT_TRUE(table);
+
+  for (const char* url :
+       {"https://www.example.com:8443/", "https://www.example.com/",
+        "http://www.example.com/", "https://sub.example.com/",
+        "http://sub.example.com./", "https://a.sub.example.com/",
+        "https://example.com/", "https://notexample.com/",
+        "http://192.168.0.1:81/", "http://[::1]:8080/", "https://[::1]/",
+        "http://other.com/", "https://other.com/", "file:///tmp/x",
+        "file:///tmp/y"}) {
+    EXPECT_EQ(
+        whale_blocker::GetTrackingBlockerContentSettingFromRules(rules,
+                                                                 GURL(url)),
+        table->GetContentSetting(GURL(url)))
+        << url;
+  }
+}
+
+TEST(WhaleTrackingBlockerRulesTable, SkipsOversizedPatterns) {
+  ContentSettingsForOneType rules;
+  // Longer than the 16-bit pattern length, in valid labels.
+  std::string long_host;
+  while (long_host.size() <= 70000) {
+    long_host += std::string(60, 'a') + ".";
+  }
+  long_host += "com";
+  const ContentSettingsPattern long_pattern =
+      ContentSettingsPattern::FromString(long_host);
+  ASSERT_TRUE(long_pattern.IsValid());
+  rules.emplace_back(long_pattern,
+                     ContentSettingsPattern::Wildcard(),
+                     base::Value(CONTENT_SETTING_BLOCK), std::string(),
+                     false);
+  rules.emplace_back(ContentSettingsPattern::FromString("[*.]example.com"),
+                     ContentSettingsPattern::Wildcard(),
+                     base::Value(CONTENT_SETTING_ALLOW), std::string(),
+                     false);
+  auto table = CreateTable(rules);
+  ASSERT_TRUE(table);
+  EXPECT_EQ(1u, table->rule_count());
+  EXPECT_EQ(CONTENT_SETTING_ALLOW,
+            table->GetContentSetting(GURL("https://www.example.com/")));
+}
+
+TEST_F(WhaleTrackingBlockerRulesTableTest, MatchesPublishedRules) {
+  HostContentSettingsMap* map = this->map();
+  whale_blocker::SetTrackingBlockerControlType(
+      map, whale_blocker::ControlType::ALLOW, GURL("https://a.example.com/"));
+  whale_blocker::SetTrackingBlockerControlType(
+      map, whale_blocker::ControlType::BLOCK, GURL("https://b.example.com/"));
+
+  whale_blocker::TrackingBlockerRulesPublisher publisher(profile());
+  auto table =
+      whale_blocker::TrackingBlockerRulesTable::Create(publisher.GetRegion());
+  ASSERT_TRUE(table);
+  EXPECT_EQ(publisher.generation(), table->generation());
+
+  ContentSettingsForOneType rules;
+  map->GetSettingsForOneType(ContentSettingsType::TRACKING_BLOCKER, &rules);
+  for (const char* url :
+       {"https://a.example.com/", "https://b.example.com./x",
+        "https://c.example.com/", "http://a.example.com/"}) {
+    EXPECT_EQ(
+        whale_blocker::GetTrackingBlockerContentSettingFromRules(rules,
+                                                                 GURL(url)),
+        table->GetContentSetting(GURL(url)))
+        << url;
+  }
+  EXPECT_EQ(CONTENT_SETTING_ALLOW,
+            table->GetContentSetting(GURL("https://a.example.com/")));
+
+  // A change bumps the generation and rebuilds the table.
+  whale_blocker::ResetTrackingBlockerEnabled(map,
+                                             GURL("https://a.example.com/"));
+  auto updated =
+      whale_blocker::TrackingBlockerRulesTable::Create(publisher.GetRegion());
+  ASSERT_TRUE(updated);
+  EXPECT_GT(updated->generation(), table->generation());
+  EXPECT_NE(CONTENT_SETTING_ALLOW,
+            updated->GetContentSetting(GURL("https://a.example.com/")));
+
+  // Corrupt data is rejected.
+  std::vector<uint8_t> data =
+      whale_blocker::TrackingBlockerRulesTable::Build(rules, 1);
+  data[sizeof(whale_blocker::TrackingBlockerRulesTable::Header)] = 0xff;
+  data[sizeof(whale_blocker::TrackingBlockerRulesTable::Header) + 1] = 0xff;
+  base::MappedReadOnlyRegion corrupt =
+      base::ReadOnlySharedMemoryRegion::Create(data.size());
+  ASSERT_TRUE(corrupt.IsValid());
+  memcpy(corrupt.mapping.memory(), data.data(), data.size());
+  EXPECT_FALSE(
+      whale_blocker::TrackingBlockerRulesTable::Create(corrupt.region));
+}
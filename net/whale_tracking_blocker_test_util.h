@@ -0,0 +1,28 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_WHALE_BROWSER_NET_WHALE_TRACKING_BLOCKER_TEST_UTIL_H_
+#define WHALE_WHALE_BROWSER_NET_WHALE_TRACKING_BLOCKER_TEST_UTIL_H_
+
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "chrome/test/base/testing_profile.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "content/public/test/browser_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// Fixture for tests of tracking blocker code that works on a profile's
+// TRACKING_BLOCKER content settings.
+class WhaleTrackingBlockerProfileTest : public testing::Test {
+ protected:
+  TestingProfile* profile() { return &profile_; }
+  HostContentSettingsMap* map() {
+    return HostContentSettingsMapFactory::GetForProfile(&profile_);
+  }
+
+ private:
+  content::BrowserTaskEnvironment task_environment_;
+  TestingProfile profile_;
+};
+
+#endif  // WHALE_WHALE_BROWSER_NET_WHALE_TRACKING_BLOCKER_TEST_UTIL_H_
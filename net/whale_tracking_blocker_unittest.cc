@@ -12,6 +12,8 @@
 #include <vector>
 
 #include "net/base/net_errors.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
 #include "net/url_request/url_request_job.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "url/origin.h"
@@ -66,8 +68,8 @@ TEST(WhaleTrackingBlockerTest, ReferrerWouldBeClearedButExtensionSite) {
                                       GURL("https://bondy.brian.org")});
   for (const auto& url : urls) {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(url);
-    whale_request_info->tab_origin =
-        GURL("chrome-extension://aemmndcbldboiebfnladdacbdfmadadm/");
+    whale_request_info->tab_origin = url::Origin::Create(
+        GURL("chrome-extension://aemmndcbldboiebfnladdacbdfmadadm/"));
     const GURL original_referrer("https://hello.brianbondy.com/about");
     whale_request_info->referrer = original_referrer;
     whale_request_info->allow_referrers = false;
@@ -106,8 +108,8 @@ TEST(WhaleTrackingBlockerTest, QueryStringUntouched) {
   std::vector<std::string> result;
   for (const auto& url : urls) {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(GURL(url));
-    whale_request_info->initiator_url =
-        GURL("https://example.net");  // cross-site
+    whale_request_info->initiator =
+        url::Origin::Create(GURL("https://example.net"));  // cross-site
     whale_request_info->method = "GET";
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
@@ -127,7 +129,7 @@ TEST(WhaleTrackingBlockerTest, QueryStringExempted) {
 
   for (const auto& initiator : initiators) {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(tracking_url);
-    whale_request_info->initiator_url = GURL(initiator);
+    whale_request_info->initiator = url::Origin::Create(GURL(initiator));
     whale_request_info->method = "GET";
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
@@ -138,12 +140,12 @@ TEST(WhaleTrackingBlockerTest, QueryStringExempted) {
   // Internal redirect
   {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(tracking_url);
-    whale_request_info->initiator_url =
-        GURL("https://example.net");  // cross-site
+    whale_request_info->initiator =
+        url::Origin::Create(GURL("https://example.net"));  // cross-site
     whale_request_info->method = "GET";
     whale_request_info->internal_redirect = true;
     whale_request_info->redirect_source =
-        GURL("https://example.org");  // cross-site
+        url::Origin::Create(GURL("https://example.org"));  // cross-site
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
     // new_url should not be set
@@ -153,11 +155,11 @@ TEST(WhaleTrackingBlockerTest, QueryStringExempted) {
   // POST requests
   {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(tracking_url);
-    whale_request_info->initiator_url =
-        GURL("https://example.net");  // cross-site
+    whale_request_info->initiator =
+        url::Origin::Create(GURL("https://example.net"));  // cross-site
     whale_request_info->method = "POST";
     whale_request_info->redirect_source =
-        GURL("https://example.org");  // cross-site
+        url::Origin::Create(GURL("https://example.org"));  // cross-site
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
     // new_url should not be set
@@ -167,11 +169,11 @@ TEST(WhaleTrackingBlockerTest, QueryStringExempted) {
   // Same-site redirect
   {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(tracking_url);
-    whale_request_info->initiator_url =
-        GURL("https://example.net");  // cross-site
+    whale_request_info->initiator =
+        url::Origin::Create(GURL("https://example.net"));  // cross-site
     whale_request_info->method = "GET";
     whale_request_info->redirect_source =
-        GURL("https://sub.example.com");  // same-site
+        url::Origin::Create(GURL("https://sub.example.com"));  // same-site
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
     // new_url should not be set
@@ -216,8 +218,8 @@ TEST(WhaleTrackingBlockerTest, QueryStringFiltered) {
   for (const auto& pair : urls) {
     auto whale_request_info =
         std::make_shared<WhaleRequestInfo>(GURL(pair.first));
-    whale_request_info->initiator_url =
-        GURL("https://example.net");  // cross-site
+    whale_request_info->initiator =
+        url::Origin::Create(GURL("https://example.net"));  // cross-site
     whale_request_info->method = "GET";
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
@@ -228,11 +230,11 @@ TEST(WhaleTrackingBlockerTest, QueryStringFiltered) {
   {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(
         GURL("https://example.com/?fbclid=1"));
-    whale_request_info->initiator_url =
-        GURL("https://example.com");  // same-origin
+    whale_request_info->initiator =
+        url::Origin::Create(GURL("https://example.com"));  // same-origin
     whale_request_info->method = "GET";
     whale_request_info->redirect_source =
-        GURL("https://example.net");  // cross-site
+        url::Origin::Create(GURL("https://example.net"));  // cross-site
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
     EXPECT_EQ(whale_request_info->new_url_spec, "https://example.com/");
@@ -242,10 +244,70 @@ TEST(WhaleTrackingBlockerTest, QueryStringFiltered) {
   {
     auto whale_request_info = std::make_shared<WhaleRequestInfo>(
         GURL("https://example.com/?fbclid=2"));
-    whale_request_info->initiator_url = GURL();
+    whale_request_info->initiator.reset();
     whale_request_info->method = "GET";
     ApplyPotentialQueryStringFilter(whale_request_info, result);
 
     EXPECT_EQ(whale_request_info->new_url_spec, "https://example.com/");
   }
 }
+
+TEST(WhaleTrackingBlockerTest, TrackableSecurityHeadersRemovedForThirdParty) {
+  const std::string raw_headers =
+      "HTTP/1.1 200 OK\n"
+      "Strict-Transport-Security: max-age=31536000\n"
+      "Expect-CT: max-age=86400\n"
+      "Content-Type: text/html\n\n";
+
+  // Third-party response.
+  {
+    auto headers = base::MakeRefCounted<net::HttpResponseHeaders>(
+        net::HttpUtil::AssembleRawHeaders(raw_headers));
+    auto whale_request_info =
+        std::make_shared<WhaleRequestInfo>(GURL("https://tracker.test/p"));
+    whale_request_info->tab_origin =
+        url::Origin::Create(GURL("https://example.com/"));
+    EXPECT_EQ(net::OK, OnHeadersReceived_SiteHacksWork(whale_request_info,
+                                                       headers.get()));
+    EXPECT_FALSE(headers->HasHeader("Strict-Transport-Security"));
+    EXPECT_FALSE(headers->HasHeader("Expect-CT"));
+    EXPECT_TRUE(headers->HasHeader("Content-Type"));
+  }
+
+  // Same-site response.
+  {
+    auto headers = base::MakeRefCounted<net::HttpResponseHeaders>(
+        net::HttpUtil::AssembleRawHeaders(raw_headers));
+    auto whale_request_info = std::make_shared<WhaleRequestInfo>(
+        GURL("https://static.example.com/app.js"));
+    whale_request_info->tab_origin =
+        url::Origin::Create(GURL("https://example.com/"));
+    EXPECT_EQ(net::OK, OnHeadersReceived_SiteHacksWork(whale_request_info,
+                                                       headers.get()));
+    EXPECT_TRUE(headers->HasHeader("Strict-Transport-Security"));
+    EXPECT_TRUE(headers->HasHeader("Expect-CT"));
+  }
+}
+
+TEST(WhaleTrackingBlockerTest, ResponseHeaderFilterGates) {
+  auto whale_request_info =
+      std::make_shared<WhaleRequestInfo>(GURL("https://tracker.test/p"));
+  whale_request_info->tab_origin =
+      url::Origin::Create(GURL("https://example.com/"));
+  EXPECT_TRUE(ShouldFilterResponseHeaders(*whale_request_info));
+
+  whale_request_info->enable_tracking_blocker = false;
+  EXPECT_FALSE(ShouldFilterResponseHeaders(*whale_request_info));
+
+  auto same_site = std::make_shared<WhaleRequestInfo>(
+      GURL("https://static.example.com/app.js"));
+  same_site->tab_origin = url::Origin::Create(GURL("https://example.com/"));
+  EXPECT_FALSE(ShouldFilterResponseHeaders(*same_site));
+
+  EXPECT_FALSE(MayHaveTrackableSecurityHeaders(
+      net::HttpUtil::AssembleRawHeaders("HTTP/1.1 200 OK\n"
+                                        "Content-Type: text/html\n\n")));
+  EXPECT_TRUE(MayHaveTrackableSecurityHeaders(net::HttpUtil::AssembleRawHeaders(
+      "HTTP/1.1 200 OK\n"
+      "public-key-pins-report-only: pin-sha256=\"x\"\n\n")));
+}
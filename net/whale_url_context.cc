@@ -8,6 +8,7 @@
 #include <memory>
 #include <string>
 
+#include "base/trace_event/memory_usage_estimator.h"
 #include "chrome/browser/content_settings/host_content_settings_map_factory.h"
 #include "chrome/browser/profiles/profile.h"
 #include "content/public/browser/browser_thread.h"
@@ -15,14 +16,36 @@
 #include "content/public/browser/web_contents.h"
 #include "services/network/public/cpp/resource_request.h"
 #include "url/origin.h"
-#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/net/resource_context_data.h"
+#include "whale/whale/browser/net/whale_request_decision_cache.h"
+#include "whale/whale/browser/ui/whale_shields_data_controller.h"
 
-WhaleRequestInfo::WhaleRequestInfo() = default;
-
-WhaleRequestInfo::WhaleRequestInfo(const GURL& url) : request_url(url) {}
+WhaleRequestInfo::WhaleRequestInfo(const GURL& url)
+    : internal_redirect(false),
+      enable_tracking_blocker(true),
+      allow_referrers(false),
+      request_url_(url) {}
 
 WhaleRequestInfo::~WhaleRequestInfo() = default;
 
+size_t WhaleRequestInfo::EstimateMemoryUsage() const {
+  size_t bytes = base::trace_event::EstimateMemoryUsage(method) +
+                 request_url_.EstimateMemoryUsage() +
+                 tab_origin.EstimateMemoryUsage() +
+                 referrer.EstimateMemoryUsage() +
+                 base::trace_event::EstimateMemoryUsage(new_url_spec);
+  if (initiator) {
+    bytes += initiator->EstimateMemoryUsage();
+  }
+  if (redirect_source) {
+    bytes += redirect_source->EstimateMemoryUsage();
+  }
+  if (new_referrer) {
+    bytes += new_referrer->EstimateMemoryUsage();
+  }
+  return bytes;
+}
+
 // static
 std::shared_ptr<WhaleRequestInfo> WhaleRequestInfo::MakeCTX(
     const network::ResourceRequest& request,
@@ -33,13 +56,12 @@ std::shared_ptr<WhaleRequestInfo> WhaleRequestInfo::MakeCTX(
     std::shared_ptr<WhaleRequestInfo> old_ctx) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  auto ctx = std::make_shared<WhaleRequestInfo>();
+  auto ctx = std::make_shared<WhaleRequestInfo>(request.url);
   ctx->request_identifier = request_identifier;
   ctx->method = request.method;
-  ctx->request_url = request.url;
-  // TODO(iefremov): Replace GURL with Origin
-  ctx->initiator_url =
-      request.request_initiator.value_or(url::Origin()).GetURL();
+  if (request.request_initiator && !request.request_initiator->opaque()) {
+    ctx->initiator = request.request_initiator;
+  }
 
   ctx->referrer = request.referrer;
   ctx->referrer_policy = request.referrer_policy;
@@ -52,12 +74,15 @@ std::shared_ptr<WhaleRequestInfo> WhaleRequestInfo::MakeCTX(
   // TODO(iefremov): We still need this for WebSockets, currently
   // |AddChannelRequest| provides only old-fashioned |site_for_cookies|.
   // (See |BraveProxyingWebSocket|).
-  if (ctx->tab_origin.is_empty()) {
-    content::WebContents* contents =
-        content::WebContents::FromFrameTreeNodeId(ctx->frame_tree_node_id);
-    if (contents) {
-      ctx->tab_origin =
-          url::Origin::Create(contents->GetLastCommittedURL()).GetURL();
+  content::WebContents* contents =
+      content::WebContents::FromFrameTreeNodeId(ctx->frame_tree_node_id);
+  if (contents) {
+    ctx->tab_origin = url::Origin::Create(contents->GetLastCommittedURL());
+    auto* controller =
+        whale::WhaleShieldsDataController::FromWebContents(contents);
+    if (controller &&
+        ctx->resource_type != blink::mojom::ResourceType::kMainFrame) {
+      ctx->navigation_id = controller->navigation_id();
     }
   }
 
@@ -66,12 +91,19 @@ std::shared_ptr<WhaleRequestInfo> WhaleRequestInfo::MakeCTX(
     ctx->redirect_source = old_ctx->redirect_source;
   }
 
-  Profile* profile = Profile::FromBrowserContext(browser_context);
-  auto* map = HostContentSettingsMapFactory::GetForProfile(profile);
+  // The level is shared by every request of the tab, so it comes from the
+  // profile's decision cache when there is one.
+  auto* decision_cache = ResourceContextData::GetDecisionCache(browser_context);
+  const WhaleRequestDecisionCache::Level level =
+      decision_cache
+          ? decision_cache->GetLevel(ctx->tab_origin)
+          : WhaleRequestDecisionCache::ComputeLevel(
+                HostContentSettingsMapFactory::GetForProfile(
+                    Profile::FromBrowserContext(browser_context)),
+                ctx->tab_origin.GetURL());
   ctx->enable_tracking_blocker =
-      whale_blocker::GetTrackingBlockerEnabled(map, ctx->tab_origin);
-  ctx->allow_referrers =
-      !whale_blocker::IsTrackingBlockerMaxLevel(map, ctx->tab_origin);
+      level != WhaleRequestDecisionCache::Level::kDisabled;
+  ctx->allow_referrers = level != WhaleRequestDecisionCache::Level::kMax;
 
   ctx->browser_context = browser_context;
 
@@ -7,15 +7,16 @@
 #define WHALE_WHALE_BROWSER_NET_WHALE_URL_CONTEXT_H_
 
 #include <memory>
-#include <set>
 #include <string>
 
-#include "net/http/http_request_headers.h"
-#include "net/http/http_response_headers.h"
+#include "base/functional/callback.h"
+#include "base/memory/raw_ptr.h"
+#include "build/build_config.h"
 #include "net/url_request/referrer_policy.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 #include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
 #include "url/gurl.h"
+#include "url/origin.h"
 
 class WhaleRequestHandler;
 
@@ -31,49 +32,39 @@ struct WhaleRequestInfo;
 using ResponseCallback = base::RepeatingCallback<void()>;
 
 struct WhaleRequestInfo {
-  WhaleRequestInfo();
   WhaleRequestInfo(const WhaleRequestInfo&) = delete;
   WhaleRequestInfo& operator=(const WhaleRequestInfo&) = delete;
 
-  // For tests, should not be used directly.
   explicit WhaleRequestInfo(const GURL& url);
 
   ~WhaleRequestInfo();
-  std::string method;
-  GURL request_url;
-  GURL tab_origin;
-  GURL tab_url;
-  GURL initiator_url;
 
-  bool internal_redirect = false;
-  GURL redirect_source;
+  // Heap memory owned by this object, excluding sizeof(*this).
+  size_t EstimateMemoryUsage() const;
+
+  // The url of the request when this context was made. A context may outlive
+  // its request, and a redirect makes a new context, so this is a copy.
+  const GURL& request_url() const { return request_url_; }
+
+  std::string method;
+  url::Origin tab_origin;
+  absl::optional<url::Origin> initiator;
+  absl::optional<url::Origin> redirect_source;
 
   GURL referrer;
-  net::ReferrerPolicy referrer_policy =
-      net::ReferrerPolicy::CLEAR_ON_TRANSITION_FROM_SECURE_TO_INSECURE;
   absl::optional<GURL> new_referrer;
-
-  absl::optional<int> pending_error;
   std::string new_url_spec;
 
-  bool enable_tracking_blocker = true;
-  bool allow_http_upgradable_resource = false;
-  bool allow_referrers = false;
-  bool is_webtorrent_disabled = false;
-  int frame_tree_node_id = 0;
-  uint64_t request_identifier = 0;
-  size_t next_url_request_index = 0;
-
   raw_ptr<content::BrowserContext> browser_context = nullptr;
-  raw_ptr<net::HttpRequestHeaders> headers = nullptr;
-  // The following two sets are populated by |OnBeforeStartTransactionCallback|.
-  // |set_headers| contains headers which values were added or modified.
-  std::set<std::string> set_headers;
-  std::set<std::string> removed_headers;
-  raw_ptr<const net::HttpResponseHeaders> original_response_headers = nullptr;
-  raw_ptr<scoped_refptr<net::HttpResponseHeaders>> override_response_headers = nullptr;
-
   raw_ptr<GURL> new_url = nullptr;
+  uint64_t request_identifier = 0;
+  // WhaleShieldsDataController::navigation_id() of the tab when the request
+  // started, so that its block events can't land on a later document. 0 for
+  // main frame requests, whose events belong to the document they load.
+  int64_t navigation_id = 0;
+  int frame_tree_node_id = 0;
+  net::ReferrerPolicy referrer_policy =
+      net::ReferrerPolicy::CLEAR_ON_TRANSITION_FROM_SECURE_TO_INSECURE;
 
   // Default to invalid type for resource_type, so delegate helpers
   // can properly detect that the info couldn't be obtained.
@@ -83,6 +74,10 @@ struct WhaleRequestInfo {
       static_cast<blink::mojom::ResourceType>(-1);
   blink::mojom::ResourceType resource_type = kInvalidResourceType;
 
+  bool internal_redirect : 1;
+  bool enable_tracking_blocker : 1;
+  bool allow_referrers : 1;
+
   static std::shared_ptr<WhaleRequestInfo> MakeCTX(
       const network::ResourceRequest& request,
       int render_process_id,
@@ -96,8 +91,18 @@ struct WhaleRequestInfo {
   // Please don't add any more friends here if it can be avoided.
   // We should also remove the one below.
   // friend class ::WhaleRequestHandler;
+
+  const GURL request_url_;
 };
 
+#if defined(ARCH_CPU_64_BITS)
+// A context is rebuilt several times per request; keep it small. The bound
+// includes |navigation_id| and the owned |request_url_|. Update it
+// deliberately if a new field is really needed.
+static_assert(sizeof(WhaleRequestInfo) <= 768,
+              "WhaleRequestInfo grew; consider a more compact field type.");
+#endif
+
 // ResponseListener
 using OnBeforeURLRequestCallback =
     base::RepeatingCallback<int(const ResponseCallback& next_callback,
@@ -0,0 +1,123 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/url_rewriter.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/common/query_string_filter.h"
+
+using whale_blocker::URLRewriteRequest;
+using whale_blocker::URLRewriteResult;
+using whale_blocker::mojom::URLRewriteSettings;
+
+namespace {
+
+URLRewriteResult Rewrite(const URLRewriteRequest& request,
+                         bool allow_referrers = false) {
+  return whale_blocker::ComputeURLRewrite(
+      URLRewriteSettings(/*enable_tracking_blocker=*/true, allow_referrers),
+      request, whale_blocker::ApplyQueryFilter);
+}
+
+}  // namespace
+
+TEST(WhaleURLRewriter, FiltersCrossSiteQuery) {
+  const GURL url("https://shop.test/item?fbclid=1&id=2");
+  const url::Origin initiator = url::Origin::Create(GURL("https://a.test/"));
+  URLRewriteRequest request(url, GURL());
+  request.method = "GET";
+  request.initiator = &initiator;
+
+  URLRewriteResult result = Rewrite(request);
+  EXPECT_EQ(GURL("https://shop.test/item?id=2"), result.new_url);
+  EXPECT_FALSE(result.removed_trackers.empty());
+
+  // Same-site requests are left alone.
+  const url::Origin same_site =
+      url::Origin::Create(GURL("https://www.shop.test/"));
+  request.initiator = &same_site;
+  EXPECT_FALSE(Rewrite(request).new_url);
+  request.initiator = &initiator;
+
+  // So are other methods than GET.
+  request.method = "POST";
+  EXPECT_FALSE(Rewrite(request).new_url);
+  request.method = "GET";
+
+  // Redirects we issued ourselves aren't filtered again.
+  request.redirect_source = &initiator;
+  request.internal_redirect = true;
+  EXPECT_FALSE(Rewrite(request).new_url);
+  request.internal_redirect = false;
+  EXPECT_TRUE(Rewrite(request).new_url);
+  request.redirect_source = nullptr;
+
+  // Embedder schemes are never rewritten.
+  request.internal_scheme = true;
+  EXPECT_FALSE(Rewrite(request).new_url);
+  request.internal_scheme = false;
+
+  // Nor is anything while the tracking blocker is off.
+  EXPECT_FALSE(whale_blocker::ComputeURLRewrite(
+                   URLRewriteSettings(/*enable_tracking_blocker=*/false,
+                                      /*allow_referrers=*/false),
+                   request, whale_blocker::ApplyQueryFilter)
+                   .new_url);
+}
+
+TEST(WhaleURLRewriter, QueryFilterExemptions) {
+  const GURL url("https://search.naver.com/search?fbclid=1");
+  const url::Origin initiator = url::Origin::Create(GURL("https://a.test/"));
+  URLRewriteRequest request(url, GURL());
+  request.method = "GET";
+  request.initiator = &initiator;
+
+  EXPECT_FALSE(Rewrite(request).new_url);
+
+  // Non-HTTP(S) URLs are left alone too.
+  const GURL ftp_url("ftp://shop.test/item?fbclid=1");
+  URLRewriteRequest ftp_request(ftp_url, GURL());
+  ftp_request.method = "GET";
+  ftp_request.initiator = &initiator;
+  EXPECT_FALSE(Rewrite(ftp_request).new_url);
+}
+
+TEST(WhaleURLRewriter, CapsCrossOriginReferrer) {
+  const GURL url("https://b.test/image.png");
+  const GURL referrer("https://a.test/path?secret=1");
+  URLRewriteRequest request(url, referrer);
+  request.method = "GET";
+
+  EXPECT_EQ(GURL("https://a.test/"), Rewrite(request).new_referrer);
+
+  // Referrers aren't sent from HTTPS to HTTP.
+  const GURL insecure_url("http://b.test/image.png");
+  URLRewriteRequest insecure_request(insecure_url, referrer);
+  insecure_request.method = "GET";
+  EXPECT_EQ(GURL(), Rewrite(insecure_request).new_referrer);
+
+  // Nothing to do when referrers are allowed for the site, for frames,
+  // whose referrer content handles, and for pages that keep them.
+  EXPECT_FALSE(Rewrite(request, /*allow_referrers=*/true).new_referrer);
+  request.frame_request = true;
+  EXPECT_FALSE(Rewrite(request).new_referrer);
+  request.frame_request = false;
+  request.keep_referrer = true;
+  EXPECT_FALSE(Rewrite(request).new_referrer);
+}
+
+TEST(WhaleURLRewriter, KeepsSameOriginAndExemptReferrers) {
+  const GURL url("https://a.test/image.png");
+  const GURL referrer("https://a.test/path?secret=1");
+  URLRewriteRequest request(url, referrer);
+  request.method = "GET";
+  EXPECT_FALSE(Rewrite(request).HasChanges());
+
+  const GURL exempt_referrer("https://m.naver.com/path?query=1");
+  URLRewriteRequest exempt_request(url, exempt_referrer);
+  exempt_request.method = "GET";
+  EXPECT_FALSE(Rewrite(exempt_request).HasChanges());
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/ad_filter_list.h"
+
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/task/thread_pool.h"
+
+namespace whale_blocker {
+
+// static
+AdFilterList* AdFilterList::GetInstance() {
+  static base::NoDestructor<AdFilterList> instance;
+  return instance.get();
+}
+
+AdFilterList::AdFilterList() = default;
+AdFilterList::~AdFilterList() = default;
+
+void AdFilterList::Load(const base::FilePath& path) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (path.empty() || path == path_) {
+    return;
+  }
+  path_ = path;
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE,
+      {base::MayBlock(), base::TaskPriority::USER_VISIBLE,
+       base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+      base::BindOnce(&AdFilterEngine::CreateFromFile, path),
+      base::BindOnce(&AdFilterList::OnLoaded,
+                     weak_factory_.GetWeakPtr(), path));
+}
+
+AdFilterEngine::Decision AdFilterList::Match(
+    const GURL& url,
+    base::StringPiece source_host,
+    AdFilterEngine::ResourceType resource_type,
+    bool third_party) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!engine_) {
+    return AdFilterEngine::Decision::kNoMatch;
+  }
+  return engine_->Match(url, source_host, resource_type, third_party);
+}
+
+void AdFilterList::SetEngineForTesting(
+    std::unique_ptr<AdFilterEngine> engine) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  engine_ = std::move(engine);
+  ++generation_;
+}
+
+void AdFilterList::OnLoaded(const base::FilePath& path,
+                            std::unique_ptr<AdFilterEngine> engine) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  // A newer Load() call supersedes this one.
+  if (path != path_) {
+    return;
+  }
+  UMA_HISTOGRAM_BOOLEAN("Whale.ITP.AdFilterList.Loaded", !!engine);
+  if (!engine) {
+    return;
+  }
+  UMA_HISTOGRAM_COUNTS_1M("Whale.ITP.AdFilterList.FilterCount",
+                          engine->filter_count());
+  engine_ = std::move(engine);
+  ++generation_;
+}
+
+}  // namespace whale_blocker
@@ -0,0 +1,71 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_AD_FILTER_LIST_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_AD_FILTER_LIST_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "base/files/file_path.h"
+#include "base/memory/weak_ptr.h"
+#include "base/no_destructor.h"
+#include "base/sequence_checker.h"
+#include "base/strings/string_piece.h"
+#include "whale/components/tracking_blockers/common/ad_filter_engine.h"
+
+class GURL;
+
+namespace whale_blocker {
+
+// Process-wide ad filter list used by the browser-side request proxy. The
+// compiled list file is mapped on a background sequence; until it is
+// available nothing matches. Must be used on the UI thread.
+class AdFilterList {
+ public:
+  static AdFilterList* GetInstance();
+
+  AdFilterList(const AdFilterList&) = delete;
+  AdFilterList& operator=(const AdFilterList&) = delete;
+
+  // Maps |path| in the background and swaps it in once ready. Does nothing
+  // if |path| is already loaded or being loaded.
+  void Load(const base::FilePath& path);
+
+  // See AdFilterEngine::Match().
+  AdFilterEngine::Decision Match(const GURL& url,
+                                 base::StringPiece source_host,
+                                 AdFilterEngine::ResourceType resource_type,
+                                 bool third_party) const;
+
+  bool is_loaded() const { return !!engine_; }
+
+  // Incremented whenever the list is swapped, so that cached decisions can
+  // be dropped.
+  uint64_t generation() const { return generation_; }
+
+  void SetEngineForTesting(std::unique_ptr<AdFilterEngine> engine);
+
+ private:
+  friend class base::NoDestructor<AdFilterList>;
+
+  AdFilterList();
+  ~AdFilterList();
+
+  void OnLoaded(const base::FilePath& path,
+                std::unique_ptr<AdFilterEngine> engine);
+
+  base::FilePath path_;
+  uint64_t generation_ = 0;
+  std::unique_ptr<AdFilterEngine> engine_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  base::WeakPtrFactory<AdFilterList> weak_factory_{this};
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_AD_FILTER_LIST_H_
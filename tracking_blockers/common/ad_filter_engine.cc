@@ -0,0 +1,607 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/ad_filter_engine.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "url/gurl.h"
+
+namespace whale_blocker {
+
+namespace {
+
+enum FilterFlags : uint16_t {
+  kHostAnchor = 1 << 0,
+  kLeftAnchor = 1 << 1,
+  kRightAnchor = 1 << 2,
+  kMatchCase = 1 << 3,
+  kThirdPartyOnly = 1 << 4,
+  kFirstPartyOnly = 1 << 5,
+};
+
+// Bucket for filters without a usable token; checked for every request.
+constexpr uint32_t kFallbackToken = 0;
+
+// URL tokens past this are not looked up.
+constexpr size_t kMaxURLTokens = 128;
+
+constexpr struct {
+  const char* name;
+  uint32_t type;
+} kTypeOptions[] = {
+    {"other", AdFilterEngine::kOther},
+    {"script", AdFilterEngine::kScript},
+    {"image", AdFilterEngine::kImage},
+    {"stylesheet", AdFilterEngine::kStylesheet},
+    {"css", AdFilterEngine::kStylesheet},
+    {"xmlhttprequest", AdFilterEngine::kXmlHttpRequest},
+    {"xhr", AdFilterEngine::kXmlHttpRequest},
+    {"subdocument", AdFilterEngine::kSubdocument},
+    {"frame", AdFilterEngine::kSubdocument},
+    {"ping", AdFilterEngine::kPing},
+    {"beacon", AdFilterEngine::kPing},
+    {"media", AdFilterEngine::kMedia},
+    {"font", AdFilterEngine::kFont},
+    {"websocket", AdFilterEngine::kWebSocket},
+};
+
+bool IsTokenChar(char c) {
+  return base::IsAsciiAlpha(c) || base::IsAsciiDigit(c);
+}
+
+// Characters "^" matches, besides the end of the URL.
+bool IsSeparator(char c) {
+  return !IsTokenChar(c) && c != '_' && c != '-' && c != '.' && c != '%';
+}
+
+uint32_t HashToken(base::StringPiece token) {
+  // FNV-1a over the lowercased token.
+  uint32_t hash = 2166136261u;
+  for (char c : token) {
+    hash ^= static_cast<uint8_t>(base::ToLowerASCII(c));
+    hash *= 16777619u;
+  }
+  return hash == kFallbackToken ? 1 : hash;
+}
+
+struct ParsedFilter {
+  bool exception = false;
+  std::string pattern;
+  uint16_t flags = 0;
+  uint32_t type_mask = AdFilterEngine::kAllTypes;
+  std::vector<std::pair<std::string, bool>> domains;
+  std::vector<uint32_t> candidate_tokens;
+  uint32_t token = kFallbackToken;
+};
+
+bool ParseOptions(base::StringPiece options, ParsedFilter* filter) {
+  uint32_t included_types = 0;
+  uint32_t excluded_types = 0;
+  for (base::StringPiece option : base::SplitStringPiece(
+           options, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    const std::string name = base::ToLowerASCII(option);
+    if (name == "third-party" || name == "3p") {
+      filter->flags |= kThirdPartyOnly;
+      continue;
+    }
+    if (name == "~third-party" || name == "first-party" || name == "1p") {
+      filter->flags |= kFirstPartyOnly;
+      continue;
+    }
+    if (name == "match-case") {
+      filter->flags |= kMatchCase;
+      continue;
+    }
+    if (base::StartsWith(name, "domain=")) {
+      for (base::StringPiece domain :
+           base::SplitStringPiece(base::StringPiece(name).substr(7), "|",
+                                  base::TRIM_WHITESPACE,
+                                  base::SPLIT_WANT_NONEMPTY)) {
+        const bool negated = domain.front() == '~';
+        if (negated) {
+          domain.remove_prefix(1);
+        }
+        if (domain.empty()) {
+          return false;
+        }
+        filter->domains.emplace_back(std::string(domain), negated);
+      }
+      continue;
+    }
+
+    const bool negated = name.front() == '~';
+    const base::StringPiece type_name =
+        base::StringPiece(name).substr(negated ? 1 : 0);
+    const auto* it = std::find_if(
+        std::begin(kTypeOptions), std::end(kTypeOptions),
+        [type_name](const auto& entry) { return type_name == entry.name; });
+    if (it == std::end(kTypeOptions)) {
+      // Unknown options may narrow the filter in ways we can't honor. A
+      // blocking filter is dropped rather than applied too broadly, which
+      // could break pages. An exception is kept without the option: allowing
+      // more than intended is the safer error there.
+      if (filter->exception) {
+        continue;
+      }
+      return false;
+    }
+    (negated ? excluded_types : included_types) |= it->type;
+  }
+
+  if (included_types) {
+    filter->type_mask = included_types;
+  }
+  filter->type_mask &= ~excluded_types;
+  return filter->type_mask != 0;
+}
+
+bool ParseFilter(base::StringPiece line, ParsedFilter* filter) {
+  line = base::TrimWhitespaceASCII(line, base::TRIM_ALL);
+  if (line.empty() || line.front() == '!' || line.front() == '[') {
+    return false;
+  }
+  if (line.find("##") != base::StringPiece::npos ||
+      line.find("#@#") != base::StringPiece::npos ||
+      line.find("#?#") != base::StringPiece::npos ||
+      line.find("#$#") != base::StringPiece::npos) {
+    // Cosmetic filter.
+    return false;
+  }
+
+  if (base::StartsWith(line, "@@")) {
+    filter->exception = true;
+    line.remove_prefix(2);
+  }
+
+  const size_t options_start = line.rfind('$');
+  if (options_start != base::StringPiece::npos) {
+    if (!ParseOptions(line.substr(options_start + 1), filter)) {
+      return false;
+    }
+    line = line.substr(0, options_start);
+  }
+
+  if (line.size() > 2 && line.front() == '/' && line.back() == '/') {
+    // Regular expression filters aren't supported.
+    return false;
+  }
+
+  if (base::StartsWith(line, "||")) {
+    filter->flags |= kHostAnchor;
+    line.remove_prefix(2);
+  } else if (base::StartsWith(line, "|")) {
+    filter->flags |= kLeftAnchor;
+    line.remove_prefix(1);
+  }
+  if (base::EndsWith(line, "|")) {
+    filter->flags |= kRightAnchor;
+    line.remove_suffix(1);
+  }
+
+  // Leading and trailing wildcards don't change what an unanchored filter
+  // matches.
+  if (!(filter->flags & (kHostAnchor | kLeftAnchor))) {
+    while (!line.empty() && line.front() == '*') {
+      line.remove_prefix(1);
+    }
+  }
+  if (!(filter->flags & kRightAnchor)) {
+    while (!line.empty() && line.back() == '*') {
+      line.remove_suffix(1);
+    }
+  }
+  if ((line.empty() && filter->domains.empty()) ||
+      line.size() > std::numeric_limits<uint16_t>::max()) {
+    // Would match every request, or doesn't fit the serialized form.
+    return false;
+  }
+
+  filter->pattern = filter->flags & kMatchCase ? std::string(line)
+                                               : base::ToLowerASCII(line);
+
+  // A token can only be used for the index if the URL is guaranteed to
+  // contain it as a whole token, i.e. it isn't next to a wildcard or an
+  // unanchored end of the pattern.
+  const std::string& pattern = filter->pattern;
+  size_t pos = 0;
+  while (pos < pattern.size()) {
+    if (!IsTokenChar(pattern[pos])) {
+      ++pos;
+      continue;
+    }
+    const size_t begin = pos;
+    while (pos < pattern.size() && IsTokenChar(pattern[pos])) {
+      ++pos;
+    }
+    const bool bounded_before =
+        begin == 0 ? !!(filter->flags & (kHostAnchor | kLeftAnchor))
+                   : pattern[begin - 1] != '*';
+    const bool bounded_after = pos == pattern.size()
+                                   ? !!(filter->flags & kRightAnchor)
+                                   : pattern[pos] != '*';
+    if (pos - begin >= 2 && bounded_before && bounded_after) {
+      filter->candidate_tokens.push_back(
+          HashToken(base::StringPiece(pattern).substr(begin, pos - begin)));
+    }
+  }
+  return true;
+}
+
+template <typename T>
+void AppendPod(std::vector<uint8_t>* out, const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool TakeSpan(base::span<const uint8_t>* data,
+              size_t count,
+              base::span<const T>* out) {
+  if (count > data->size() / sizeof(T)) {
+    return false;
+  }
+  *out = base::make_span(reinterpret_cast<const T*>(data->data()), count);
+  *data = data->subspan(count * sizeof(T));
+  return true;
+}
+
+// Iterative glob match of |pattern| against |text| where "*" matches any run
+// of characters and "^" matches a separator or the end of |text|. If
+// |anchored_start| is false the match may begin anywhere in |text|; unless
+// |anchored_end| it may end anywhere.
+bool GlobMatch(base::StringPiece pattern,
+               base::StringPiece text,
+               bool anchored_start,
+               bool anchored_end,
+               bool match_case) {
+  size_t p = 0;
+  size_t t = 0;
+  size_t star_p = anchored_start ? base::StringPiece::npos : 0;
+  size_t star_t = 0;
+  while (true) {
+    if (p == pattern.size()) {
+      if (!anchored_end || t == text.size()) {
+        return true;
+      }
+    } else if (pattern[p] == '*') {
+      star_p = ++p;
+      star_t = t;
+      continue;
+    } else if (t < text.size()) {
+      const char pc = pattern[p];
+      const char tc = match_case ? text[t] : base::ToLowerASCII(text[t]);
+      if (pc == tc || (pc == '^' && IsSeparator(tc))) {
+        ++p;
+        ++t;
+        continue;
+      }
+    } else if (pattern[p] == '^') {
+      ++p;
+      continue;
+    }
+
+    if (star_p == base::StringPiece::npos || star_t >= text.size()) {
+      return false;
+    }
+    p = star_p;
+    t = ++star_t;
+  }
+}
+
+}  // namespace
+
+struct AdFilterEngine::Request {
+  base::StringPiece url;
+  size_t host_begin;
+  size_t host_end;
+  base::StringPiece source_host;
+  uint32_t resource_type;
+  bool third_party;
+};
+
+AdFilterEngine::AdFilterEngine() = default;
+AdFilterEngine::~AdFilterEngine() = default;
+
+// static
+std::vector<uint8_t> AdFilterEngine::Build(
+    const std::vector<std::string>& lines,
+    size_t* rejected) {
+  std::vector<ParsedFilter> parsed;
+  parsed.reserve(lines.size());
+  size_t rejected_count = 0;
+  for (const auto& line : lines) {
+    ParsedFilter filter;
+    if (ParseFilter(line, &filter)) {
+      parsed.push_back(std::move(filter));
+    } else if (!base::TrimWhitespaceASCII(line, base::TRIM_ALL).empty() &&
+               line.front() != '!' && line.front() != '[' &&
+               line.find('#') == std::string::npos) {
+      ++rejected_count;
+    }
+  }
+  if (rejected) {
+    *rejected = rejected_count;
+  }
+
+  // Bucket every filter by its least common token so that the buckets of
+  // frequent tokens ("com", "www", "js") stay small.
+  std::unordered_map<uint32_t, size_t> token_counts;
+  for (const auto& filter : parsed) {
+    for (uint32_t token : filter.candidate_tokens) {
+      ++token_counts[token];
+    }
+  }
+  std::map<uint32_t, std::vector<const ParsedFilter*>> block_buckets;
+  std::map<uint32_t, std::vector<const ParsedFilter*>> allow_buckets;
+  for (auto& filter : parsed) {
+    size_t best_count = std::numeric_limits<size_t>::max();
+    for (uint32_t token : filter.candidate_tokens) {
+      if (token_counts[token] < best_count) {
+        best_count = token_counts[token];
+        filter.token = token;
+      }
+    }
+    (filter.exception ? allow_buckets : block_buckets)[filter.token].push_back(
+        &filter);
+  }
+
+  std::vector<Bucket> buckets;
+  std::vector<Filter> filters;
+  std::vector<Domain> domains;
+  std::string strings;
+  auto append_string = [&strings](base::StringPiece value) {
+    const uint32_t offset = base::checked_cast<uint32_t>(strings.size());
+    strings.append(value.data(), value.size());
+    return offset;
+  };
+  for (const auto* group : {&block_buckets, &allow_buckets}) {
+    for (const auto& [token, bucket_filters] : *group) {
+      buckets.push_back({token, base::checked_cast<uint32_t>(filters.size()),
+                         base::checked_cast<uint32_t>(bucket_filters.size())});
+      for (const ParsedFilter* filter : bucket_filters) {
+        filters.push_back(
+            {append_string(filter->pattern),
+             base::checked_cast<uint32_t>(domains.size()), filter->type_mask,
+             base::checked_cast<uint16_t>(filter->pattern.size()),
+             base::checked_cast<uint16_t>(filter->domains.size()),
+             filter->flags, 0});
+        for (const auto& [domain, negated] : filter->domains) {
+          domains.push_back({append_string(domain),
+                             base::checked_cast<uint16_t>(domain.size()),
+                             negated});
+        }
+      }
+    }
+  }
+
+  std::vector<uint8_t> out;
+  AppendPod(&out,
+            Header{kMagic, kVersion,
+                   base::checked_cast<uint32_t>(block_buckets.size()),
+                   base::checked_cast<uint32_t>(allow_buckets.size()),
+                   base::checked_cast<uint32_t>(filters.size()),
+                   base::checked_cast<uint32_t>(domains.size()),
+                   base::checked_cast<uint32_t>(strings.size())});
+  for (const Bucket& bucket : buckets) {
+    AppendPod(&out, bucket);
+  }
+  for (const Filter& filter : filters) {
+    AppendPod(&out, filter);
+  }
+  for (const Domain& domain : domains) {
+    AppendPod(&out, domain);
+  }
+  out.insert(out.end(), strings.begin(), strings.end());
+  return out;
+}
+
+// static
+std::unique_ptr<AdFilterEngine> AdFilterEngine::CreateFromFile(
+    const base::FilePath& path) {
+  auto mapped_file = std::make_unique<base::MemoryMappedFile>();
+  if (!mapped_file->Initialize(path)) {
+    return nullptr;
+  }
+  auto engine = base::WrapUnique(new AdFilterEngine());
+  engine->mapped_file_ = std::move(mapped_file);
+  if (!engine->Init(engine->mapped_file_->bytes())) {
+    LOG(ERROR) << "Invalid ad filter list: " << path;
+    return nullptr;
+  }
+  return engine;
+}
+
+// static
+std::unique_ptr<AdFilterEngine> AdFilterEngine::CreateFromBuffer(
+    base::span<const uint8_t> data) {
+  auto engine = base::WrapUnique(new AdFilterEngine());
+  engine->owned_data_.assign(data.begin(), data.end());
+  if (!engine->Init(engine->owned_data_)) {
+    return nullptr;
+  }
+  return engine;
+}
+
+bool AdFilterEngine::Init(base::span<const uint8_t> data) {
+  if (data.size() < sizeof(Header) ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(Header) != 0) {
+    return false;
+  }
+  const Header* header = reinterpret_cast<const Header*>(data.data());
+  if (header->magic != kMagic || header->version != kVersion) {
+    return false;
+  }
+  data = data.subspan(sizeof(Header));
+  if (!TakeSpan(&data, header->block_bucket_count, &block_buckets_) ||
+      !TakeSpan(&data, header->allow_bucket_count, &allow_buckets_) ||
+      !TakeSpan(&data, header->filter_count, &filters_) ||
+      !TakeSpan(&data, header->domain_count, &domains_) ||
+      data.size() != header->string_bytes) {
+    return false;
+  }
+  strings_ = base::StringPiece(reinterpret_cast<const char*>(data.data()),
+                               data.size());
+
+  // Validate once here so that matching doesn't need bounds checks.
+  for (const auto buckets : {block_buckets_, allow_buckets_}) {
+    for (const Bucket& bucket : buckets) {
+      if (size_t{bucket.first_filter} + bucket.filter_count >
+          filters_.size()) {
+        return false;
+      }
+    }
+  }
+  for (const Filter& filter : filters_) {
+    if (size_t{filter.pattern_offset} + filter.pattern_length >
+            strings_.size() ||
+        size_t{filter.first_domain} + filter.domain_count > domains_.size()) {
+      return false;
+    }
+  }
+  for (const Domain& domain : domains_) {
+    if (size_t{domain.offset} + domain.length > strings_.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+AdFilterEngine::Decision AdFilterEngine::Match(const GURL& url,
+                                               base::StringPiece source_host,
+                                               ResourceType resource_type,
+                                               bool third_party) const {
+  if (!url.is_valid() || filters_.empty()) {
+    return Decision::kNoMatch;
+  }
+
+  const url::Component host = url.parsed_for_possibly_invalid_spec().host;
+  const Request request{url.possibly_invalid_spec(),
+                        static_cast<size_t>(host.begin),
+                        static_cast<size_t>(host.end()),
+                        source_host,
+                        resource_type,
+                        third_party};
+
+  std::array<uint32_t, kMaxURLTokens + 1> tokens;
+  size_t token_count = 0;
+  tokens[token_count++] = kFallbackToken;
+  const base::StringPiece spec = request.url;
+  size_t pos = 0;
+  while (pos < spec.size() && token_count < tokens.size()) {
+    if (!IsTokenChar(spec[pos])) {
+      ++pos;
+      continue;
+    }
+    const size_t begin = pos;
+    while (pos < spec.size() && IsTokenChar(spec[pos])) {
+      ++pos;
+    }
+    if (pos - begin >= 2) {
+      tokens[token_count++] = HashToken(spec.substr(begin, pos - begin));
+    }
+  }
+  const auto url_tokens = base::make_span(tokens).first(token_count);
+
+  if (!AnyFilterMatches(block_buckets_, url_tokens, request)) {
+    return Decision::kNoMatch;
+  }
+  return AnyFilterMatches(allow_buckets_, url_tokens, request)
+             ? Decision::kAllow
+             : Decision::kBlock;
+}
+
+bool AdFilterEngine::AnyFilterMatches(base::span<const Bucket> buckets,
+                                      base::span<const uint32_t> tokens,
+                                      const Request& request) const {
+  for (uint32_t token : tokens) {
+    auto it = std::lower_bound(
+        buckets.begin(), buckets.end(), token,
+        [](const Bucket& bucket, uint32_t value) {
+          return bucket.token < value;
+        });
+    if (it == buckets.end() || it->token != token) {
+      continue;
+    }
+    for (const Filter& filter :
+         filters_.subspan(it->first_filter, it->filter_count)) {
+      if (FilterMatches(filter, request)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool AdFilterEngine::FilterMatches(const Filter& filter,
+                                   const Request& request) const {
+  if (!(filter.type_mask & request.resource_type)) {
+    return false;
+  }
+  if ((filter.flags & kThirdPartyOnly) && !request.third_party) {
+    return false;
+  }
+  if ((filter.flags & kFirstPartyOnly) && request.third_party) {
+    return false;
+  }
+
+  if (filter.domain_count) {
+    bool has_included = false;
+    bool included = false;
+    for (const Domain& domain :
+         domains_.subspan(filter.first_domain, filter.domain_count)) {
+      const base::StringPiece name =
+          strings_.substr(domain.offset, domain.length);
+      const bool matches =
+          request.source_host == name ||
+          (request.source_host.size() > name.size() &&
+           base::EndsWith(request.source_host, name) &&
+           request.source_host[request.source_host.size() - name.size() -
+                               1] == '.');
+      if (domain.negated) {
+        if (matches) {
+          return false;
+        }
+      } else {
+        has_included = true;
+        included |= matches;
+      }
+    }
+    if (has_included && !included) {
+      return false;
+    }
+  }
+
+  const base::StringPiece pattern =
+      strings_.substr(filter.pattern_offset, filter.pattern_length);
+  const bool match_case = filter.flags & kMatchCase;
+  const bool anchored_end = filter.flags & kRightAnchor;
+  if (filter.flags & kHostAnchor) {
+    // "||" matches at the start of the host or of any of its labels.
+    for (size_t start = request.host_begin; start < request.host_end;
+         ++start) {
+      if ((start == request.host_begin || request.url[start - 1] == '.') &&
+          GlobMatch(pattern, request.url.substr(start), true, anchored_end,
+                    match_case)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return GlobMatch(pattern, request.url, filter.flags & kLeftAnchor,
+                   anchored_end, match_case);
+}
+
+}  // namespace whale_blocker
@@ -0,0 +1,153 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_AD_FILTER_ENGINE_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_AD_FILTER_ENGINE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/strings/string_piece.h"
+
+class GURL;
+
+namespace base {
+class FilePath;
+}
+
+namespace whale_blocker {
+
+// Network filter engine for the Adblock Plus / uBlock Origin list syntax.
+//
+// Supported: "||" host anchors, "|" start/end anchors, "*" and "^", "@@"
+// exceptions and the $third-party, $first-party, $domain=, $match-case and
+// resource type options. Cosmetic, regex and blocking filters with unknown
+// options are skipped when building; exceptions ignore unknown options.
+//
+// Every filter is stored in the bucket of its rarest URL token so that a
+// request only evaluates the buckets of the tokens in its own URL. The
+// engine is serialized into a flat buffer that is queried in place, so a
+// compiled list file can be memory-mapped instead of parsed at startup.
+//
+// Layout (little-endian, 4-byte aligned):
+//   Header
+//   Bucket[block_bucket_count]  sorted by token
+//   Bucket[allow_bucket_count]  sorted by token
+//   Filter[filter_count]        the filters of a bucket are contiguous
+//   Domain[domain_count]        $domain= entries referenced by filters
+//   char[string_bytes]          patterns and domains
+class AdFilterEngine {
+ public:
+  static constexpr uint32_t kMagic = 0x46415457;  // "WTAF"
+  static constexpr uint32_t kVersion = 1;
+
+  // Bitmask of request types a filter applies to.
+  enum ResourceType : uint32_t {
+    kOther = 1 << 0,
+    kScript = 1 << 1,
+    kImage = 1 << 2,
+    kStylesheet = 1 << 3,
+    kXmlHttpRequest = 1 << 4,
+    kSubdocument = 1 << 5,
+    kPing = 1 << 6,
+    kMedia = 1 << 7,
+    kFont = 1 << 8,
+    kWebSocket = 1 << 9,
+    kAllTypes = (1 << 10) - 1,
+  };
+
+  enum class Decision {
+    kNoMatch,
+    kBlock,
+    // A blocking filter matched but so did an "@@" exception.
+    kAllow,
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_bucket_count;
+    uint32_t allow_bucket_count;
+    uint32_t filter_count;
+    uint32_t domain_count;
+    uint32_t string_bytes;
+  };
+
+  struct Bucket {
+    uint32_t token;
+    uint32_t first_filter;
+    uint32_t filter_count;
+  };
+
+  struct Filter {
+    uint32_t pattern_offset;
+    uint32_t first_domain;
+    uint32_t type_mask;
+    uint16_t pattern_length;
+    uint16_t domain_count;
+    uint16_t flags;
+    uint16_t reserved;
+  };
+
+  struct Domain {
+    uint32_t offset;
+    uint16_t length;
+    uint16_t negated;
+  };
+
+  AdFilterEngine(const AdFilterEngine&) = delete;
+  AdFilterEngine& operator=(const AdFilterEngine&) = delete;
+  ~AdFilterEngine();
+
+  // Compiles filter list |lines| into the format above. |rejected|, if set,
+  // receives the number of network filters that couldn't be used.
+  static std::vector<uint8_t> Build(const std::vector<std::string>& lines,
+                                    size_t* rejected = nullptr);
+
+  // Return nullptr if the data can't be read or isn't a valid engine.
+  static std::unique_ptr<AdFilterEngine> CreateFromFile(
+      const base::FilePath& path);
+  // |data| is copied.
+  static std::unique_ptr<AdFilterEngine> CreateFromBuffer(
+      base::span<const uint8_t> data);
+
+  // Matches a request for |url| made by a document on |source_host|.
+  // |resource_type| is a single ResourceType bit. Doesn't allocate.
+  Decision Match(const GURL& url,
+                 base::StringPiece source_host,
+                 ResourceType resource_type,
+                 bool third_party) const;
+
+  size_t filter_count() const { return filters_.size(); }
+
+ private:
+  struct Request;
+
+  AdFilterEngine();
+
+  bool Init(base::span<const uint8_t> data);
+  bool AnyFilterMatches(base::span<const Bucket> buckets,
+                        base::span<const uint32_t> tokens,
+                        const Request& request) const;
+  bool FilterMatches(const Filter& filter, const Request& request) const;
+
+  // One of these owns the bytes the spans below point into.
+  std::unique_ptr<base::MemoryMappedFile> mapped_file_;
+  std::vector<uint8_t> owned_data_;
+
+  base::span<const Bucket> block_buckets_;
+  base::span<const Bucket> allow_buckets_;
+  base::span<const Filter> filters_;
+  base::span<const Domain> domains_;
+  base::StringPiece strings_;
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_AD_FILTER_ENGINE_H_
@@ -0,0 +1,97 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/exemption_table.h"
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "base/memory/ptr_util.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracker_domain_trie.h"
+
+namespace whale_blocker {
+
+namespace {
+
+constexpr struct {
+  const char* name;
+  ExemptionFeature feature;
+} kFeatureNames[] = {
+    {"query-filter", ExemptionFeature::kQueryFilter},
+    {"referrer", ExemptionFeature::kReferrer},
+    {"blocking", ExemptionFeature::kBlocking},
+};
+
+// Built-in exemptions.
+// https://oss.navercorp.com/whale/whale/pull/36178
+constexpr char kDefaultExemptions[] =
+    "query-filter naver.com\n"
+    "referrer naver.com\n";
+
+}  // namespace
+
+ExemptionTable::ExemptionTable() = default;
+ExemptionTable::~ExemptionTable() = default;
+
+// static
+const ExemptionTable& ExemptionTable::GetDefault() {
+  static const ExemptionTable* const table =
+      CreateFromString(kDefaultExemptions).release();
+  return *table;
+}
+
+// static
+std::unique_ptr<ExemptionTable> ExemptionTable::CreateFromString(
+    base::StringPiece list) {
+  std::array<std::vector<std::string>, std::tuple_size<decltype(tries_)>()>
+      domains;
+  for (base::StringPiece line : base::SplitStringPiece(
+           list, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (line.front() == '#') {
+      continue;
+    }
+    std::vector<base::StringPiece> fields = base::SplitStringPiece(
+        line, " \t", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    if (fields.size() != 2) {
+      continue;
+    }
+    for (const auto& entry : kFeatureNames) {
+      if (fields[0] == entry.name) {
+        domains[static_cast<size_t>(entry.feature)].emplace_back(fields[1]);
+      }
+    }
+  }
+
+  auto table = base::WrapUnique(new ExemptionTable());
+  for (size_t i = 0; i < domains.size(); ++i) {
+    if (!domains[i].empty()) {
+      table->tries_[i] = TrackerDomainTrie::CreateFromBuffer(
+          TrackerDomainTrie::Build(domains[i]));
+    }
+  }
+  return table;
+}
+
+bool ExemptionTable::IsExempt(ExemptionFeature feature,
+                              base::StringPiece host) const {
+  if (!host.empty() && host.back() == '.') {
+    host.remove_suffix(1);
+  }
+  const auto& trie = tries_[static_cast<size_t>(feature)];
+  return trie && trie->Matches(host);
+}
+
+bool ExemptionTable::IsExempt(ExemptionFeature feature, const GURL& url) const {
+  return url.has_host() && IsExempt(feature, url.host_piece());
+}
+
+bool IsExempt(ExemptionFeature feature, const GURL& url) {
+  return ExemptionTable::GetDefault().IsExempt(feature, url);
+}
+
+}  // namespace whale_blocker
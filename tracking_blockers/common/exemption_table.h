@@ -0,0 +1,64 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_EXEMPTION_TABLE_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_EXEMPTION_TABLE_H_
+
+#include <array>
+#include <memory>
+
+#include "base/strings/string_piece.h"
+
+class GURL;
+
+namespace whale_blocker {
+
+class TrackerDomainTrie;
+
+// Tracking blocker features a domain can be exempted from.
+enum class ExemptionFeature {
+  // Tracking query parameters are kept on requests to the domain.
+  kQueryFilter,
+  // Referrers sent from the domain aren't capped.
+  kReferrer,
+  // Requests to the domain are never blocked by the tracker and ad lists.
+  kBlocking,
+  kMaxValue = kBlocking,
+};
+
+// Exempt domains per feature, each compiled into a reversed-label suffix
+// trie so that any number of domains costs one lookup per request. A domain
+// also exempts its subdomains. Immutable and safe to use on any thread.
+class ExemptionTable {
+ public:
+  ExemptionTable(const ExemptionTable&) = delete;
+  ExemptionTable& operator=(const ExemptionTable&) = delete;
+  ~ExemptionTable();
+
+  // The table in use, compiled from the built-in list on first use.
+  static const ExemptionTable& GetDefault();
+
+  // Compiles |list|, one "<feature> <domain>" entry per line where feature
+  // is "query-filter", "referrer" or "blocking". Lines starting with "#"
+  // and unknown features are ignored.
+  static std::unique_ptr<ExemptionTable> CreateFromString(
+      base::StringPiece list);
+
+  bool IsExempt(ExemptionFeature feature, base::StringPiece host) const;
+  bool IsExempt(ExemptionFeature feature, const GURL& url) const;
+
+ private:
+  ExemptionTable();
+
+  std::array<std::unique_ptr<TrackerDomainTrie>,
+             static_cast<size_t>(ExemptionFeature::kMaxValue) + 1>
+      tries_;
+};
+
+// Shorthand for ExemptionTable::GetDefault().IsExempt(feature, url).
+bool IsExempt(ExemptionFeature feature, const GURL& url);
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_EXEMPTION_TABLE_H_
@@ -0,0 +1,36 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/features.h"
+
+namespace whale_blocker {
+namespace features {
+
+BASE_FEATURE(kTrackingBlockerInNetworkService,
+             "TrackingBlockerInNetworkService",
+             base::FEATURE_DISABLED_BY_DEFAULT);
+
+BASE_FEATURE(kProxiedRequestAdmissionControl,
+             "ProxiedRequestAdmissionControl",
+             base::FEATURE_DISABLED_BY_DEFAULT);
+
+const base::FeatureParam<int> kMaxActiveProxiedRequests{
+    &kProxiedRequestAdmissionControl, "max_active_requests", 256};
+
+const base::FeatureParam<int> kMaxQueuedProxiedRequests{
+    &kProxiedRequestAdmissionControl, "max_queued_requests", 1024};
+
+BASE_FEATURE(kBoundedBlockedResourceStore,
+             "BoundedBlockedResourceStore",
+             base::FEATURE_ENABLED_BY_DEFAULT);
+
+const base::FeatureParam<int> kMaxStoredBlockedResources{
+    &kBoundedBlockedResourceStore, "max_stored_resources", 500};
+
+BASE_FEATURE(kPersistentBlockingStats,
+             "PersistentBlockingStats",
+             base::FEATURE_ENABLED_BY_DEFAULT);
+
+}  // namespace features
+}  // namespace whale_blocker
@@ -0,0 +1,40 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_FEATURES_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_FEATURES_H_
+
+#include "base/feature_list.h"
+#include "base/metrics/field_trial_params.h"
+
+namespace whale_blocker {
+namespace features {
+
+// Applies the query filter and referrer capping in the network service
+// instead of proxying subresource factories through the browser process.
+// The tracker and ad filter lists aren't applied to those requests, so this
+// is only for configurations that don't ship them.
+BASE_DECLARE_FEATURE(kTrackingBlockerInNetworkService);
+
+// Bounds the number of requests WhaleProxyingURLLoaderFactory runs at once.
+// A request counts until its response headers arrive. Requests over
+// |kMaxActiveProxiedRequests| wait in a priority queue, and requests over
+// |kMaxQueuedProxiedRequests| fail with ERR_INSUFFICIENT_RESOURCES.
+BASE_DECLARE_FEATURE(kProxiedRequestAdmissionControl);
+extern const base::FeatureParam<int> kMaxActiveProxiedRequests;
+extern const base::FeatureParam<int> kMaxQueuedProxiedRequests;
+
+// Caps the blocked resources WhaleShieldsDataController stores per tab and
+// kind; blocks past |kMaxStoredBlockedResources| are counted but not listed.
+BASE_DECLARE_FEATURE(kBoundedBlockedResourceStore);
+extern const base::FeatureParam<int> kMaxStoredBlockedResources;
+
+// Keeps lifetime per-day counts of blocked ads and trackers in the profile
+// directory.
+BASE_DECLARE_FEATURE(kPersistentBlockingStats);
+
+}  // namespace features
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_FEATURES_H_
@@ -0,0 +1,28 @@
+/* Copyright (c) 2022 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_QUERY_STRING_FILTER_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_QUERY_STRING_FILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+class GURL;
+
+namespace whale_blocker {
+
+// Returns |original_url| with known tracking query parameters removed, or
+// nullopt if nothing was stripped. The names of the removed parameters are
+// appended to |removed_tracker|. Has no browser-side dependencies so that it
+// can also run inside the network service.
+absl::optional<GURL> ApplyQueryFilter(
+    const GURL& original_url,
+    std::vector<std::string>& removed_tracker);
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_QUERY_STRING_FILTER_H_
@@ -0,0 +1,110 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/registrable_domain_cache.h"
+
+#include <list>
+#include <map>
+#include <utility>
+
+#include "base/metrics/histogram_macros.h"
+#include "base/no_destructor.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+namespace whale_blocker {
+
+namespace {
+
+constexpr size_t kMaxCachedHosts = 1024;
+
+class RegistrableDomainCache {
+ public:
+  RegistrableDomainCache() = default;
+  RegistrableDomainCache(const RegistrableDomainCache&) = delete;
+  RegistrableDomainCache& operator=(const RegistrableDomainCache&) = delete;
+
+  static RegistrableDomainCache& GetInstance() {
+    static base::NoDestructor<RegistrableDomainCache> instance;
+    return *instance;
+  }
+
+  std::string Get(base::StringPiece host) {
+    {
+      base::AutoLock lock(lock_);
+      // Looked up by |host| itself; only a miss copies it into a key.
+      auto it = index_.find(host);
+      if (it != index_.end()) {
+        UMA_HISTOGRAM_BOOLEAN("Whale.ITP.RegistrableDomainCache.Hit", true);
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+      }
+    }
+    UMA_HISTOGRAM_BOOLEAN("Whale.ITP.RegistrableDomainCache.Hit", false);
+
+    // Look up outside of the lock; a racing thread computes the same value.
+    std::string domain = net::registry_controlled_domains::GetDomainAndRegistry(
+        host, net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+    base::AutoLock lock(lock_);
+    if (index_.find(host) == index_.end()) {
+      entries_.emplace_front(std::string(host), domain);
+      index_.emplace(entries_.front().first, entries_.begin());
+      if (entries_.size() > kMaxCachedHosts) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+      }
+    }
+    return domain;
+  }
+
+ private:
+  // Host and registrable domain, most recently used first.
+  using Entries = std::list<std::pair<std::string, std::string>>;
+
+  base::Lock lock_;
+  Entries entries_ GUARDED_BY(lock_);
+  // Keys view the hosts owned by |entries_|, and the transparent comparator
+  // takes any StringPiece, so a lookup never allocates.
+  std::map<base::StringPiece, Entries::iterator, std::less<>> index_
+      GUARDED_BY(lock_);
+};
+
+}  // namespace
+
+std::string GetCachedDomainAndRegistry(base::StringPiece host) {
+  if (host.empty()) {
+    return std::string();
+  }
+  return RegistrableDomainCache::GetInstance().Get(host);
+}
+
+bool IsSameDomainOrHost(base::StringPiece host1, base::StringPiece host2) {
+  if (host1.empty() || host2.empty()) {
+    return false;
+  }
+  // Exact host matches don't need the registrable domain at all.
+  if (host1 == host2) {
+    return true;
+  }
+  const std::string domain1 = GetCachedDomainAndRegistry(host1);
+  return !domain1.empty() && domain1 == GetCachedDomainAndRegistry(host2);
+}
+
+bool IsSameDomainOrHost(const GURL& url1, const GURL& url2) {
+  return IsSameDomainOrHost(url1.host_piece(), url2.host_piece());
+}
+
+bool IsSameDomainOrHost(const url::Origin& origin, const GURL& url) {
+  return IsSameDomainOrHost(origin.host(), url.host_piece());
+}
+
+bool IsSameDomainOrHost(const url::Origin& origin1,
+                        const url::Origin& origin2) {
+  return IsSameDomainOrHost(origin1.host(), origin2.host());
+}
+
+}  // namespace whale_blocker
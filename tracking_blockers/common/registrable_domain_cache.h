@@ -0,0 +1,39 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_REGISTRABLE_DOMAIN_CACHE_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_REGISTRABLE_DOMAIN_CACHE_H_
+
+#include <string>
+
+#include "base/strings/string_piece.h"
+
+class GURL;
+
+namespace url {
+class Origin;
+}
+
+namespace whale_blocker {
+
+// Process-wide, thread-safe cache in front of the public suffix list. A
+// browsing session is dominated by a few hundred hosts, so most same-site
+// decisions on the request path are answered without a PSL lookup.
+
+// Same as net::registry_controlled_domains::GetDomainAndRegistry() for a
+// canonical |host| with private registries included. Returns an empty string
+// for hosts without a registrable domain, such as IP addresses.
+std::string GetCachedDomainAndRegistry(base::StringPiece host);
+
+// Same as net::registry_controlled_domains::SameDomainOrHost() with private
+// registries included.
+bool IsSameDomainOrHost(base::StringPiece host1, base::StringPiece host2);
+bool IsSameDomainOrHost(const GURL& url1, const GURL& url2);
+bool IsSameDomainOrHost(const url::Origin& origin, const GURL& url);
+bool IsSameDomainOrHost(const url::Origin& origin1,
+                        const url::Origin& origin2);
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_REGISTRABLE_DOMAIN_CACHE_H_
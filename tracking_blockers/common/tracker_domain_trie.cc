@@ -0,0 +1,206 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/tracker_domain_trie.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "base/containers/queue.h"
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+
+namespace whale_blocker {
+
+namespace {
+
+struct BuilderNode {
+  bool terminal = false;
+  std::map<std::string, BuilderNode> children;
+};
+
+template <typename T>
+void AppendPod(std::vector<uint8_t>* out, const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+}  // namespace
+
+TrackerDomainTrie::TrackerDomainTrie() = default;
+TrackerDomainTrie::~TrackerDomainTrie() = default;
+
+// static
+std::vector<uint8_t> TrackerDomainTrie::Build(
+    const std::vector<std::string>& domains) {
+  BuilderNode root;
+  for (const auto& domain : domains) {
+    const std::string host = base::ToLowerASCII(
+        base::TrimString(domain, ". \t\r\n", base::TRIM_ALL));
+    if (host.empty()) {
+      continue;
+    }
+    std::vector<base::StringPiece> labels = base::SplitStringPiece(
+        host, ".", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    BuilderNode* node = &root;
+    for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+      node = &node->children[std::string(*it)];
+      if (node->terminal) {
+        // A parent domain is already listed; deeper entries are redundant.
+        break;
+      }
+    }
+    node->terminal = true;
+    node->children.clear();
+  }
+
+  // Breadth-first layout keeps the children of each node contiguous; the
+  // std::map iteration order keeps them sorted.
+  std::vector<Node> nodes;
+  std::string labels;
+  base::queue<std::pair<const BuilderNode*, size_t>> pending;
+  nodes.push_back({0, 0, 0, 0, root.terminal});
+  pending.emplace(&root, 0);
+  while (!pending.empty()) {
+    auto [builder_node, index] = pending.front();
+    pending.pop();
+    nodes[index].first_child = base::checked_cast<uint32_t>(nodes.size());
+    nodes[index].child_count =
+        base::checked_cast<uint32_t>(builder_node->children.size());
+    for (const auto& [label, child] : builder_node->children) {
+      nodes.push_back({base::checked_cast<uint32_t>(labels.size()), 0, 0,
+                       base::checked_cast<uint16_t>(label.size()),
+                       child.terminal});
+      labels.append(label);
+      pending.emplace(&child, nodes.size() - 1);
+    }
+  }
+
+  std::vector<uint8_t> out;
+  out.reserve(sizeof(Header) + nodes.size() * sizeof(Node) + labels.size());
+  AppendPod(&out, Header{kMagic, kVersion,
+                         base::checked_cast<uint32_t>(nodes.size()),
+                         base::checked_cast<uint32_t>(labels.size())});
+  for (const Node& node : nodes) {
+    AppendPod(&out, node);
+  }
+  out.insert(out.end(), labels.begin(), labels.end());
+  return out;
+}
+
+// static
+std::unique_ptr<TrackerDomainTrie> TrackerDomainTrie::CreateFromFile(
+    const base::FilePath& path) {
+  auto mapped_file = std::make_unique<base::MemoryMappedFile>();
+  if (!mapped_file->Initialize(path)) {
+    return nullptr;
+  }
+  auto trie = base::WrapUnique(new TrackerDomainTrie());
+  trie->mapped_file_ = std::move(mapped_file);
+  if (!trie->Init(trie->mapped_file_->bytes())) {
+    LOG(ERROR) << "Invalid tracker domain list: " << path;
+    return nullptr;
+  }
+  return trie;
+}
+
+// static
+std::unique_ptr<TrackerDomainTrie> TrackerDomainTrie::CreateFromBuffer(
+    base::span<const uint8_t> data) {
+  auto trie = base::WrapUnique(new TrackerDomainTrie());
+  trie->owned_data_.assign(data.begin(), data.end());
+  if (!trie->Init(trie->owned_data_)) {
+    return nullptr;
+  }
+  return trie;
+}
+
+bool TrackerDomainTrie::Init(base::span<const uint8_t> data) {
+  if (data.size() < sizeof(Header) ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(Node) != 0) {
+    return false;
+  }
+  const Header* header = reinterpret_cast<const Header*>(data.data());
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->node_count == 0) {
+    return false;
+  }
+  const size_t nodes_size = size_t{header->node_count} * sizeof(Node);
+  if (data.size() - sizeof(Header) < nodes_size ||
+      data.size() - sizeof(Header) - nodes_size != header->label_bytes) {
+    return false;
+  }
+
+  nodes_ = base::make_span(
+      reinterpret_cast<const Node*>(data.data() + sizeof(Header)),
+      header->node_count);
+  labels_ = base::StringPiece(
+      reinterpret_cast<const char*>(data.data() + sizeof(Header) + nodes_size),
+      header->label_bytes);
+
+  // Validate once here so that lookups don't need bounds checks. This holds
+  // for leaves too, since FindChild() takes a subspan at |first_child|.
+  // Children come after their parent in the breadth-first layout, which also
+  // rules out cycles.
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const Node& node = nodes_[i];
+    if (size_t{node.label_offset} + node.label_length > labels_.size() ||
+        node.first_child <= i || node.first_child > nodes_.size() ||
+        node.child_count > nodes_.size() - node.first_child) {
+      return false;
+    }
+  }
+  return true;
+}
+
+base::StringPiece TrackerDomainTrie::LabelOf(const Node& node) const {
+  return labels_.substr(node.label_offset, node.label_length);
+}
+
+const TrackerDomainTrie::Node* TrackerDomainTrie::FindChild(
+    const Node& parent,
+    base::StringPiece label) const {
+  const auto children = nodes_.subspan(parent.first_child, parent.child_count);
+  auto it = std::lower_bound(
+      children.begin(), children.end(), label,
+      [this](const Node& node, base::StringPiece value) {
+        return LabelOf(node) < value;
+      });
+  if (it == children.end() || LabelOf(*it) != label) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+bool TrackerDomainTrie::Matches(base::StringPiece host) const {
+  if (host.empty() || nodes_.empty()) {
+    return false;
+  }
+
+  const Node* node = &nodes_[0];
+  size_t end = host.size();
+  while (true) {
+    const size_t dot = end == 0 ? base::StringPiece::npos
+                                : host.rfind('.', end - 1);
+    const size_t begin = dot == base::StringPiece::npos ? 0 : dot + 1;
+    node = FindChild(*node, host.substr(begin, end - begin));
+    if (!node) {
+      return false;
+    }
+    if (node->terminal) {
+      return true;
+    }
+    if (begin == 0) {
+      return false;
+    }
+    end = dot;
+  }
+}
+
+}  // namespace whale_blocker
@@ -0,0 +1,92 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKER_DOMAIN_TRIE_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKER_DOMAIN_TRIE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+class FilePath;
+}
+
+namespace whale_blocker {
+
+// Read-only suffix trie over reversed host labels ("com" -> "tracker" ->
+// "ads"), stored in a flat buffer that is queried in place, so a list file
+// can be memory-mapped instead of parsed at startup.
+//
+// Layout (little-endian, 4-byte aligned):
+//   Header
+//   Node[node_count]   node 0 is the root; the children of a node are
+//                      contiguous and sorted by label.
+//   char[label_bytes]  label storage referenced by the nodes.
+class TrackerDomainTrie {
+ public:
+  static constexpr uint32_t kMagic = 0x54445457;  // "WTDT"
+  static constexpr uint32_t kVersion = 1;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t label_bytes;
+  };
+
+  struct Node {
+    uint32_t label_offset;
+    uint32_t first_child;
+    uint32_t child_count;
+    uint16_t label_length;
+    // Non-zero if a listed domain ends at this node.
+    uint16_t terminal;
+  };
+
+  TrackerDomainTrie(const TrackerDomainTrie&) = delete;
+  TrackerDomainTrie& operator=(const TrackerDomainTrie&) = delete;
+  ~TrackerDomainTrie();
+
+  // Serializes |domains| into the format above. Entries are lowercased
+  // registrable domains or hosts; subdomains of an entry also match.
+  static std::vector<uint8_t> Build(const std::vector<std::string>& domains);
+
+  // Returns nullptr if |path| can't be mapped or isn't a valid trie.
+  static std::unique_ptr<TrackerDomainTrie> CreateFromFile(
+      const base::FilePath& path);
+  // |data| is copied.
+  static std::unique_ptr<TrackerDomainTrie> CreateFromBuffer(
+      base::span<const uint8_t> data);
+
+  // True if |host| or one of its parent domains is listed. |host| must be
+  // canonical (lowercase, no trailing dot).
+  bool Matches(base::StringPiece host) const;
+
+  size_t node_count() const { return nodes_.size(); }
+
+ private:
+  TrackerDomainTrie();
+
+  bool Init(base::span<const uint8_t> data);
+  base::StringPiece LabelOf(const Node& node) const;
+  const Node* FindChild(const Node& parent, base::StringPiece label) const;
+
+  // One of these owns the bytes |nodes_| and |labels_| point into.
+  std::unique_ptr<base::MemoryMappedFile> mapped_file_;
+  std::vector<uint8_t> owned_data_;
+
+  base::span<const Node> nodes_;
+  base::StringPiece labels_;
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKER_DOMAIN_TRIE_H_
@@ -0,0 +1,131 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_index.h"
+
+#include <utility>
+
+#include "base/containers/span.h"
+#include "base/ranges/algorithm.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/string_util.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "third_party/abseil-cpp/absl/container/inlined_vector.h"
+#include "url/gurl.h"
+
+namespace whale_blocker {
+
+namespace {
+
+// Splits off the last label of |host|, or all of it if there is no dot.
+base::StringPiece PopLastLabel(base::StringPiece* host) {
+  const size_t dot = host->rfind('.');
+  if (dot == base::StringPiece::npos) {
+    base::StringPiece label = *host;
+    *host = base::StringPiece();
+    return label;
+  }
+  base::StringPiece label = host->substr(dot + 1);
+  *host = host->substr(0, dot);
+  return label;
+}
+
+}  // namespace
+
+TrackingBlockerRulesIndex::Node::Node() = default;
+TrackingBlockerRulesIndex::Node::~Node() = default;
+
+TrackingBlockerRulesIndex::TrackingBlockerRulesIndex(
+    ContentSettingsForOneType rules)
+    : rules_(std::move(rules)) {
+  for (uint32_t i = 0; i < rules_.size(); ++i) {
+    AddRule(i);
+  }
+}
+
+TrackingBlockerRulesIndex::~TrackingBlockerRulesIndex() = default;
+
+// static
+bool TrackingBlockerRulesIndex::GetIndexedHost(
+    const ContentSettingsPattern& pattern,
+    std::string* host) {
+  *host = pattern.GetHost();
+  // Hosts the label walk in GetContentSetting() can't reproduce exactly are
+  // checked on every query instead.
+  return !host->empty() && !pattern.MatchesAllHosts() &&
+         !base::EndsWith(*host, ".") && *host == base::ToLowerASCII(*host);
+}
+
+void TrackingBlockerRulesIndex::AddRule(uint32_t index) {
+  const ContentSettingsPattern& pattern = rules_[index].primary_pattern;
+  std::string host;
+  if (!GetIndexedHost(pattern, &host)) {
+    unindexed_rules_.push_back(index);
+    return;
+  }
+
+  Node* node = &root_;
+  base::StringPiece rest = host;
+  while (!rest.empty()) {
+    base::StringPiece label = PopLastLabel(&rest);
+    auto it = node->children.find(label);
+    if (it == node->children.end()) {
+      it = node->children
+               .emplace(std::string(label), std::make_unique<Node>())
+               .first;
+    }
+    node = it->second.get();
+  }
+  (pattern.HasDomainWildcard() ? node->domain_rules : node->host_rules)
+      .push_back(index);
+}
+
+ContentSetting TrackingBlockerRulesIndex::GetContentSetting(
+    const GURL& primary_url) const {
+  // The candidate lists are each in rule order. They are merged while being
+  // checked, so that earlier rules take precedence as in the linear scan.
+  absl::InlinedVector<base::span<const uint32_t>, 8> candidates;
+  auto add_candidates = [&candidates](const std::vector<uint32_t>& rules) {
+    if (!rules.empty()) {
+      candidates.emplace_back(rules);
+    }
+  };
+  add_candidates(unindexed_rules_);
+
+  base::StringPiece rest = primary_url.host_piece();
+  if (base::EndsWith(rest, ".")) {
+    rest.remove_suffix(1);
+  }
+  const Node* node = &root_;
+  while (!rest.empty()) {
+    auto it = node->children.find(PopLastLabel(&rest));
+    if (it == node->children.end()) {
+      node = nullptr;
+      break;
+    }
+    node = it->second.get();
+    add_candidates(node->domain_rules);
+  }
+  if (node && node != &root_) {
+    add_candidates(node->host_rules);
+  }
+
+  while (!candidates.empty()) {
+    auto next = base::ranges::min_element(
+        candidates, {},
+        [](base::span<const uint32_t> rules) { return rules.front(); });
+    const uint32_t index = next->front();
+    *next = next->subspan(1);
+    if (next->empty()) {
+      *next = candidates.back();
+      candidates.pop_back();
+    }
+    if (rules_[index].primary_pattern.Matches(primary_url)) {
+      return rules_[index].GetContentSetting();
+    }
+  }
+  return CONTENT_SETTING_DEFAULT;
+}
+
+}  // namespace whale_blocker
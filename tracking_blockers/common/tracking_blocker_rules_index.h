@@ -0,0 +1,68 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKING_BLOCKER_RULES_INDEX_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKING_BLOCKER_RULES_INDEX_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/containers/flat_map.h"
+#include "components/content_settings/core/common/content_settings.h"
+
+class ContentSettingsPattern;
+class GURL;
+
+namespace whale_blocker {
+
+// Index over TRACKING_BLOCKER rules for
+// GetTrackingBlockerContentSettingFromRules(). Rules are filed under the
+// reversed labels of their primary pattern host ("com" -> "example"), so a
+// query only checks the rules for the URL's host and its parent domains,
+// plus the few rules without a host (e.g. the default "*" rule). The result
+// is the same as a linear scan: the first matching rule in |rules| order
+// wins. Build once per rules update; immutable afterwards.
+class TrackingBlockerRulesIndex {
+ public:
+  explicit TrackingBlockerRulesIndex(ContentSettingsForOneType rules);
+  TrackingBlockerRulesIndex(const TrackingBlockerRulesIndex&) = delete;
+  TrackingBlockerRulesIndex& operator=(const TrackingBlockerRulesIndex&) =
+      delete;
+  ~TrackingBlockerRulesIndex();
+
+  ContentSetting GetContentSetting(const GURL& primary_url) const;
+
+  // Sets |host| to the host |pattern| can be filed under, or returns false
+  // if the rule has to be checked for every URL.
+  static bool GetIndexedHost(const ContentSettingsPattern& pattern,
+                             std::string* host);
+
+  size_t rule_count() const { return rules_.size(); }
+
+ private:
+  struct Node {
+    Node();
+    ~Node();
+
+    base::flat_map<std::string, std::unique_ptr<Node>, std::less<>> children;
+    // Rules for exactly this host and for "[*.]" this domain, in rule order.
+    std::vector<uint32_t> host_rules;
+    std::vector<uint32_t> domain_rules;
+  };
+
+  void AddRule(uint32_t index);
+
+  ContentSettingsForOneType rules_;
+  Node root_;
+  // Rules whose pattern can't be filed by host, in rule order.
+  std::vector<uint32_t> unindexed_rules_;
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKING_BLOCKER_RULES_INDEX_H_
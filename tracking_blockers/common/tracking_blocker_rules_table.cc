@@ -0,0 +1,345 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_table.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "base/hash/hash.h"
+#include "base/memory/ptr_util.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/ranges/algorithm.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "url/gurl.h"
+#include "url/url_constants.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_index.h"
+
+namespace whale_blocker {
+
+namespace {
+
+constexpr size_t kMaxStringLength = std::numeric_limits<uint16_t>::max();
+
+template <typename T>
+void AppendPod(std::vector<uint8_t>* out, const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+// Same as the check in ContentSettingsPattern::Matches().
+bool IsSubdomainOrEqual(base::StringPiece host, base::StringPiece domain) {
+  if (domain.empty() || host == domain) {
+    return true;
+  }
+  return host.size() > domain.size() && base::EndsWith(host, domain) &&
+         host[host.size() - domain.size() - 1] == '.';
+}
+
+// Returns the MatchFlags for |pattern| and sets |port| if it has one, or
+// returns 0 if the flags can't express it. |pattern_string| is
+// |pattern|.ToString(), which ends with ":<port>" unless the port is a
+// wildcard. The result is checked by rebuilding the pattern from it.
+uint8_t GetMatchFlags(const ContentSettingsPattern& pattern,
+                      const std::string& pattern_string,
+                      uint16_t* port) {
+  uint8_t flags = TrackingBlockerRulesTable::kMatchComponents;
+  std::string spec;
+  switch (pattern.GetScheme()) {
+    case ContentSettingsPattern::SCHEME_WILDCARD:
+      spec = "*://";
+      break;
+    case ContentSettingsPattern::SCHEME_HTTP:
+      flags |= TrackingBlockerRulesTable::kSchemeHTTP;
+      spec = "http://";
+      break;
+    case ContentSettingsPattern::SCHEME_HTTPS:
+      flags |= TrackingBlockerRulesTable::kSchemeHTTPS;
+      spec = "https://";
+      break;
+    default:
+      return 0;
+  }
+
+  if (pattern.MatchesAllHosts()) {
+    flags |= TrackingBlockerRulesTable::kMatchSubdomains;
+    spec += "*";
+  } else {
+    if (pattern.HasDomainWildcard()) {
+      flags |= TrackingBlockerRulesTable::kMatchSubdomains;
+      spec += "[*.]";
+    }
+    spec += pattern.GetHost();
+  }
+
+  const size_t colon = pattern_string.rfind(':');
+  const size_t bracket = pattern_string.rfind(']');
+  const bool has_port =
+      colon != std::string::npos && colon != pattern_string.find("://") &&
+      (bracket == std::string::npos || colon > bracket);
+  unsigned value = 0;
+  if (!has_port) {
+    flags |= TrackingBlockerRulesTable::kAnyPort;
+    spec += ":*";
+  } else if (base::StringToUint(
+                 base::StringPiece(pattern_string).substr(colon + 1),
+                 &value) &&
+             value <= std::numeric_limits<uint16_t>::max()) {
+    *port = static_cast<uint16_t>(value);
+    spec += ":" + base::NumberToString(value);
+  } else {
+    return 0;
+  }
+
+  if (ContentSettingsPattern::FromString(spec) != pattern) {
+    *port = 0;
+    return 0;
+  }
+  return flags;
+}
+
+}  // namespace
+
+TrackingBlockerRulesTable::TrackingBlockerRulesTable() = default;
+TrackingBlockerRulesTable::~TrackingBlockerRulesTable() = default;
+
+// static
+std::vector<uint8_t> TrackingBlockerRulesTable::Build(
+    const ContentSettingsForOneType& rules,
+    uint64_t generation) {
+  CHECK_LT(rules.size(), size_t{kDomainWildcardBit});
+
+  std::string strings;
+  std::vector<Rule> table_rules;
+  std::vector<HostEntry> host_entries;
+  std::vector<uint32_t> unindexed;
+  table_rules.reserve(rules.size());
+  for (const ContentSettingPatternSource& source : rules) {
+    const ContentSettingsPattern& pattern = source.primary_pattern;
+    const std::string pattern_string = pattern.ToString();
+    const std::string pattern_host = pattern.GetHost();
+    // Invalid patterns never match.
+    if (!pattern.IsValid() || pattern_string.size() > kMaxStringLength ||
+        pattern_host.size() > kMaxStringLength) {
+      continue;
+    }
+
+    const uint32_t i = static_cast<uint32_t>(table_rules.size());
+    Rule rule = {};
+    rule.pattern_offset = base::checked_cast<uint32_t>(strings.size());
+    rule.pattern_length = static_cast<uint16_t>(pattern_string.size());
+    rule.setting = base::checked_cast<uint8_t>(source.GetContentSetting());
+    strings.append(pattern_string);
+    rule.flags = GetMatchFlags(pattern, pattern_string, &rule.port);
+    if (rule.flags && !pattern.MatchesAllHosts()) {
+      rule.host_offset = base::checked_cast<uint32_t>(strings.size());
+      rule.host_length = static_cast<uint16_t>(pattern_host.size());
+      strings.append(pattern_host);
+    }
+    table_rules.push_back(rule);
+
+    std::string host;
+    if (TrackingBlockerRulesIndex::GetIndexedHost(pattern, &host)) {
+      host_entries.push_back(
+          {base::PersistentHash(host),
+           i | (pattern.HasDomainWildcard() ? kDomainWildcardBit : 0)});
+    } else {
+      unindexed.push_back(i);
+    }
+  }
+  // Rules for the same host stay in precedence order.
+  base::ranges::sort(host_entries, [](const HostEntry& a, const HostEntry& b) {
+    return std::make_pair(a.host_hash, a.rule & ~kDomainWildcardBit) <
+           std::make_pair(b.host_hash, b.rule & ~kDomainWildcardBit);
+  });
+
+  std::vector<uint8_t> out;
+  out.reserve(sizeof(Header) + table_rules.size() * sizeof(Rule) +
+              host_entries.size() * sizeof(HostEntry) +
+              unindexed.size() * sizeof(uint32_t) + strings.size());
+  AppendPod(&out,
+            Header{kMagic, kVersion, static_cast<uint32_t>(generation),
+                   static_cast<uint32_t>(generation >> 32),
+                   base::checked_cast<uint32_t>(table_rules.size()),
+                   base::checked_cast<uint32_t>(host_entries.size()),
+                   base::checked_cast<uint32_t>(unindexed.size()),
+                   base::checked_cast<uint32_t>(strings.size())});
+  for (const Rule& rule : table_rules) {
+    AppendPod(&out, rule);
+  }
+  for (const HostEntry& entry : host_entries) {
+    AppendPod(&out, entry);
+  }
+  for (uint32_t rule : unindexed) {
+    AppendPod(&out, rule);
+  }
+  out.insert(out.end(), strings.begin(), strings.end());
+  return out;
+}
+
+// static
+base::ReadOnlySharedMemoryRegion TrackingBlockerRulesTable::CreateRegion(
+    const ContentSettingsForOneType& rules,
+    uint64_t generation) {
+  const std::vector<uint8_t> data = Build(rules, generation);
+  base::MappedReadOnlyRegion mapped =
+      base::ReadOnlySharedMemoryRegion::Create(data.size());
+  if (!mapped.IsValid()) {
+    return base::ReadOnlySharedMemoryRegion();
+  }
+  memcpy(mapped.mapping.memory(), data.data(), data.size());
+  return std::move(mapped.region);
+}
+
+// static
+std::unique_ptr<TrackingBlockerRulesTable> TrackingBlockerRulesTable::Create(
+    const base::ReadOnlySharedMemoryRegion& region) {
+  if (!region.IsValid()) {
+    return nullptr;
+  }
+  auto table = base::WrapUnique(new TrackingBlockerRulesTable());
+  table->mapping_ = region.Map();
+  if (!table->mapping_.IsValid() ||
+      !table->Init(table->mapping_.GetMemoryAsSpan<uint8_t>())) {
+    return nullptr;
+  }
+  return table;
+}
+
+bool TrackingBlockerRulesTable::Init(base::span<const uint8_t> data) {
+  if (data.size() < sizeof(Header) ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(Header) != 0) {
+    return false;
+  }
+  const Header* header = reinterpret_cast<const Header*>(data.data());
+  if (header->magic != kMagic || header->version != kVersion) {
+    return false;
+  }
+  const size_t rules_size = size_t{header->rule_count} * sizeof(Rule);
+  const size_t entries_size =
+      size_t{header->host_entry_count} * sizeof(HostEntry);
+  const size_t unindexed_size =
+      size_t{header->unindexed_count} * sizeof(uint32_t);
+  if (data.size() - sizeof(Header) !=
+      rules_size + entries_size + unindexed_size + header->string_bytes) {
+    return false;
+  }
+
+  const uint8_t* cursor = data.data() + sizeof(Header);
+  header_ = header;
+  rules_ = base::make_span(reinterpret_cast<const Rule*>(cursor),
+                           header->rule_count);
+  cursor += rules_size;
+  host_entries_ = base::make_span(reinterpret_cast<const HostEntry*>(cursor),
+                                  header->host_entry_count);
+  cursor += entries_size;
+  unindexed_ = base::make_span(reinterpret_cast<const uint32_t*>(cursor),
+                               header->unindexed_count);
+  cursor += unindexed_size;
+  strings_ = base::StringPiece(reinterpret_cast<const char*>(cursor),
+                               header->string_bytes);
+
+  // Validate once here so that lookups don't need bounds checks.
+  for (const Rule& rule : rules_) {
+    if (size_t{rule.pattern_offset} + rule.pattern_length > strings_.size() ||
+        size_t{rule.host_offset} + rule.host_length > strings_.size()) {
+      return false;
+    }
+  }
+  for (const HostEntry& entry : host_entries_) {
+    if ((entry.rule & ~kDomainWildcardBit) >= rules_.size()) {
+      return false;
+    }
+  }
+  for (uint32_t rule : unindexed_) {
+    if (rule >= rules_.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t TrackingBlockerRulesTable::generation() const {
+  return (uint64_t{header_->generation_high} << 32) | header_->generation_low;
+}
+
+void TrackingBlockerRulesTable::AddCandidates(
+    base::StringPiece host,
+    bool exact_host,
+    std::vector<uint32_t>* candidates) const {
+  const uint32_t hash = base::PersistentHash(host);
+  auto it = std::lower_bound(
+      host_entries_.begin(), host_entries_.end(), hash,
+      [](const HostEntry& entry, uint32_t value) {
+        return entry.host_hash < value;
+      });
+  for (; it != host_entries_.end() && it->host_hash == hash; ++it) {
+    if (exact_host || (it->rule & kDomainWildcardBit)) {
+      candidates->push_back(it->rule & ~kDomainWildcardBit);
+    }
+  }
+}
+
+bool TrackingBlockerRulesTable::Matches(const Rule& rule,
+                                        const GURL& primary_url,
+                                        base::StringPiece host) const {
+  if (!(rule.flags & kMatchComponents) || !primary_url.SchemeIsHTTPOrHTTPS()) {
+    return ContentSettingsPattern::FromString(
+               strings_.substr(rule.pattern_offset, rule.pattern_length))
+        .Matches(primary_url);
+  }
+
+  if (((rule.flags & kSchemeHTTP) && !primary_url.SchemeIs(url::kHttpScheme)) ||
+      ((rule.flags & kSchemeHTTPS) &&
+       !primary_url.SchemeIs(url::kHttpsScheme))) {
+    return false;
+  }
+  const base::StringPiece rule_host =
+      strings_.substr(rule.host_offset, rule.host_length);
+  if ((rule.flags & kMatchSubdomains) ? !IsSubdomainOrEqual(host, rule_host)
+                                      : host != rule_host) {
+    return false;
+  }
+  return (rule.flags & kAnyPort) || primary_url.EffectiveIntPort() == rule.port;
+}
+
+ContentSetting TrackingBlockerRulesTable::GetContentSetting(
+    const GURL& primary_url) const {
+  std::vector<uint32_t> candidates(unindexed_.begin(), unindexed_.end());
+
+  base::StringPiece url_host = primary_url.host_piece();
+  if (base::EndsWith(url_host, ".")) {
+    url_host.remove_suffix(1);
+  }
+  base::StringPiece host = url_host;
+  bool exact_host = true;
+  while (!host.empty()) {
+    AddCandidates(host, exact_host, &candidates);
+    exact_host = false;
+    const size_t dot = host.find('.');
+    if (dot == base::StringPiece::npos) {
+      break;
+    }
+    host.remove_prefix(dot + 1);
+  }
+
+  // Earlier rules take precedence. Hash collisions are weeded out by the
+  // full match.
+  base::ranges::sort(candidates);
+  for (uint32_t index : candidates) {
+    const Rule& rule = rules_[index];
+    if (Matches(rule, primary_url, url_host)) {
+      return static_cast<ContentSetting>(rule.setting);
+    }
+  }
+  return CONTENT_SETTING_DEFAULT;
+}
+
+}  // namespace whale_blocker
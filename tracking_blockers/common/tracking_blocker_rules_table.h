@@ -0,0 +1,133 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKING_BLOCKER_RULES_TABLE_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKING_BLOCKER_RULES_TABLE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/memory/read_only_shared_memory_region.h"
+#include "base/memory/shared_memory_mapping.h"
+#include "base/strings/string_piece.h"
+#include "components/content_settings/core/common/content_settings.h"
+
+class GURL;
+
+namespace whale_blocker {
+
+// Read-only TRACKING_BLOCKER rule table that the browser publishes in
+// shared memory so that every renderer maps the same pages instead of
+// receiving its own copy of ContentSettingsForOneType. Queries give the
+// same result as GetTrackingBlockerContentSettingFromRules() on the rules
+// the table was built from.
+//
+// Rules are looked up through a sorted array of host hashes (see
+// TrackingBlockerRulesIndex for which rules can be filed by host). Each rule
+// also keeps the scheme, host and port of its pattern, so candidates are
+// matched against HTTP(S) URLs without parsing the pattern; only the other
+// patterns (file URLs and the like) are parsed on lookup. Patterns too long
+// for the format are left out.
+//
+// Layout (little-endian, 4-byte aligned):
+//   Header
+//   Rule[rule_count]              in precedence order
+//   HostEntry[host_entry_count]   sorted by (hash, rule)
+//   uint32_t[unindexed_count]     rules without a host, ascending
+//   char[string_bytes]            pattern strings
+class TrackingBlockerRulesTable {
+ public:
+  static constexpr uint32_t kMagic = 0x54525457;  // "WTRT"
+  static constexpr uint32_t kVersion = 2;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    // Bumped by the publisher on every rules change.
+    uint32_t generation_low;
+    uint32_t generation_high;
+    uint32_t rule_count;
+    uint32_t host_entry_count;
+    uint32_t unindexed_count;
+    uint32_t string_bytes;
+  };
+
+  struct Rule {
+    uint32_t pattern_offset;
+    uint16_t pattern_length;
+    uint8_t setting;
+    // MatchFlags; 0 if the pattern has to be parsed to be matched.
+    uint8_t flags;
+    // Host of the pattern, empty if it matches all hosts.
+    uint32_t host_offset;
+    uint16_t host_length;
+    uint16_t port;
+  };
+
+  enum MatchFlags : uint8_t {
+    kMatchComponents = 1 << 0,
+    // Neither is set for "*" schemes.
+    kSchemeHTTP = 1 << 1,
+    kSchemeHTTPS = 1 << 2,
+    kMatchSubdomains = 1 << 3,
+    kAnyPort = 1 << 4,
+  };
+
+  struct HostEntry {
+    uint32_t host_hash;
+    // Top bit set for "[*.]" rules, which also match subdomains.
+    uint32_t rule;
+  };
+
+  static constexpr uint32_t kDomainWildcardBit = 1u << 31;
+
+  TrackingBlockerRulesTable(const TrackingBlockerRulesTable&) = delete;
+  TrackingBlockerRulesTable& operator=(const TrackingBlockerRulesTable&) =
+      delete;
+  ~TrackingBlockerRulesTable();
+
+  // Serializes |rules| into the format above.
+  static std::vector<uint8_t> Build(const ContentSettingsForOneType& rules,
+                                    uint64_t generation);
+  // Same as Build() but into a new shared memory region. Returns an invalid
+  // region on failure.
+  static base::ReadOnlySharedMemoryRegion CreateRegion(
+      const ContentSettingsForOneType& rules,
+      uint64_t generation);
+
+  // Returns nullptr if |region| can't be mapped or isn't a valid table.
+  static std::unique_ptr<TrackingBlockerRulesTable> Create(
+      const base::ReadOnlySharedMemoryRegion& region);
+
+  ContentSetting GetContentSetting(const GURL& primary_url) const;
+
+  uint64_t generation() const;
+  size_t rule_count() const { return rules_.size(); }
+
+ private:
+  TrackingBlockerRulesTable();
+
+  bool Init(base::span<const uint8_t> data);
+  bool Matches(const Rule& rule,
+               const GURL& primary_url,
+               base::StringPiece host) const;
+  void AddCandidates(base::StringPiece host,
+                     bool exact_host,
+                     std::vector<uint32_t>* candidates) const;
+
+  base::ReadOnlySharedMemoryMapping mapping_;
+
+  const Header* header_ = nullptr;
+  base::span<const Rule> rules_;
+  base::span<const HostEntry> host_entries_;
+  base::span<const uint32_t> unindexed_;
+  base::StringPiece strings_;
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_TRACKING_BLOCKER_RULES_TABLE_H_
@@ -12,6 +12,8 @@ class GURL;
 
 namespace whale_blocker {
 
+// Linear scan over |rules|; callers that query the same rules repeatedly
+// should build a TrackingBlockerRulesIndex instead.
 ContentSetting GetTrackingBlockerContentSettingFromRules(
     const ContentSettingsForOneType& rules,
     const GURL& primary_url);
@@ -0,0 +1,120 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/common/url_rewriter.h"
+
+#include "build/build_config.h"
+#include "net/url_request/url_request_job.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+#include "url/origin.h"
+#include "url/url_constants.h"
+#include "whale/components/tracking_blockers/common/exemption_table.h"
+#include "whale/components/tracking_blockers/common/query_string_filter.h"
+#include "whale/components/tracking_blockers/common/registrable_domain_cache.h"
+
+namespace whale_blocker {
+
+namespace {
+
+bool IsFrameRequest(const network::ResourceRequest& request) {
+  const auto type =
+      static_cast<blink::mojom::ResourceType>(request.resource_type);
+  return type == blink::mojom::ResourceType::kMainFrame ||
+         type == blink::mojom::ResourceType::kSubFrame;
+}
+
+// Caps the referrer to "strict-origin-when-cross-origin". Mirrors
+// whale_blocker::MaybeChangeReferrer() without the content layer.
+GURL CapReferrer(const url::Origin& referrer_origin, const GURL& target_url) {
+  return net::URLRequestJob::ComputeReferrerForPolicy(
+      net::ReferrerPolicy::REDUCE_GRANULARITY_ON_TRANSITION_CROSS_ORIGIN,
+      referrer_origin.GetURL(), target_url);
+}
+
+}  // namespace
+
+URLRewriteRequest::URLRewriteRequest(const GURL& url, const GURL& referrer)
+    : url(url), referrer(referrer) {}
+
+URLRewriteRequest::~URLRewriteRequest() = default;
+
+URLRewriteResult::URLRewriteResult() = default;
+URLRewriteResult::URLRewriteResult(URLRewriteResult&&) = default;
+URLRewriteResult& URLRewriteResult::operator=(URLRewriteResult&&) = default;
+URLRewriteResult::~URLRewriteResult() = default;
+
+URLRewriteClassification ClassifyURLRewrite(
+    const mojom::URLRewriteSettings& settings,
+    const URLRewriteRequest& request) {
+  URLRewriteClassification result;
+  const GURL& url = *request.url;
+
+  const url::Origin* source = request.redirect_source
+                                  ? request.redirect_source.get()
+                                  : request.initiator.get();
+  result.same_site = source && IsSameDomainOrHost(*source, url);
+
+  if (!request.internal_scheme && url.has_query()) {
+    result.filter_query =
+        settings.enable_tracking_blocker && url.SchemeIsHTTPOrHTTPS() &&
+        request.method == "GET" &&
+        // Ignore internal redirects since we trigger them.
+        !(request.redirect_source && request.internal_redirect) &&
+        // Same-site requests and redirects are exempted.
+        !result.same_site &&
+        !IsExempt(ExemptionFeature::kQueryFilter, url);
+  }
+
+  if (!settings.allow_referrers && !request.keep_referrer &&
+      !request.frame_request && !request.referrer->is_empty()) {
+    result.cap_referrer =
+        !IsExempt(ExemptionFeature::kReferrer, *request.referrer);
+  }
+  return result;
+}
+
+URLRewriteResult ComputeURLRewrite(const mojom::URLRewriteSettings& settings,
+                                   const URLRewriteRequest& request,
+                                   QueryFilterFunction query_filter) {
+  const URLRewriteClassification classification =
+      ClassifyURLRewrite(settings, request);
+  URLRewriteResult result;
+
+  if (classification.cap_referrer) {
+    const url::Origin referrer_origin = url::Origin::Create(*request.referrer);
+    // Same-origin referrers are kept. This also prevents sending a referrer
+    // from HTTPS to HTTP.
+    if (!referrer_origin.IsSameOriginWith(*request.url)) {
+      result.new_referrer =
+          CapReferrer(referrer_origin, *request.url);
+    }
+  }
+
+  if (classification.filter_query) {
+    result.new_url = query_filter(*request.url, result.removed_trackers);
+  }
+
+  return result;
+}
+
+URLRewriteResult ComputeURLRewrite(const mojom::URLRewriteSettings& settings,
+                                   const network::ResourceRequest& request) {
+#if BUILDFLAG(IS_ANDROID)
+  return URLRewriteResult();
+#else
+  URLRewriteRequest rewrite_request(request.url, request.referrer);
+  rewrite_request.method = request.method;
+  if (request.request_initiator) {
+    rewrite_request.initiator = &request.request_initiator.value();
+  }
+  // The embedder's WebUI and extension schemes aren't known here; they are
+  // served by other factories anyway, so anything but HTTP(S) is left alone.
+  rewrite_request.internal_scheme = !request.url.SchemeIsHTTPOrHTTPS();
+  rewrite_request.frame_request = IsFrameRequest(request);
+  return ComputeURLRewrite(settings, rewrite_request, ApplyQueryFilter);
+#endif
+}
+
+}  // namespace whale_blocker
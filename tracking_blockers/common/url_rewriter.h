@@ -0,0 +1,97 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_URL_REWRITER_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_URL_REWRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/functional/function_ref.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/raw_ref.h"
+#include "base/strings/string_piece.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
+
+namespace network {
+struct ResourceRequest;
+}
+
+namespace url {
+class Origin;
+}
+
+namespace whale_blocker {
+
+// The parts of a request the rewrite rules look at. Only refers to the
+// caller's data, which must outlive the rewrite.
+struct URLRewriteRequest {
+  URLRewriteRequest(const GURL& url, const GURL& referrer);
+  ~URLRewriteRequest();
+
+  raw_ref<const GURL> url;
+  raw_ref<const GURL> referrer;
+  base::StringPiece method;
+  raw_ptr<const url::Origin> initiator = nullptr;
+  // Set while following a redirect, to the origin that redirected.
+  raw_ptr<const url::Origin> redirect_source = nullptr;
+  // The redirect was issued by us, e.g. by an earlier rewrite.
+  bool internal_redirect = false;
+  // Embedder schemes (WebUI, extensions) that are never rewritten.
+  bool internal_scheme = false;
+  // Frame navigations, whose referrer is handled by content.
+  bool frame_request = false;
+  // The embedder wants the referrer kept, e.g. for extension pages.
+  bool keep_referrer = false;
+};
+
+// How the rewrite rules see a request. Computed once, so that origins and
+// same-site checks aren't re-derived by each rule.
+struct URLRewriteClassification {
+  // Same site as the redirect source, or the initiator if not redirected.
+  bool same_site = false;
+
+  bool filter_query = false;
+  bool cap_referrer = false;
+};
+
+struct URLRewriteResult {
+  URLRewriteResult();
+  URLRewriteResult(URLRewriteResult&&);
+  URLRewriteResult& operator=(URLRewriteResult&&);
+  ~URLRewriteResult();
+
+  bool HasChanges() const { return new_url || new_referrer; }
+
+  absl::optional<GURL> new_url;
+  absl::optional<GURL> new_referrer;
+  std::vector<std::string> removed_trackers;
+};
+
+// Signature of ApplyQueryFilter(); callers may substitute a cached one.
+using QueryFilterFunction =
+    base::FunctionRef<absl::optional<GURL>(const GURL&,
+                                           std::vector<std::string>&)>;
+
+URLRewriteClassification ClassifyURLRewrite(
+    const mojom::URLRewriteSettings& settings,
+    const URLRewriteRequest& request);
+
+// Applies the query filter and referrer capping to a request that is about
+// to start, from a single classification of the request.
+URLRewriteResult ComputeURLRewrite(const mojom::URLRewriteSettings& settings,
+                                   const URLRewriteRequest& request,
+                                   QueryFilterFunction query_filter);
+
+// Network service entry point, using the settings pushed from the browser
+// instead of looking them up. Redirects are not handled here. Does nothing on
+// Android, like OnBeforeURLRequest_SiteHacksWork().
+URLRewriteResult ComputeURLRewrite(const mojom::URLRewriteSettings& settings,
+                                   const network::ResourceRequest& request);
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_COMMON_URL_REWRITER_H_
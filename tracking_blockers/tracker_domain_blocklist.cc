@@ -0,0 +1,66 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/tracker_domain_blocklist.h"
+
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/task/thread_pool.h"
+#include "whale/components/tracking_blockers/common/tracker_domain_trie.h"
+
+namespace whale_blocker {
+
+// static
+TrackerDomainBlocklist* TrackerDomainBlocklist::GetInstance() {
+  static base::NoDestructor<TrackerDomainBlocklist> instance;
+  return instance.get();
+}
+
+TrackerDomainBlocklist::TrackerDomainBlocklist() = default;
+TrackerDomainBlocklist::~TrackerDomainBlocklist() = default;
+
+void TrackerDomainBlocklist::Load(const base::FilePath& path) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (path.empty() || path == path_) {
+    return;
+  }
+  path_ = path;
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE,
+      {base::MayBlock(), base::TaskPriority::USER_VISIBLE,
+       base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+      base::BindOnce(&TrackerDomainTrie::CreateFromFile, path),
+      base::BindOnce(&TrackerDomainBlocklist::OnLoaded,
+                     weak_factory_.GetWeakPtr(), path));
+}
+
+bool TrackerDomainBlocklist::Matches(base::StringPiece host) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  return trie_ && trie_->Matches(host);
+}
+
+void TrackerDomainBlocklist::SetTrieForTesting(
+    std::unique_ptr<TrackerDomainTrie> trie) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  trie_ = std::move(trie);
+  ++generation_;
+}
+
+void TrackerDomainBlocklist::OnLoaded(const base::FilePath& path,
+                                      std::unique_ptr<TrackerDomainTrie> trie) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  UMA_HISTOGRAM_BOOLEAN("Whale.ITP.TrackerDomainList.Loaded", !!trie);
+  // A newer Load() call supersedes this one.
+  if (path != path_ || !trie) {
+    return;
+  }
+  UMA_HISTOGRAM_COUNTS_1M("Whale.ITP.TrackerDomainList.NodeCount",
+                          trie->node_count());
+  trie_ = std::move(trie);
+  ++generation_;
+}
+
+}  // namespace whale_blocker
@@ -0,0 +1,67 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKER_DOMAIN_BLOCKLIST_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKER_DOMAIN_BLOCKLIST_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "base/files/file_path.h"
+#include "base/memory/weak_ptr.h"
+#include "base/no_destructor.h"
+#include "base/sequence_checker.h"
+#include "base/strings/string_piece.h"
+
+namespace whale_blocker {
+
+class TrackerDomainTrie;
+
+// Process-wide tracker domain list used by the browser-side request proxy.
+// The list file is mapped on a background sequence; until it is available
+// nothing matches. Must be used on the UI thread.
+class TrackerDomainBlocklist {
+ public:
+  static TrackerDomainBlocklist* GetInstance();
+
+  TrackerDomainBlocklist(const TrackerDomainBlocklist&) = delete;
+  TrackerDomainBlocklist& operator=(const TrackerDomainBlocklist&) = delete;
+
+  // Maps |path| in the background and swaps it in once ready. Does nothing
+  // if |path| is already loaded or being loaded.
+  void Load(const base::FilePath& path);
+
+  // True if |host| or one of its parent domains is a known tracker.
+  bool Matches(base::StringPiece host) const;
+
+  bool is_loaded() const { return !!trie_; }
+
+  // Incremented whenever the list is swapped, so that cached decisions can
+  // be dropped.
+  uint64_t generation() const { return generation_; }
+
+  void SetTrieForTesting(std::unique_ptr<TrackerDomainTrie> trie);
+
+ private:
+  friend class base::NoDestructor<TrackerDomainBlocklist>;
+
+  TrackerDomainBlocklist();
+  ~TrackerDomainBlocklist();
+
+  void OnLoaded(const base::FilePath& path,
+                std::unique_ptr<TrackerDomainTrie> trie);
+
+  base::FilePath path_;
+  uint64_t generation_ = 0;
+  std::unique_ptr<TrackerDomainTrie> trie_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  base::WeakPtrFactory<TrackerDomainBlocklist> weak_factory_{this};
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKER_DOMAIN_BLOCKLIST_H_
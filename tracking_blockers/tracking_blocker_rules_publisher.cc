@@ -0,0 +1,90 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/tracking_blocker_rules_publisher.h"
+
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/time/time.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "components/content_settings/core/common/content_settings.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker_rules_table.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+
+namespace whale_blocker {
+
+TrackingBlockerRulesPublisher::TrackingBlockerRulesPublisher(
+    content::BrowserContext* browser_context)
+    : browser_context_(browser_context),
+      map_(HostContentSettingsMapFactory::GetForProfile(browser_context)) {
+  observation_.Observe(map_.get());
+  batch_subscription_ = AddTrackingBlockerBatchCallback(
+      browser_context,
+      base::BindRepeating(&TrackingBlockerRulesPublisher::OnBatchUpdate,
+                          base::Unretained(this)));
+}
+
+TrackingBlockerRulesPublisher::~TrackingBlockerRulesPublisher() = default;
+
+void TrackingBlockerRulesPublisher::AddObserver(
+    mojo::PendingRemote<mojom::RulesTableObserver> observer) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  base::ReadOnlySharedMemoryRegion region = GetRegion();
+  const mojo::RemoteSetElementId id = observers_.Add(std::move(observer));
+  if (region.IsValid()) {
+    observers_.Get(id)->OnRulesTableUpdated(std::move(region));
+  }
+}
+
+base::ReadOnlySharedMemoryRegion TrackingBlockerRulesPublisher::GetRegion() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (region_generation_ != generation_) {
+    ContentSettingsForOneType rules;
+    map_->GetSettingsForOneType(ContentSettingsType::TRACKING_BLOCKER, &rules);
+    const base::TimeTicks start = base::TimeTicks::Now();
+    region_ = TrackingBlockerRulesTable::CreateRegion(rules, generation_);
+    UMA_HISTOGRAM_TIMES("Whale.ITP.RulesTable.BuildTime",
+                        base::TimeTicks::Now() - start);
+    region_generation_ = generation_;
+  }
+  return region_.IsValid() ? region_.Duplicate()
+                           : base::ReadOnlySharedMemoryRegion();
+}
+
+void TrackingBlockerRulesPublisher::OnContentSettingChanged(
+    const ContentSettingsPattern& primary_pattern,
+    const ContentSettingsPattern& secondary_pattern,
+    ContentSettingsTypeSet content_type_set) {
+  if ((content_type_set.ContainsAllTypes() ||
+       content_type_set.GetType() == ContentSettingsType::TRACKING_BLOCKER) &&
+      !IsTrackingBlockerBatchCommitting(browser_context_)) {
+    OnRulesChanged();
+  }
+}
+
+void TrackingBlockerRulesPublisher::OnBatchUpdate(
+    const std::vector<ContentSettingsPattern>& patterns) {
+  OnRulesChanged();
+}
+
+void TrackingBlockerRulesPublisher::OnRulesChanged() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  ++generation_;
+  // Without observers the table is rebuilt on the next GetRegion().
+  if (observers_.empty()) {
+    region_ = base::ReadOnlySharedMemoryRegion();
+    return;
+  }
+  base::ReadOnlySharedMemoryRegion region = GetRegion();
+  if (!region.IsValid()) {
+    return;
+  }
+  for (auto& observer : observers_) {
+    observer->OnRulesTableUpdated(region.Duplicate());
+  }
+}
+
+}  // namespace whale_blocker
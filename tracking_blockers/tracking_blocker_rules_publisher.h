@@ -0,0 +1,82 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKING_BLOCKER_RULES_PUBLISHER_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKING_BLOCKER_RULES_PUBLISHER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/callback_list.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/read_only_shared_memory_region.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/scoped_observation.h"
+#include "base/sequence_checker.h"
+#include "components/content_settings/core/browser/content_settings_observer.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "mojo/public/cpp/bindings/remote_set.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
+
+namespace content {
+class BrowserContext;
+}
+
+namespace whale_blocker {
+
+// Publishes a profile's TRACKING_BLOCKER rules to renderers as a
+// TrackingBlockerRulesTable in read-only shared memory. The table is built
+// lazily and rebuilt once per settings change (or once per
+// TrackingBlockerBatchUpdate); observers then receive only a handle to the
+// new region. Must be used on the UI thread.
+class TrackingBlockerRulesPublisher : public content_settings::Observer {
+ public:
+  explicit TrackingBlockerRulesPublisher(
+      content::BrowserContext* browser_context);
+  TrackingBlockerRulesPublisher(const TrackingBlockerRulesPublisher&) = delete;
+  TrackingBlockerRulesPublisher& operator=(
+      const TrackingBlockerRulesPublisher&) = delete;
+  ~TrackingBlockerRulesPublisher() override;
+
+  // Sends the current table to |observer| right away and new ones after
+  // each change.
+  void AddObserver(mojo::PendingRemote<mojom::RulesTableObserver> observer);
+
+  // Returns a read-only handle to the current table, building it first if
+  // the rules changed since. Invalid if shared memory couldn't be created.
+  base::ReadOnlySharedMemoryRegion GetRegion();
+
+  uint64_t generation() const { return generation_; }
+
+ private:
+  // content_settings::Observer:
+  void OnContentSettingChanged(
+      const ContentSettingsPattern& primary_pattern,
+      const ContentSettingsPattern& secondary_pattern,
+      ContentSettingsTypeSet content_type_set) override;
+
+  void OnBatchUpdate(const std::vector<ContentSettingsPattern>& patterns);
+  void OnRulesChanged();
+
+  raw_ptr<content::BrowserContext> browser_context_;
+  scoped_refptr<HostContentSettingsMap> map_;
+  uint64_t generation_ = 1;
+  // Generation |region_| was built for; 0 if it has to be rebuilt.
+  uint64_t region_generation_ = 0;
+  base::ReadOnlySharedMemoryRegion region_;
+
+  mojo::RemoteSet<mojom::RulesTableObserver> observers_;
+
+  base::ScopedObservation<HostContentSettingsMap, content_settings::Observer>
+      observation_{this};
+  base::CallbackListSubscription batch_subscription_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKING_BLOCKER_RULES_PUBLISHER_H_
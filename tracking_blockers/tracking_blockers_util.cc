@@ -5,12 +5,22 @@
 
 #include "whale/components/tracking_blockers/tracking_blockers_util.h"
 
+#include <memory>
+#include <utility>
+
+#include "base/functional/callback.h"
+#include "base/supports_user_data.h"
 #include "chrome/browser/content_settings/host_content_settings_map_factory.h"
 #include "components/content_settings/core/browser/host_content_settings_map.h"
 #include "components/content_settings/core/common/content_settings_pattern.h"
+#include "components/content_settings/core/common/content_settings_utils.h"
+#include "content/public/browser/browser_context.h"
 #include "content/public/common/referrer.h"
 #include "services/network/public/mojom/referrer_policy.mojom.h"
 #include "url/gurl.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/common/exemption_table.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
 
 namespace whale_blocker {
 
@@ -25,6 +35,41 @@ ContentSetting GetDefaultBlockFromControlType(ControlType type) {
                                     : CONTENT_SETTING_BLOCK;
 }
 
+ContentSetting GetContentSettingFromControlType(ControlType type) {
+  if (type == ControlType::DEFAULT || type == ControlType::BLOCK_THIRD_PARTY) {
+    // TODO(jwoo.park): CONTENT_SETTING_ASK is default mode but the name is so
+    // ambiguous. CONTENT_SETTING_ALLOW : Allow any trackers and
+    // fingerprintings. CONTENT_SETTING_ASK : Default mode, blocks trackers.
+    // CONTENT_SETTING_BLOCK : In addition to ASK, it blocks fingerprintings.
+    return CONTENT_SETTING_ASK;
+  }
+  return GetDefaultBlockFromControlType(type);
+}
+
+const void* const kBatchStateUserDataKey = &kBatchStateUserDataKey;
+
+// Batch update state of a profile, created by the first batch or observer.
+struct BatchState : public base::SupportsUserData::Data {
+  int committing = 0;
+  base::RepeatingCallbackList<void(const std::vector<ContentSettingsPattern>&)>
+      callbacks;
+};
+
+BatchState* FindBatchState(content::BrowserContext* browser_context) {
+  return static_cast<BatchState*>(
+      browser_context->GetUserData(kBatchStateUserDataKey));
+}
+
+BatchState* GetOrCreateBatchState(content::BrowserContext* browser_context) {
+  BatchState* state = FindBatchState(browser_context);
+  if (!state) {
+    auto new_state = std::make_unique<BatchState>();
+    state = new_state.get();
+    browser_context->SetUserData(kBatchStateUserDataKey, std::move(new_state));
+  }
+  return state;
+}
+
 }  // namespace
 
 ContentSettingsPattern GetPatternFromURL(const GURL& url) {
@@ -42,27 +87,16 @@ void SetTrackingBlockerControlType(HostContentSettingsMap* map,
     return;
   }
 
-  content_settings::SettingInfo setting_info;
-  ContentSetting content_setting;
   auto primary_pattern = GetPatternFromURL(url);
 
   if (!primary_pattern.IsValid()) {
     return;
   }
 
-  if (type == ControlType::DEFAULT || type == ControlType::BLOCK_THIRD_PARTY) {
-    // TODO(jwoo.park): CONTENT_SETTING_ASK is default mode but the name is so
-    // ambiguous. CONTENT_SETTING_ALLOW : Allow any trackers and
-    // fingerprintings. CONTENT_SETTING_ASK : Default mode, blocks trackers.
-    // CONTENT_SETTING_BLOCK : In addition to ASK, it blocks fingerprintings.
-    content_setting = CONTENT_SETTING_ASK;
-  } else {
-    content_setting = GetDefaultBlockFromControlType(type);
-  }
-
   map->SetContentSettingCustomScope(
       primary_pattern, ContentSettingsPattern::Wildcard(),
-      ContentSettingsType::TRACKING_BLOCKER, content_setting);
+      ContentSettingsType::TRACKING_BLOCKER,
+      GetContentSettingFromControlType(type));
 }
 
 void ResetTrackingBlockerEnabled(HostContentSettingsMap* map, const GURL& url) {
@@ -81,42 +115,40 @@ void ResetTrackingBlockerEnabled(HostContentSettingsMap* map, const GURL& url) {
       ContentSettingsType::TRACKING_BLOCKER, CONTENT_SETTING_DEFAULT);
 }
 
-bool GetTrackingBlockerEnabled(HostContentSettingsMap* map, const GURL& url) {
+ControlType GetTrackingBlockerControlType(HostContentSettingsMap* map,
+                                          const GURL& url) {
 #if BUILDFLAG(IS_ANDROID)
-  return false;
+  return ControlType::ALLOW;
 #else
   if (url.is_valid() && !url.SchemeIsHTTPOrHTTPS()) {
-    return false;
+    return ControlType::ALLOW;
   }
 
   ContentSetting setting = map->GetContentSetting(
       url, GURL(), ContentSettingsType::TRACKING_BLOCKER);
 
   // see EnableBraveShields - allow and default == true
-  return setting == CONTENT_SETTING_ALLOW ? false : true;
+  if (setting == CONTENT_SETTING_ALLOW) {
+    return ControlType::ALLOW;
+  }
+  return setting == CONTENT_SETTING_BLOCK ? ControlType::BLOCK
+                                          : ControlType::DEFAULT;
 #endif
 }
 
-bool IsTrackingBlockerMaxLevel(HostContentSettingsMap* map, const GURL& url) {
-#if BUILDFLAG(IS_ANDROID)
-  return false;
-#else
-  if (url.is_valid() && !url.SchemeIsHTTPOrHTTPS()) {
-    return false;
-  }
-
-  ContentSetting setting = map->GetContentSetting(
-      url, GURL(), ContentSettingsType::TRACKING_BLOCKER);
-
-  return setting == CONTENT_SETTING_BLOCK;
-#endif
+bool GetTrackingBlockerEnabled(HostContentSettingsMap* map, const GURL& url) {
+  return GetTrackingBlockerControlType(map, url) != ControlType::ALLOW;
 }
 
-bool IsSameOriginNavigation(const GURL& referrer, const GURL& target_url) {
-  const url::Origin original_referrer = url::Origin::Create(referrer);
-  const url::Origin target_origin = url::Origin::Create(target_url);
+bool IsTrackingBlockerMaxLevel(HostContentSettingsMap* map, const GURL& url) {
+  return GetTrackingBlockerControlType(map, url) == ControlType::BLOCK;
+}
 
-  return original_referrer.IsSameOriginWith(target_origin);
+mojom::URLRewriteSettingsPtr GetURLRewriteSettings(HostContentSettingsMap* map,
+                                                   const GURL& url) {
+  const ControlType type = GetTrackingBlockerControlType(map, url);
+  return mojom::URLRewriteSettings::New(type != ControlType::ALLOW,
+                                        type != ControlType::BLOCK);
 }
 
 bool MaybeChangeReferrer(const GURL& current_referrer,
@@ -133,22 +165,21 @@ bool MaybeChangeReferrer(const GURL& current_referrer,
     return false;
   }
 
-  if (IsSameOriginNavigation(current_referrer, target_url)) {
+  // Built once and reused below for the capped referrer.
+  url::Origin current_referrer_origin = url::Origin::Create(current_referrer);
+  if (current_referrer_origin.IsSameOriginWith(target_url)) {
     // Do nothing for same-origin requests. This check also prevents us from
     // sending referrer from HTTPS to HTTP.
     return false;
   }
 
-  if (current_referrer.DomainIs("naver.com")) {
-    // We always allow referrer on naver domains.
-    // https://oss.navercorp.com/whale/whale/pull/36178
+  if (IsExempt(ExemptionFeature::kReferrer, current_referrer)) {
     return false;
   }
 
   // Cap the referrer to "strict-origin-when-cross-origin". More restrictive
   // policies should be already applied.
   // See https://github.com/brave/brave-browser/issues/13464
-  url::Origin current_referrer_origin = url::Origin::Create(current_referrer);
   *output_referrer = content::Referrer::SanitizeForRequest(
       target_url,
       content::Referrer(
@@ -158,4 +189,89 @@ bool MaybeChangeReferrer(const GURL& current_referrer,
   return true;
 }
 
+TrackingBlockerBatchUpdate::TrackingBlockerBatchUpdate(
+    content::BrowserContext* browser_context)
+    : browser_context_(browser_context),
+      map_(HostContentSettingsMapFactory::GetForProfile(browser_context)) {
+  DCHECK(map_);
+}
+
+TrackingBlockerBatchUpdate::~TrackingBlockerBatchUpdate() {
+  Commit();
+}
+
+void TrackingBlockerBatchUpdate::SetControlType(ControlType type,
+                                                const GURL& url) {
+  Add(url, GetContentSettingFromControlType(type));
+}
+
+void TrackingBlockerBatchUpdate::Reset(const GURL& url) {
+  Add(url, CONTENT_SETTING_DEFAULT);
+}
+
+void TrackingBlockerBatchUpdate::Add(const GURL& url, ContentSetting setting) {
+  if (url.is_valid() && !url.SchemeIsHTTPOrHTTPS()) {
+    return;
+  }
+
+  auto primary_pattern = GetPatternFromURL(url);
+  if (!primary_pattern.IsValid()) {
+    return;
+  }
+  pending_.insert_or_assign(std::move(primary_pattern),
+                            PendingUpdate{url, setting});
+}
+
+size_t TrackingBlockerBatchUpdate::Commit() {
+  if (pending_.empty()) {
+    return 0;
+  }
+
+  BatchState* batch_state = GetOrCreateBatchState(browser_context_);
+  std::vector<ContentSettingsPattern> changed;
+  ++batch_state->committing;
+  for (auto& [pattern, update] : pending_) {
+    content_settings::SettingInfo info;
+    const base::Value value = map_->GetWebsiteSetting(
+        update.url, GURL(), ContentSettingsType::TRACKING_BLOCKER, &info);
+    const bool has_exception = info.primary_pattern == pattern &&
+                               info.secondary_pattern ==
+                                   ContentSettingsPattern::Wildcard();
+    const bool unchanged =
+        update.setting == CONTENT_SETTING_DEFAULT
+            ? !has_exception
+            : has_exception &&
+                  content_settings::ValueToContentSetting(value) ==
+                      update.setting;
+    if (unchanged) {
+      continue;
+    }
+    map_->SetContentSettingCustomScope(pattern,
+                                       ContentSettingsPattern::Wildcard(),
+                                       ContentSettingsType::TRACKING_BLOCKER,
+                                       update.setting);
+    changed.push_back(pattern);
+  }
+  --batch_state->committing;
+  pending_.clear();
+
+  if (!changed.empty()) {
+    batch_state->callbacks.Notify(changed);
+  }
+  return changed.size();
+}
+
+bool IsTrackingBlockerBatchCommitting(
+    content::BrowserContext* browser_context) {
+  const BatchState* state = FindBatchState(browser_context);
+  return state && state->committing > 0;
+}
+
+base::CallbackListSubscription AddTrackingBlockerBatchCallback(
+    content::BrowserContext* browser_context,
+    TrackingBlockerBatchCallback callback) {
+  return GetOrCreateBatchState(browser_context)
+      ->callbacks.Add(std::move(callback));
+}
+
 }  // namespace whale_blocker
@@ -8,12 +8,23 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <vector>
+
+#include "base/callback_list.h"
+#include "base/functional/callback_forward.h"
+#include "base/memory/raw_ptr.h"
+#include "components/content_settings/core/common/content_settings.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom-forward.h"
+
 namespace content {
+class BrowserContext;
 struct Referrer;
 }
 
 class HostContentSettingsMap;
-class GURL;
 
 namespace whale_blocker {
 
@@ -24,14 +35,73 @@ void SetTrackingBlockerControlType(HostContentSettingsMap* map,
                                    const GURL& url);
 // reset to the default value
 void ResetTrackingBlockerEnabled(HostContentSettingsMap* map, const GURL& url);
+// Resolves the level for |url| with a single settings lookup: ALLOW if the
+// tracking blocker is off, BLOCK for the max level and DEFAULT otherwise.
+ControlType GetTrackingBlockerControlType(HostContentSettingsMap* map,
+                                          const GURL& url);
 bool GetTrackingBlockerEnabled(HostContentSettingsMap* map, const GURL& url);
 bool IsTrackingBlockerMaxLevel(HostContentSettingsMap* map, const GURL& url);
 
+// Snapshot of the settings for |url| to be applied by the network service.
+mojom::URLRewriteSettingsPtr GetURLRewriteSettings(HostContentSettingsMap* map,
+                                                   const GURL& url);
+
 bool MaybeChangeReferrer(const GURL& current_referrer,
                          const GURL& target_url,
                          content::Referrer* output_referrer,
                          HostContentSettingsMap* map = nullptr);
 
+// Applies many tracking blocker exceptions (policy or sync imports) as one
+// transaction. Updates are collected and written to the profile's
+// HostContentSettingsMap by Commit() or on destruction; later updates for the
+// same host replace earlier ones and entries that already hold the requested
+// value are skipped. While the writes are in progress
+// IsTrackingBlockerBatchCommitting() is true so that observers can skip the
+// per-pattern notifications, and afterwards every callback added with
+// AddTrackingBlockerBatchCallback() runs once with the patterns that changed.
+// The pref store coalesces the writes into a single commit. Must be used on
+// the UI thread.
+class TrackingBlockerBatchUpdate {
+ public:
+  explicit TrackingBlockerBatchUpdate(content::BrowserContext* browser_context);
+  TrackingBlockerBatchUpdate(const TrackingBlockerBatchUpdate&) = delete;
+  TrackingBlockerBatchUpdate& operator=(const TrackingBlockerBatchUpdate&) =
+      delete;
+  ~TrackingBlockerBatchUpdate();
+
+  // Same as SetTrackingBlockerControlType() and
+  // ResetTrackingBlockerEnabled() but deferred until Commit().
+  void SetControlType(ControlType type, const GURL& url);
+  void Reset(const GURL& url);
+
+  // Returns the number of patterns that were actually written.
+  size_t Commit();
+
+  size_t pending_count() const { return pending_.size(); }
+
+ private:
+  struct PendingUpdate {
+    GURL url;
+    ContentSetting setting;
+  };
+
+  void Add(const GURL& url, ContentSetting setting);
+
+  raw_ptr<content::BrowserContext> browser_context_;
+  raw_ptr<HostContentSettingsMap> map_;
+  std::map<ContentSettingsPattern, PendingUpdate> pending_;
+};
+
+using TrackingBlockerBatchCallback =
+    base::RepeatingCallback<void(const std::vector<ContentSettingsPattern>&)>;
+
+// The batch state lives on |browser_context|, so callbacks and the
+// committing flag go away with the profile.
+bool IsTrackingBlockerBatchCommitting(content::BrowserContext* browser_context);
+base::CallbackListSubscription AddTrackingBlockerBatchCallback(
+    content::BrowserContext* browser_context,
+    TrackingBlockerBatchCallback callback);
+
 }  // namespace whale_blocker
 
 #endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_TRACKING_BLOCKERS_UTIL_H_
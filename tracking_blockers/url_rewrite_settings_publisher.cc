@@ -0,0 +1,84 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/components/tracking_blockers/url_rewrite_settings_publisher.h"
+
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "components/content_settings/core/common/content_settings.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+
+namespace whale_blocker {
+
+URLRewriteSettingsPublisher::URLRewriteSettingsPublisher(
+    content::BrowserContext* browser_context)
+    : browser_context_(browser_context),
+      map_(HostContentSettingsMapFactory::GetForProfile(browser_context)) {
+  observation_.Observe(map_.get());
+  batch_subscription_ = AddTrackingBlockerBatchCallback(
+      browser_context,
+      base::BindRepeating(&URLRewriteSettingsPublisher::OnBatchUpdate,
+                          base::Unretained(this)));
+  observers_.set_disconnect_handler(
+      base::BindRepeating(&URLRewriteSettingsPublisher::OnObserverDisconnected,
+                          base::Unretained(this)));
+}
+
+URLRewriteSettingsPublisher::~URLRewriteSettingsPublisher() = default;
+
+mojom::URLRewriteSettingsPtr URLRewriteSettingsPublisher::AddObserver(
+    const GURL& tab_origin,
+    mojo::PendingRemote<mojom::URLRewriteSettingsObserver> observer) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  mojom::URLRewriteSettingsPtr settings =
+      GetURLRewriteSettings(map_.get(), tab_origin);
+  const mojo::RemoteSetElementId id = observers_.Add(std::move(observer));
+  entries_.emplace(id, Entry{tab_origin, settings.Clone()});
+  return settings;
+}
+
+void URLRewriteSettingsPublisher::OnContentSettingChanged(
+    const ContentSettingsPattern& primary_pattern,
+    const ContentSettingsPattern& secondary_pattern,
+    ContentSettingsTypeSet content_type_set) {
+  if ((content_type_set.ContainsAllTypes() ||
+       content_type_set.GetType() == ContentSettingsType::TRACKING_BLOCKER) &&
+      !IsTrackingBlockerBatchCommitting(browser_context_)) {
+    OnRulesChanged();
+  }
+}
+
+void URLRewriteSettingsPublisher::OnBatchUpdate(
+    const std::vector<ContentSettingsPattern>& patterns) {
+  OnRulesChanged();
+}
+
+void URLRewriteSettingsPublisher::OnRulesChanged() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  // Most factories of a page share its origin; look each one up once.
+  std::map<GURL, mojom::URLRewriteSettingsPtr> settings_by_origin;
+  for (auto& [id, entry] : entries_) {
+    auto it = settings_by_origin.find(entry.tab_origin);
+    if (it == settings_by_origin.end()) {
+      it = settings_by_origin
+               .emplace(entry.tab_origin,
+                        GetURLRewriteSettings(map_.get(), entry.tab_origin))
+               .first;
+    }
+    if (it->second.Equals(entry.settings)) {
+      continue;
+    }
+    entry.settings = it->second.Clone();
+    observers_.Get(id)->OnURLRewriteSettingsChanged(it->second.Clone());
+  }
+}
+
+void URLRewriteSettingsPublisher::OnObserverDisconnected(
+    mojo::RemoteSetElementId id) {
+  entries_.erase(id);
+}
+
+}  // namespace whale_blocker
@@ -0,0 +1,81 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_COMPONENTS_TRACKING_BLOCKERS_URL_REWRITE_SETTINGS_PUBLISHER_H_
+#define WHALE_COMPONENTS_TRACKING_BLOCKERS_URL_REWRITE_SETTINGS_PUBLISHER_H_
+
+#include <map>
+#include <vector>
+
+#include "base/callback_list.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/scoped_observation.h"
+#include "base/sequence_checker.h"
+#include "components/content_settings/core/browser/content_settings_observer.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "mojo/public/cpp/bindings/remote_set.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
+
+namespace content {
+class BrowserContext;
+}
+
+namespace whale_blocker {
+
+// Keeps the URLRewriteSettings of network service URLLoaderFactories in sync
+// with a profile's TRACKING_BLOCKER settings. Each factory is added with the
+// top-level origin it was created for; after a settings change (or once per
+// TrackingBlockerBatchUpdate) only the factories whose settings changed are
+// told. Must be used on the UI thread.
+class URLRewriteSettingsPublisher : public content_settings::Observer {
+ public:
+  explicit URLRewriteSettingsPublisher(
+      content::BrowserContext* browser_context);
+  URLRewriteSettingsPublisher(const URLRewriteSettingsPublisher&) = delete;
+  URLRewriteSettingsPublisher& operator=(const URLRewriteSettingsPublisher&) =
+      delete;
+  ~URLRewriteSettingsPublisher() override;
+
+  // Returns the current settings for |tab_origin|; |observer| is sent the
+  // new ones whenever they change.
+  mojom::URLRewriteSettingsPtr AddObserver(
+      const GURL& tab_origin,
+      mojo::PendingRemote<mojom::URLRewriteSettingsObserver> observer);
+
+  size_t observer_count() const { return observers_.size(); }
+
+ private:
+  struct Entry {
+    GURL tab_origin;
+    mojom::URLRewriteSettingsPtr settings;
+  };
+
+  // content_settings::Observer:
+  void OnContentSettingChanged(
+      const ContentSettingsPattern& primary_pattern,
+      const ContentSettingsPattern& secondary_pattern,
+      ContentSettingsTypeSet content_type_set) override;
+
+  void OnBatchUpdate(const std::vector<ContentSettingsPattern>& patterns);
+  void OnRulesChanged();
+  void OnObserverDisconnected(mojo::RemoteSetElementId id);
+
+  raw_ptr<content::BrowserContext> browser_context_;
+  scoped_refptr<HostContentSettingsMap> map_;
+  mojo::RemoteSet<mojom::URLRewriteSettingsObserver> observers_;
+  std::map<mojo::RemoteSetElementId, Entry> entries_;
+
+  base::ScopedObservation<HostContentSettingsMap, content_settings::Observer>
+      observation_{this};
+  base::CallbackListSubscription batch_subscription_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+}  // namespace whale_blocker
+
+#endif  // WHALE_COMPONENTS_TRACKING_BLOCKERS_URL_REWRITE_SETTINGS_PUBLISHER_H_
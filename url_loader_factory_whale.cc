@@ -0,0 +1,25 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/services/network/url_loader_factory_whale.h"
+
+// Applies the tracking blocker site hacks when the browser configured this
+// factory with |whale_url_rewrite_settings| instead of proxying it through
+// WhaleProxyingURLLoaderFactory.
+#define WHALE_URL_LOADER_FACTORY_CONSTRUCTOR                                   \
+  whale_url_rewrite_stage_ =                                                   \
+      WhaleURLRewriteStage::MaybeCreate(this, params_.get());
+
+#define WHALE_URL_LOADER_FACTORY_CREATE_LOADER_AND_START                       \
+  if (whale_url_rewrite_stage_ &&                                              \
+      whale_url_rewrite_stage_->MaybeRewrite(receiver, request_id, options,    \
+                                             url_request, client,              \
+                                             traffic_annotation)) {            \
+    return;                                                                    \
+  }
+
+#include "services/network/url_loader_factory.cc"
+
+#undef WHALE_URL_LOADER_FACTORY_CREATE_LOADER_AND_START
+#undef WHALE_URL_LOADER_FACTORY_CONSTRUCTOR
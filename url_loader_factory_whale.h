@@ -0,0 +1,16 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_SERVICES_NETWORK_URL_LOADER_FACTORY_WHALE_H_
+#define WHALE_SERVICES_NETWORK_URL_LOADER_FACTORY_WHALE_H_
+
+#include <memory>
+
+#include "whale/services/network/whale_url_rewrite_stage.h"
+
+// Expanded in the private section of network::URLLoaderFactory.
+#define WHALE_URL_LOADER_FACTORY_H \
+  std::unique_ptr<WhaleURLRewriteStage> whale_url_rewrite_stage_;
+
+#endif  // WHALE_SERVICES_NETWORK_URL_LOADER_FACTORY_WHALE_H_
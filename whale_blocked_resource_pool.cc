@@ -0,0 +1,220 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_blocked_resource_pool.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "base/check_op.h"
+#include "base/hash/hash.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/task/single_thread_task_runner.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/memory_dump_manager.h"
+#include "base/trace_event/memory_usage_estimator.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "content/public/browser/browser_context.h"
+
+namespace whale {
+
+namespace {
+
+const void* const kBlockedResourcePoolUserDataKey =
+    &kBlockedResourcePoolUserDataKey;
+
+}  // namespace
+
+WhaleBlockedResourcePool::WhaleBlockedResourcePool() {
+  base::trace_event::MemoryDumpManager::GetInstance()->RegisterDumpProvider(
+      this, "WhaleBlockedResourcePool",
+      base::SingleThreadTaskRunner::GetCurrentDefault());
+}
+
+WhaleBlockedResourcePool::~WhaleBlockedResourcePool() {
+  base::trace_event::MemoryDumpManager::GetInstance()->UnregisterDumpProvider(
+      this);
+}
+
+// static
+WhaleBlockedResourcePool* WhaleBlockedResourcePool::GetForBrowserContext(
+    content::BrowserContext* browser_context) {
+  auto* pool = static_cast<WhaleBlockedResourcePool*>(
+      browser_context->GetUserData(kBlockedResourcePoolUserDataKey));
+  if (!pool) {
+    auto new_pool = std::make_unique<WhaleBlockedResourcePool>();
+    pool = new_pool.get();
+    browser_context->SetUserData(kBlockedResourcePoolUserDataKey,
+                                 std::move(new_pool));
+  }
+  return pool;
+}
+
+uint32_t WhaleBlockedResourcePool::Intern(base::StringPiece value) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = ids_.find(value);
+  if (it != ids_.end()) {
+    ++entries_[it->second].ref_count;
+    return it->second;
+  }
+
+  uint32_t id;
+  if (free_ids_.empty()) {
+    id = base::checked_cast<uint32_t>(entries_.size());
+    entries_.emplace_back();
+  } else {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  }
+  Entry& entry = entries_[id];
+  entry.value = std::string(value);
+  entry.ref_count = 1;
+  ids_.emplace(entry.value, id);
+  return id;
+}
+
+bool WhaleBlockedResourcePool::Find(base::StringPiece value,
+                                    uint32_t* id) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = ids_.find(value);
+  if (it == ids_.end()) {
+    return false;
+  }
+  *id = it->second;
+  return true;
+}
+
+void WhaleBlockedResourcePool::Release(uint32_t id) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  Entry& entry = entries_[id];
+  DCHECK_GT(entry.ref_count, 0u);
+  if (--entry.ref_count) {
+    return;
+  }
+  ids_.erase(entry.value);
+  std::string().swap(entry.value);
+  free_ids_.push_back(id);
+}
+
+const std::string& WhaleBlockedResourcePool::Get(uint32_t id) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK_GT(entries_[id].ref_count, 0u);
+  return entries_[id].value;
+}
+
+size_t WhaleBlockedResourcePool::EstimateMemoryUsage() const {
+  size_t bytes = entries_.size() * sizeof(Entry) +
+                 base::trace_event::EstimateMemoryUsage(free_ids_) +
+                 base::trace_event::EstimateMemoryUsage(ids_);
+  for (const Entry& entry : entries_) {
+    bytes += base::trace_event::EstimateMemoryUsage(entry.value);
+  }
+  return bytes;
+}
+
+bool WhaleBlockedResourcePool::OnMemoryDump(
+    const base::trace_event::MemoryDumpArgs& args,
+    base::trace_event::ProcessMemoryDump* pmd) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  using base::trace_event::MemoryAllocatorDump;
+
+  MemoryAllocatorDump* dump = pmd->CreateAllocatorDump(base::StringPrintf(
+      "whale/blocked_resource_pool/0x%" PRIXPTR,
+      reinterpret_cast<uintptr_t>(this)));
+  dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes, EstimateMemoryUsage());
+  dump->AddScalar("string_count", MemoryAllocatorDump::kUnitsObjects,
+                  ids_.size());
+  return true;
+}
+
+WhaleBlockedResourceList::WhaleBlockedResourceList(
+    WhaleBlockedResourcePool* pool,
+    size_t max_stored)
+    : pool_(pool), max_stored_(max_stored) {}
+
+WhaleBlockedResourceList::~WhaleBlockedResourceList() {
+  Clear();
+}
+
+bool WhaleBlockedResourceList::Insert(base::StringPiece value) {
+  if (ids_.size() < max_stored_) {
+    const uint32_t id = pool_->Intern(value);
+    if (ids_.insert(id).second) {
+      order_.push_back(id);
+      return true;
+    }
+    pool_->Release(id);
+    return false;
+  }
+  // Values stored before the cap was reached are still recognized.
+  uint32_t id;
+  if (pool_->Find(value, &id) && ids_.contains(id)) {
+    return false;
+  }
+  const uint32_t hash = base::PersistentHash(value);
+  if (overflow_hashes_.find(hash) != overflow_hashes_.end()) {
+    return false;
+  }
+  if (overflow_hashes_.size() < kMaxOverflowHashes) {
+    overflow_hashes_.insert(hash);
+  } else {
+    ++untracked_count_;
+  }
+  return true;
+}
+
+void WhaleBlockedResourceList::Clear() {
+  for (uint32_t id : ids_) {
+    pool_->Release(id);
+  }
+  ids_.clear();
+  order_.clear();
+  overflow_hashes_.clear();
+  untracked_count_ = 0;
+  ++epoch_;
+}
+
+std::vector<std::string> WhaleBlockedResourceList::GetValues() const {
+  std::vector<std::string> values;
+  AppendValues(&values);
+  return values;
+}
+
+void WhaleBlockedResourceList::AppendValues(
+    std::vector<std::string>* values) const {
+  const size_t begin = values->size();
+  values->reserve(begin + ids_.size());
+  for (uint32_t id : ids_) {
+    values->push_back(pool_->Get(id));
+  }
+  std::sort(values->begin() + begin, values->end());
+}
+
+bool WhaleBlockedResourceList::ReadSince(
+    Cursor* cursor,
+    std::vector<base::StringPiece>* values) const {
+  const bool up_to_date =
+      cursor->epoch == epoch_ && cursor->position <= order_.size();
+  const size_t begin = up_to_date ? cursor->position : 0;
+  values->reserve(values->size() + order_.size() - begin);
+  for (size_t i = begin; i < order_.size(); ++i) {
+    values->push_back(pool_->Get(order_[i]));
+  }
+  cursor->epoch = epoch_;
+  cursor->position = order_.size();
+  return up_to_date;
+}
+
+size_t WhaleBlockedResourceList::EstimateMemoryUsage() const {
+  return base::trace_event::EstimateMemoryUsage(ids_) +
+         base::trace_event::EstimateMemoryUsage(order_) +
+         base::trace_event::EstimateMemoryUsage(overflow_hashes_);
+}
+
+}  // namespace whale
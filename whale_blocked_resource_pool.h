@@ -0,0 +1,135 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_WHALE_BROWSER_UI_WHALE_BLOCKED_RESOURCE_POOL_H_
+#define WHALE_WHALE_BROWSER_UI_WHALE_BLOCKED_RESOURCE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/containers/flat_set.h"
+#include "base/memory/raw_ptr.h"
+#include "base/sequence_checker.h"
+#include "base/strings/string_piece.h"
+#include "base/supports_user_data.h"
+#include "base/trace_event/memory_dump_provider.h"
+
+namespace content {
+class BrowserContext;
+}
+
+namespace whale {
+
+// Per-profile pool of blocked resource URLs and parameter names. Tabs of
+// the same profile tend to block the same trackers, so every string is
+// stored once and tabs hold reference-counted ids into the pool. Must be
+// used on the UI thread.
+class WhaleBlockedResourcePool : public base::SupportsUserData::Data,
+                                 public base::trace_event::MemoryDumpProvider {
+ public:
+  WhaleBlockedResourcePool();
+  WhaleBlockedResourcePool(const WhaleBlockedResourcePool&) = delete;
+  WhaleBlockedResourcePool& operator=(const WhaleBlockedResourcePool&) =
+      delete;
+  ~WhaleBlockedResourcePool() override;
+
+  static WhaleBlockedResourcePool* GetForBrowserContext(
+      content::BrowserContext* browser_context);
+
+  // Returns the id of |value| and takes a reference on it.
+  uint32_t Intern(base::StringPiece value);
+  // Looks |value| up without taking a reference.
+  bool Find(base::StringPiece value, uint32_t* id) const;
+  void Release(uint32_t id);
+  const std::string& Get(uint32_t id) const;
+
+  size_t size() const { return ids_.size(); }
+  size_t EstimateMemoryUsage() const;
+
+  // base::trace_event::MemoryDumpProvider:
+  bool OnMemoryDump(const base::trace_event::MemoryDumpArgs& args,
+                    base::trace_event::ProcessMemoryDump* pmd) override;
+
+ private:
+  struct Entry {
+    std::string value;
+    uint32_t ref_count = 0;
+  };
+
+  // A deque so that the keys of |ids_|, which point into the entries, stay
+  // valid as entries are added.
+  std::deque<Entry> entries_;
+  std::vector<uint32_t> free_ids_;
+  std::unordered_map<base::StringPiece, uint32_t, base::StringPieceHash> ids_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+// Blocked resources of one kind for one tab. The first |max_stored|
+// distinct values are kept (as pool ids) for display; past that values
+// are only counted, by 32-bit hash, so count() stays close to exact
+// without growing the pool on long-lived single-page apps. Once
+// kMaxOverflowHashes hashes are held, further values are counted without
+// being remembered, so repeats of them count again.
+class WhaleBlockedResourceList {
+ public:
+  static constexpr size_t kMaxOverflowHashes = 1024;
+
+  // Position of a reader in the list, for ReadSince().
+  struct Cursor {
+    uint32_t epoch = 0;
+    size_t position = 0;
+  };
+
+  WhaleBlockedResourceList(WhaleBlockedResourcePool* pool, size_t max_stored);
+  WhaleBlockedResourceList(const WhaleBlockedResourceList&) = delete;
+  WhaleBlockedResourceList& operator=(const WhaleBlockedResourceList&) =
+      delete;
+  ~WhaleBlockedResourceList();
+
+  // Returns false if |value| was already recorded.
+  bool Insert(base::StringPiece value);
+  void Clear();
+
+  // Distinct values recorded since the last Clear(), including those that
+  // weren't stored.
+  size_t count() const {
+    return ids_.size() + overflow_hashes_.size() + untracked_count_;
+  }
+  size_t stored_count() const { return ids_.size(); }
+
+  // Stored values, sorted.
+  std::vector<std::string> GetValues() const;
+  void AppendValues(std::vector<std::string>* values) const;
+
+  // Appends the values stored after |cursor|, in insertion order, and moves
+  // |cursor| to the end. If the list was cleared since |cursor| was taken,
+  // appends every stored value and returns false. The views stay valid
+  // until the next Clear().
+  bool ReadSince(Cursor* cursor, std::vector<base::StringPiece>* values) const;
+
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  raw_ptr<WhaleBlockedResourcePool> pool_;
+  const size_t max_stored_;
+  base::flat_set<uint32_t> ids_;
+  // |ids_| in insertion order.
+  std::vector<uint32_t> order_;
+  // Incremented by Clear() so that stale cursors can be detected.
+  uint32_t epoch_ = 1;
+  std::unordered_set<uint32_t> overflow_hashes_;
+  // Values counted after |overflow_hashes_| filled up.
+  size_t untracked_count_ = 0;
+};
+
+}  // namespace whale
+
+#endif  // WHALE_WHALE_BROWSER_UI_WHALE_BLOCKED_RESOURCE_POOL_H_
@@ -0,0 +1,375 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_blocking_stats_store.h"
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/containers/flat_map.h"
+#include "base/feature_list.h"
+#include "base/files/file.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/hash/hash.h"
+#include "base/logging.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/task/thread_pool.h"
+#include "content/public/browser/browser_context.h"
+#include "whale/components/tracking_blockers/common/features.h"
+
+namespace whale {
+
+namespace {
+
+const void* const kBlockingStatsStoreUserDataKey =
+    &kBlockingStatsStoreUserDataKey;
+
+constexpr base::FilePath::CharType kAggregatesFileName[] =
+    FILE_PATH_LITERAL("Whale Blocking Stats");
+constexpr base::FilePath::CharType kLogFileName[] =
+    FILE_PATH_LITERAL("Whale Blocking Stats Log");
+
+constexpr uint32_t kAggregatesMagic = 0x41534257;  // "WBSA"
+constexpr uint32_t kLogMagic = 0x4c534257;         // "WBSL"
+constexpr uint32_t kVersion = 1;
+
+struct AggregatesHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation;
+  uint32_t day_count;
+};
+
+struct DayRecord {
+  int32_t day;
+  uint32_t ads;
+  uint32_t trackers;
+  uint32_t url_params;
+};
+
+struct LogHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation;
+};
+
+struct LogRecord {
+  DayRecord stats;
+  // PersistentHash() of |stats|, so that a torn record is recognized.
+  uint32_t checksum;
+};
+
+// The aggregates file ends with a PersistentHash() of everything before it.
+constexpr size_t kAggregatesChecksumSize = sizeof(uint32_t);
+
+template <typename T>
+void AppendPod(std::string* out, const T& value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T ReadPod(const std::string& data, size_t offset) {
+  T value;
+  memcpy(&value, data.data() + offset, sizeof(T));
+  return value;
+}
+
+uint32_t GetChecksum(const void* data, size_t size) {
+  return base::PersistentHash(
+      base::make_span(static_cast<const uint8_t*>(data), size));
+}
+
+DayRecord ToDayRecord(const WhaleBlockingStatsStore::DailyStats& stats) {
+  return {stats.day, stats.ads, stats.trackers, stats.url_params};
+}
+
+void AddTo(WhaleBlockingStatsStore::DailyStats* total,
+           const DayRecord& record) {
+  total->day = record.day;
+  total->ads += record.ads;
+  total->trackers += record.trackers;
+  total->url_params += record.url_params;
+}
+
+}  // namespace
+
+// Owns the files; lives on the background sequence.
+class WhaleBlockingStatsStore::Backend {
+ public:
+  explicit Backend(const base::FilePath& profile_path)
+      : aggregates_path_(profile_path.Append(kAggregatesFileName)),
+        log_path_(profile_path.Append(kLogFileName)) {
+    LoadAggregates();
+    LoadLog();
+    if (log_records_ >= kMaxLogRecords) {
+      Compact();
+    }
+  }
+  Backend(const Backend&) = delete;
+  Backend& operator=(const Backend&) = delete;
+  ~Backend() = default;
+
+  void Append(const DailyStats& stats) {
+    if (log_records_ &&
+        (stats.day != log_day_ || log_records_ >= kMaxLogRecords)) {
+      Compact();
+    }
+    const DayRecord day_record = ToDayRecord(stats);
+    const LogRecord record{day_record,
+                           GetChecksum(&day_record, sizeof(day_record))};
+    AddTo(&days_[stats.day], day_record);
+    if (!log_.IsValid() ||
+        log_.Write(log_length_, reinterpret_cast<const char*>(&record),
+                   sizeof(record)) != static_cast<int>(sizeof(record))) {
+      // Keep what is already in |days_| by folding it into the aggregates
+      // right away; that also starts a new log.
+      Compact();
+      return;
+    }
+    log_length_ += sizeof(record);
+    ++log_records_;
+    log_day_ = stats.day;
+  }
+
+  std::vector<DailyStats> GetDailyStats() const {
+    std::vector<DailyStats> stats;
+    stats.reserve(days_.size());
+    for (const auto& [day, day_stats] : days_) {
+      stats.push_back(day_stats);
+    }
+    return stats;
+  }
+
+ private:
+  void LoadAggregates() {
+    std::string data;
+    if (!base::ReadFileToString(aggregates_path_, &data)) {
+      return;
+    }
+    const bool valid = [&] {
+      if (data.size() < sizeof(AggregatesHeader) + kAggregatesChecksumSize) {
+        return false;
+      }
+      const auto header = ReadPod<AggregatesHeader>(data, 0);
+      if (header.magic != kAggregatesMagic || header.version != kVersion ||
+          data.size() != sizeof(AggregatesHeader) +
+                             size_t{header.day_count} * sizeof(DayRecord) +
+                             kAggregatesChecksumSize) {
+        return false;
+      }
+      const size_t checksum_offset = data.size() - kAggregatesChecksumSize;
+      if (ReadPod<uint32_t>(data, checksum_offset) !=
+          GetChecksum(data.data(), checksum_offset)) {
+        return false;
+      }
+      generation_ = header.generation;
+      for (size_t offset = sizeof(AggregatesHeader); offset < checksum_offset;
+           offset += sizeof(DayRecord)) {
+        const auto record = ReadPod<DayRecord>(data, offset);
+        AddTo(&days_[record.day], record);
+      }
+      return true;
+    }();
+    UMA_HISTOGRAM_BOOLEAN("Whale.ITP.BlockingStats.AggregatesValid", valid);
+    if (!valid) {
+      // The file is replaced atomically, so this is damage from outside;
+      // start over rather than guess.
+      LOG(WARNING) << "Discarding invalid " << aggregates_path_;
+      days_.clear();
+    }
+  }
+
+  void LoadLog() {
+    std::string data;
+    if (!base::ReadFileToString(log_path_, &data) ||
+        data.size() < sizeof(LogHeader)) {
+      CreateLog();
+      return;
+    }
+    const auto header = ReadPod<LogHeader>(data, 0);
+    // A log from an older generation was folded into the aggregates before
+    // a crash kept it from being started over.
+    if (header.magic != kLogMagic || header.version != kVersion ||
+        header.generation != generation_) {
+      CreateLog();
+      return;
+    }
+
+    size_t offset = sizeof(LogHeader);
+    for (; offset + sizeof(LogRecord) <= data.size();
+         offset += sizeof(LogRecord)) {
+      const auto record = ReadPod<LogRecord>(data, offset);
+      if (record.checksum != GetChecksum(&record.stats, sizeof(DayRecord))) {
+        break;
+      }
+      AddTo(&days_[record.stats.day], record.stats);
+      ++log_records_;
+      log_day_ = record.stats.day;
+    }
+    const bool torn = offset != data.size();
+    UMA_HISTOGRAM_BOOLEAN("Whale.ITP.BlockingStats.TornLog", torn);
+
+    log_.Initialize(log_path_, base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+    log_length_ = offset;
+    // Drop the torn tail so that new records aren't appended after it.
+    if (torn && log_.IsValid() && !log_.SetLength(log_length_)) {
+      log_.Close();
+    }
+  }
+
+  void CreateLog() {
+    log_.Initialize(log_path_,
+                    base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+    log_records_ = 0;
+    log_length_ = 0;
+    if (!log_.IsValid()) {
+      LOG(WARNING) << "Failed to create " << log_path_;
+      return;
+    }
+    const LogHeader header{kLogMagic, kVersion, generation_};
+    if (log_.Write(0, reinterpret_cast<const char*>(&header),
+                   sizeof(header)) != static_cast<int>(sizeof(header))) {
+      log_.Close();
+      return;
+    }
+    log_length_ = sizeof(header);
+  }
+
+  // Writes |days_| out under the next generation and starts a new log.
+  // Until the new log exists, a leftover one is recognized as folded by
+  // its older generation.
+  void Compact() {
+    const uint32_t generation = generation_ + 1;
+    std::string data;
+    data.reserve(sizeof(AggregatesHeader) + days_.size() * sizeof(DayRecord) +
+                 kAggregatesChecksumSize);
+    AppendPod(&data,
+              AggregatesHeader{kAggregatesMagic, kVersion, generation,
+                               base::checked_cast<uint32_t>(days_.size())});
+    for (const auto& [day, stats] : days_) {
+      AppendPod(&data, ToDayRecord(stats));
+    }
+    AppendPod(&data, GetChecksum(data.data(), data.size()));
+    if (!base::ImportantFileWriter::WriteFileAtomically(aggregates_path_,
+                                                        data)) {
+      // Keep appending to the current log; its records are still needed.
+      return;
+    }
+    generation_ = generation;
+    log_.Close();
+    CreateLog();
+  }
+
+  const base::FilePath aggregates_path_;
+  const base::FilePath log_path_;
+
+  base::flat_map<int32_t, DailyStats> days_;
+  uint32_t generation_ = 0;
+
+  base::File log_;
+  int64_t log_length_ = 0;
+  size_t log_records_ = 0;
+  // Day of the last record in the log.
+  int32_t log_day_ = 0;
+};
+
+WhaleBlockingStatsStore::WhaleBlockingStatsStore(
+    const base::FilePath& profile_path,
+    scoped_refptr<base::SequencedTaskRunner> task_runner)
+    : backend_(std::move(task_runner), profile_path) {}
+
+WhaleBlockingStatsStore::~WhaleBlockingStatsStore() {
+  // Posted ahead of |backend_|'s destruction.
+  Flush();
+}
+
+// static
+WhaleBlockingStatsStore* WhaleBlockingStatsStore::GetForBrowserContext(
+    content::BrowserContext* browser_context) {
+  if (browser_context->IsOffTheRecord() ||
+      !base::FeatureList::IsEnabled(
+          whale_blocker::features::kPersistentBlockingStats)) {
+    return nullptr;
+  }
+  auto* store = static_cast<WhaleBlockingStatsStore*>(
+      browser_context->GetUserData(kBlockingStatsStoreUserDataKey));
+  if (!store) {
+    auto new_store = std::make_unique<WhaleBlockingStatsStore>(
+        browser_context->GetPath(),
+        base::ThreadPool::CreateSequencedTaskRunner(
+            {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+             base::TaskShutdownBehavior::BLOCK_SHUTDOWN}));
+    store = new_store.get();
+    browser_context->SetUserData(kBlockingStatsStoreUserDataKey,
+                                 std::move(new_store));
+  }
+  return store;
+}
+
+// static
+int32_t WhaleBlockingStatsStore::GetDay(base::Time time) {
+  base::Time::Exploded exploded;
+  time.LocalExplode(&exploded);
+  exploded.hour = 0;
+  exploded.minute = 0;
+  exploded.second = 0;
+  exploded.millisecond = 0;
+  base::Time midnight;
+  if (!base::Time::FromUTCExploded(exploded, &midnight)) {
+    return 0;
+  }
+  return base::saturated_cast<int32_t>(
+      (midnight - base::Time::UnixEpoch()).InDays());
+}
+
+void WhaleBlockingStatsStore::RecordBlocked(BlockType block_type,
+                                            uint32_t count) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!count) {
+    return;
+  }
+  const int32_t today = GetDay(base::Time::Now());
+  if (pending_.day != today) {
+    Flush();
+    pending_.day = today;
+  }
+  switch (block_type) {
+    case BlockType::Ads:
+      pending_.ads += count;
+      break;
+    case BlockType::Trackers:
+      pending_.trackers += count;
+      break;
+    case BlockType::URLParams:
+      pending_.url_params += count;
+      break;
+  }
+  if (!flush_timer_.IsRunning()) {
+    flush_timer_.Start(FROM_HERE, kFlushDelay, this,
+                       &WhaleBlockingStatsStore::Flush);
+  }
+}
+
+void WhaleBlockingStatsStore::GetDailyStats(DailyStatsCallback callback) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  Flush();
+  backend_.AsyncCall(&Backend::GetDailyStats).Then(std::move(callback));
+}
+
+void WhaleBlockingStatsStore::Flush() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  flush_timer_.Stop();
+  if (!pending_.ads && !pending_.trackers && !pending_.url_params) {
+    return;
+  }
+  backend_.AsyncCall(&Backend::Append).WithArgs(pending_);
+  pending_ = DailyStats{pending_.day};
+}
+
+}  // namespace whale
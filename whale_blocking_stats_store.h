@@ -0,0 +1,91 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_WHALE_BROWSER_UI_WHALE_BLOCKING_STATS_STORE_H_
+#define WHALE_WHALE_BROWSER_UI_WHALE_BLOCKING_STATS_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/functional/callback.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/sequence_checker.h"
+#include "base/supports_user_data.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/threading/sequence_bound.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "whale/whale/browser/ui/whale_shields_data_controller.h"
+
+namespace content {
+class BrowserContext;
+}
+
+namespace whale {
+
+// Lifetime statistics of what the shields blocked in a profile, kept as
+// per-day counts in the profile directory.
+//
+// Blocks are counted on the UI thread and handed to a background sequence
+// every |kFlushDelay|, which appends them to a log of fixed-size,
+// checksummed records. Once a day, or when the log grows past
+// |kMaxLogRecords|, the log is folded into the aggregates file, which is
+// replaced atomically, and started over. Both files carry a generation so
+// that a crash between the two steps doesn't count the log twice, and a
+// record torn by a crash is dropped along with anything after it.
+class WhaleBlockingStatsStore : public base::SupportsUserData::Data {
+ public:
+  struct DailyStats {
+    // Days since the Unix epoch, in local time. See GetDay().
+    int32_t day = 0;
+    uint32_t ads = 0;
+    uint32_t trackers = 0;
+    uint32_t url_params = 0;
+  };
+
+  using DailyStatsCallback =
+      base::OnceCallback<void(std::vector<DailyStats> stats)>;
+
+  static constexpr base::TimeDelta kFlushDelay = base::Seconds(30);
+  static constexpr size_t kMaxLogRecords = 4096;
+
+  // |task_runner| must allow blocking.
+  WhaleBlockingStatsStore(
+      const base::FilePath& profile_path,
+      scoped_refptr<base::SequencedTaskRunner> task_runner);
+  WhaleBlockingStatsStore(const WhaleBlockingStatsStore&) = delete;
+  WhaleBlockingStatsStore& operator=(const WhaleBlockingStatsStore&) = delete;
+  ~WhaleBlockingStatsStore() override;
+
+  // Returns null for off-the-record profiles, whose blocks aren't kept.
+  static WhaleBlockingStatsStore* GetForBrowserContext(
+      content::BrowserContext* browser_context);
+
+  static int32_t GetDay(base::Time time);
+
+  void RecordBlocked(BlockType block_type, uint32_t count = 1);
+
+  // Runs |callback| with the per-day counts in ascending day order,
+  // including blocks not written yet.
+  void GetDailyStats(DailyStatsCallback callback);
+
+  // Hands the pending counts to the background sequence now.
+  void Flush();
+
+ private:
+  class Backend;
+
+  base::SequenceBound<Backend> backend_;
+  DailyStats pending_;
+  base::OneShotTimer flush_timer_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+}  // namespace whale
+
+#endif  // WHALE_WHALE_BROWSER_UI_WHALE_BLOCKING_STATS_STORE_H_
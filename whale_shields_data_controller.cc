@@ -5,15 +5,39 @@
 
 #include "whale/whale/browser/ui/whale_shields_data_controller.h"
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "base/feature_list.h"
+#include "base/metrics/histogram_macros.h"
 #include "chrome/browser/content_settings/host_content_settings_map_factory.h"
-#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
 #include "content/public/browser/navigation_handle.h"
 #include "content/public/browser/web_contents.h"
 #include "net/base/url_util.h"
+#include "whale/components/tracking_blockers/common/features.h"
 #include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/ui/whale_blocking_stats_store.h"
+#include "whale/whale/browser/ui/whale_shields_settings_dispatcher.h"
 
 namespace {
 
+size_t GetMaxStoredBlockedResources() {
+  if (!base::FeatureList::IsEnabled(
+          whale_blocker::features::kBoundedBlockedResourceStore)) {
+    return std::numeric_limits<size_t>::max();
+  }
+  return std::max(0,
+                  whale_blocker::features::kMaxStoredBlockedResources.Get());
+}
+
+whale::WhaleBlockedResourcePool* GetBlockedResourcePool(
+    content::WebContents* web_contents) {
+  return whale::WhaleBlockedResourcePool::GetForBrowserContext(
+      web_contents->GetBrowserContext());
+}
+
 HostContentSettingsMap* GetHostContentSettingsMap(
     content::WebContents* web_contents) {
   return HostContentSettingsMapFactory::GetForProfile(
@@ -24,89 +48,171 @@ HostContentSettingsMap* GetHostContentSettingsMap(
 
 namespace whale {
 
-WhaleShieldsDataController::~WhaleShieldsDataController() = default;
+WhaleShieldsDataController::BlockedResourcesDelta::BlockedResourcesDelta() =
+    default;
+WhaleShieldsDataController::BlockedResourcesDelta::BlockedResourcesDelta(
+    const BlockedResourcesDelta&) = default;
+WhaleShieldsDataController::BlockedResourcesDelta&
+WhaleShieldsDataController::BlockedResourcesDelta::operator=(
+    const BlockedResourcesDelta&) = default;
+WhaleShieldsDataController::BlockedResourcesDelta::~BlockedResourcesDelta() =
+    default;
+
+bool WhaleShieldsDataController::BlockedResourcesDelta::empty() const {
+  return !cleared && added_ads.empty() && added_trackers.empty();
+}
+
+WhaleShieldsDataController::BlockedListsUpdate::BlockedListsUpdate() =
+    default;
+WhaleShieldsDataController::BlockedListsUpdate::BlockedListsUpdate(
+    BlockedListsUpdate&&) = default;
+WhaleShieldsDataController::BlockedListsUpdate&
+WhaleShieldsDataController::BlockedListsUpdate::operator=(
+    BlockedListsUpdate&&) = default;
+WhaleShieldsDataController::BlockedListsUpdate::~BlockedListsUpdate() =
+    default;
+
+WhaleShieldsDataController::~WhaleShieldsDataController() {
+  if (settings_dispatcher_) {
+    settings_dispatcher_->RemoveController(this);
+  }
+}
 
 WhaleShieldsDataController::WhaleShieldsDataController(
     content::WebContents* web_contents)
     : content::WebContentsObserver(web_contents),
-      content::WebContentsUserData<WhaleShieldsDataController>(*web_contents) {
-  observation_.Observe(GetHostContentSettingsMap(web_contents));
+      content::WebContentsUserData<WhaleShieldsDataController>(*web_contents),
+      resource_list_blocked_ads_(GetBlockedResourcePool(web_contents),
+                                 GetMaxStoredBlockedResources()),
+      resource_list_blocked_trackers_(GetBlockedResourcePool(web_contents),
+                                      GetMaxStoredBlockedResources()),
+      resource_list_blocked_url_params_(GetBlockedResourcePool(web_contents),
+                                        GetMaxStoredBlockedResources()),
+      settings_dispatcher_(WhaleShieldsSettingsDispatcher::GetForBrowserContext(
+          web_contents->GetBrowserContext())),
+      blocking_stats_(WhaleBlockingStatsStore::GetForBrowserContext(
+          web_contents->GetBrowserContext())) {
+  settings_dispatcher_->UpdateSite(this, GetCurrentSiteURL());
 }
 
 void WhaleShieldsDataController::DidFinishNavigation(
     content::NavigationHandle* navigation_handle) {
   if (navigation_handle->IsInMainFrame() && navigation_handle->HasCommitted() &&
       !navigation_handle->IsSameDocument()) {
+    navigation_id_ = navigation_handle->GetNavigationId();
+    if (settings_dispatcher_) {
+      settings_dispatcher_->UpdateSite(this, GetCurrentSiteURL());
+    }
     ClearAllResourcesList();
   }
 }
 
 void WhaleShieldsDataController::WebContentsDestroyed() {
-  observation_.Reset();
+  if (settings_dispatcher_) {
+    settings_dispatcher_->RemoveController(this);
+    settings_dispatcher_ = nullptr;
+  }
+  notify_timer_.Stop();
 }
 
 void WhaleShieldsDataController::ReloadWebContents() {
   web_contents()->GetController().Reload(content::ReloadType::NORMAL, true);
 }
 
-void WhaleShieldsDataController::OnContentSettingChanged(
-    const ContentSettingsPattern& primary_pattern,
-    const ContentSettingsPattern& secondary_pattern,
-    ContentSettingsTypeSet content_type_set) {
-  if ((content_type_set.ContainsAllTypes() ||
-       content_type_set.GetType() == ContentSettingsType::TRACKING_BLOCKER) &&
-      primary_pattern.Matches(GetCurrentSiteURL())) {
-    for (Observer& obs : observer_list_) {
-      obs.OnTrackingBlockerEnabledChanged();
-    }
+void WhaleShieldsDataController::NotifyTrackingBlockerEnabledChanged() {
+  for (Observer& obs : observer_list_) {
+    obs.OnTrackingBlockerEnabledChanged();
   }
 }
 
 void WhaleShieldsDataController::ClearAllResourcesList() {
-  resource_list_blocked_ads_.clear();
-  resource_list_blocked_trackers_.clear();
-  if (!keep_blocked_url_params_record_) {
-    resource_list_blocked_url_params_.clear();
+  const int total_blocked = GetTotalBlockedCount();
+  if (total_blocked) {
+    UMA_HISTOGRAM_COUNTS_10000("Whale.ITP.BlockedResources.PerPageCount",
+                               total_blocked);
+    UMA_HISTOGRAM_MEMORY_KB("Whale.ITP.BlockedResources.PerPageMemory",
+                            EstimateMemoryUsage() / 1024);
+  }
+
+  resource_list_blocked_ads_.Clear();
+  resource_list_blocked_trackers_.Clear();
+  const bool keep_url_params = keep_blocked_url_params_record_;
+  if (!keep_url_params) {
+    resource_list_blocked_url_params_.Clear();
   }
   keep_blocked_url_params_record_ = false;
 
-  for (Observer& obs : observer_list_) {
-    obs.OnResourcesChanged();
+  // Pending additions are gone with the lists, so report the reset now
+  // along with whatever survived it.
+  pending_delta_ = BlockedResourcesDelta();
+  pending_delta_.cleared = true;
+  if (keep_url_params) {
+    pending_delta_.added_trackers =
+        resource_list_blocked_url_params_.GetValues();
   }
+  notify_timer_.Stop();
+  NotifyResourcesChanged();
 }
 
 int WhaleShieldsDataController::GetTotalBlockedCount() {
-  return resource_list_blocked_ads_.size() +
-         resource_list_blocked_trackers_.size() +
-         resource_list_blocked_url_params_.size();
+  return resource_list_blocked_ads_.count() +
+         resource_list_blocked_trackers_.count() +
+         resource_list_blocked_url_params_.count();
 }
 
 int WhaleShieldsDataController::GetBlockedTrackersCount() {
-  return resource_list_blocked_trackers_.size() +
-         resource_list_blocked_url_params_.size();
+  return resource_list_blocked_trackers_.count() +
+         resource_list_blocked_url_params_.count();
 }
 
 int WhaleShieldsDataController::GetBlockedAdsCount() {
-  return resource_list_blocked_ads_.size();
+  return resource_list_blocked_ads_.count();
 }
 
 std::vector<std::string> WhaleShieldsDataController::GetBlockedAdsList() {
-  std::vector<std::string> blocked_ads(resource_list_blocked_ads_.begin(),
-                                       resource_list_blocked_ads_.end());
-
-  return blocked_ads;
+  return resource_list_blocked_ads_.GetValues();
 }
 
 std::vector<std::string> WhaleShieldsDataController::GetBlockedTrackersList() {
-  std::vector<std::string> blocked_trackers(
-      resource_list_blocked_trackers_.begin(),
-      resource_list_blocked_trackers_.end());
+  std::vector<std::string> blocked_trackers =
+      resource_list_blocked_trackers_.GetValues();
+  resource_list_blocked_url_params_.AppendValues(&blocked_trackers);
+  return blocked_trackers;
+}
 
-  for (auto param : resource_list_blocked_url_params_) {
-    blocked_trackers.push_back(param);
+WhaleShieldsDataController::BlockedListsUpdate
+WhaleShieldsDataController::GetBlockedListsSince(
+    BlockedListsCursor* cursor) const {
+  BlockedListsUpdate update;
+  std::vector<base::StringPiece> url_params;
+  bool up_to_date =
+      resource_list_blocked_ads_.ReadSince(&cursor->ads, &update.ads);
+  up_to_date &= resource_list_blocked_trackers_.ReadSince(&cursor->trackers,
+                                                          &update.trackers);
+  up_to_date &= resource_list_blocked_url_params_.ReadSince(
+      &cursor->url_params, &url_params);
+  if (!up_to_date) {
+    // The reader drops everything it had on a reset, so all lists are sent
+    // again even if only one of them was cleared.
+    update = BlockedListsUpdate();
+    url_params.clear();
+    *cursor = BlockedListsCursor();
+    resource_list_blocked_ads_.ReadSince(&cursor->ads, &update.ads);
+    resource_list_blocked_trackers_.ReadSince(&cursor->trackers,
+                                              &update.trackers);
+    resource_list_blocked_url_params_.ReadSince(&cursor->url_params,
+                                                &url_params);
+    update.reset = true;
   }
+  update.trackers.insert(update.trackers.end(), url_params.begin(),
+                         url_params.end());
+  return update;
+}
 
-  return blocked_trackers;
+size_t WhaleShieldsDataController::EstimateMemoryUsage() const {
+  return resource_list_blocked_ads_.EstimateMemoryUsage() +
+         resource_list_blocked_trackers_.EstimateMemoryUsage() +
+         resource_list_blocked_url_params_.EstimateMemoryUsage();
 }
 
 bool WhaleShieldsDataController::GetTrackingBlockerEnabled() {
@@ -137,24 +243,78 @@ void WhaleShieldsDataController::HandleItemBlocked(
     const BlockType& block_type,
     const std::string& subresource) {
   if (block_type == BlockType::Ads) {
-    resource_list_blocked_ads_.insert(subresource);
+    if (!resource_list_blocked_ads_.Insert(subresource)) {
+      return;
+    }
+    pending_delta_.added_ads.push_back(subresource);
   } else if (block_type == BlockType::Trackers) {
-    resource_list_blocked_trackers_.insert(subresource);
+    if (!resource_list_blocked_trackers_.Insert(subresource)) {
+      return;
+    }
+    pending_delta_.added_trackers.push_back(subresource);
+  } else {
+    return;
   }
-
-  for (Observer& obs : observer_list_) {
-    obs.OnResourcesChanged();
+  if (blocking_stats_) {
+    blocking_stats_->RecordBlocked(block_type);
   }
+
+  ScheduleResourcesChangedNotification();
 }
 
 void WhaleShieldsDataController::HandleURLParamsBlocked(
     const std::vector<std::string>& params) {
-  for (auto param : params) {
-    resource_list_blocked_url_params_.insert(param);
+  uint32_t added = 0;
+  for (const auto& param : params) {
+    if (resource_list_blocked_url_params_.Insert(param)) {
+      pending_delta_.added_trackers.push_back(param);
+      ++added;
+    }
+  }
+  if (blocking_stats_) {
+    blocking_stats_->RecordBlocked(BlockType::URLParams, added);
   }
   keep_blocked_url_params_record_ = true;
 
+  ScheduleResourcesChangedNotification();
+}
+
+void WhaleShieldsDataController::AddObserver(Observer* obs) {
+  observer_list_.AddObserver(obs);
+}
+
+void WhaleShieldsDataController::RemoveObserver(Observer* obs) {
+  observer_list_.RemoveObserver(obs);
+}
+
+void WhaleShieldsDataController::ScheduleResourcesChangedNotification() {
+  if (pending_delta_.empty() || notify_timer_.IsRunning()) {
+    return;
+  }
+  // The first block after a quiet interval goes out right away; the ones
+  // that follow it within the interval are coalesced.
+  notify_timer_.Start(FROM_HERE, kResourcesChangedInterval, this,
+                      &WhaleShieldsDataController::OnResourcesChangedTimer);
+  NotifyResourcesChanged();
+}
+
+void WhaleShieldsDataController::OnResourcesChangedTimer() {
+  if (pending_delta_.empty()) {
+    return;
+  }
+  notify_timer_.Start(FROM_HERE, kResourcesChangedInterval, this,
+                      &WhaleShieldsDataController::OnResourcesChangedTimer);
+  NotifyResourcesChanged();
+}
+
+void WhaleShieldsDataController::NotifyResourcesChanged() {
+  if (pending_delta_.empty()) {
+    return;
+  }
+  BlockedResourcesDelta delta;
+  std::swap(delta, pending_delta_);
   for (Observer& obs : observer_list_) {
+    obs.OnBlockedResourcesDelta(delta);
     obs.OnResourcesChanged();
   }
 }
@@ -6,18 +6,19 @@
 #ifndef WHALE_WHALE_BROWSER_UI_WHALE_SHIELDS_DATA_CONTROLLER_H_
 #define WHALE_WHALE_BROWSER_UI_WHALE_SHIELDS_DATA_CONTROLLER_H_
 
-#include <set>
 #include <string>
 #include <vector>
 
+#include "base/memory/raw_ptr.h"
 #include "base/observer_list.h"
 #include "base/observer_list_types.h"
-#include "base/scoped_observation.h"
-#include "components/content_settings/core/browser/content_settings_observer.h"
-#include "components/content_settings/core/browser/host_content_settings_map.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "content/public/browser/navigation_entry.h"
 #include "content/public/browser/web_contents_observer.h"
 #include "content/public/browser/web_contents_user_data.h"
+#include "whale/whale/browser/ui/whale_blocked_resource_pool.h"
 
 enum BlockType {
   Ads = 0,
@@ -27,22 +28,77 @@ enum BlockType {
 
 namespace whale {
 
+class WhaleBlockingStatsStore;
+class WhaleShieldsSettingsDispatcher;
+
 class WhaleShieldsDataController
     : public content::WebContentsObserver,
-      public content::WebContentsUserData<WhaleShieldsDataController>,
-      public content_settings::Observer {
+      public content::WebContentsUserData<WhaleShieldsDataController> {
  public:
   WhaleShieldsDataController(const WhaleShieldsDataController&) = delete;
   WhaleShieldsDataController& operator=(const WhaleShieldsDataController&) =
       delete;
   ~WhaleShieldsDataController() override;
 
+  // What was blocked since the previous notification.
+  struct BlockedResourcesDelta {
+    BlockedResourcesDelta();
+    BlockedResourcesDelta(const BlockedResourcesDelta&);
+    BlockedResourcesDelta& operator=(const BlockedResourcesDelta&);
+    ~BlockedResourcesDelta();
+
+    bool empty() const;
+
+    // The lists were reset (e.g. by a navigation) before the additions.
+    bool cleared = false;
+    std::vector<std::string> added_ads;
+    // Tracker URLs and removed URL parameters, as in
+    // GetBlockedTrackersList().
+    std::vector<std::string> added_trackers;
+  };
+
+  // Where a reader of the blocked lists left off; default-constructed to
+  // read everything.
+  struct BlockedListsCursor {
+    WhaleBlockedResourceList::Cursor ads;
+    WhaleBlockedResourceList::Cursor trackers;
+    WhaleBlockedResourceList::Cursor url_params;
+  };
+
+  // Entries blocked since a cursor. The views point into the per-profile
+  // pool and are valid until the lists are cleared by the next navigation;
+  // copy what has to outlive the current task.
+  struct BlockedListsUpdate {
+    BlockedListsUpdate();
+    BlockedListsUpdate(BlockedListsUpdate&&);
+    BlockedListsUpdate& operator=(BlockedListsUpdate&&);
+    ~BlockedListsUpdate();
+
+    // The lists were cleared since the cursor was taken; |ads| and
+    // |trackers| hold everything and replace what the reader had.
+    bool reset = false;
+    std::vector<base::StringPiece> ads;
+    // Tracker URLs followed by removed URL parameters.
+    std::vector<base::StringPiece> trackers;
+  };
+
+  // Blocks are coalesced: observers hear about the first one right away and
+  // about the rest at most once per |kResourcesChangedInterval|, while
+  // clears are delivered right away.
+  static constexpr base::TimeDelta kResourcesChangedInterval =
+      base::Milliseconds(100);
+
   class Observer : public base::CheckedObserver {
    public:
     virtual void OnResourcesChanged() = 0;
+    // Called just before OnResourcesChanged().
+    virtual void OnBlockedResourcesDelta(const BlockedResourcesDelta& delta) {}
     virtual void OnTrackingBlockerEnabledChanged() {}
   };
 
+  void AddObserver(Observer* obs);
+  void RemoveObserver(Observer* obs);
+
   void HandleItemBlocked(const BlockType& block_type,
                          const std::string& subresource);
   void HandleURLParamsBlocked(const std::vector<std::string>& params);
@@ -57,6 +113,18 @@ class WhaleShieldsDataController
   GURL GetCurrentSiteURL();
   std::vector<std::string> GetBlockedAdsList();
   std::vector<std::string> GetBlockedTrackersList();
+  // Returns what was blocked since |cursor| and advances it, so that a
+  // refresh costs the number of new entries rather than all of them.
+  BlockedListsUpdate GetBlockedListsSince(BlockedListsCursor* cursor) const;
+  size_t EstimateMemoryUsage() const;
+
+  // Id of the navigation that committed the current main frame document, 0
+  // before the first one. Navigation ids only increase.
+  int64_t navigation_id() const { return navigation_id_; }
+
+  // Called by WhaleShieldsSettingsDispatcher when a TRACKING_BLOCKER
+  // setting matching the current site changes.
+  void NotifyTrackingBlockerEnabledChanged();
 
  private:
   friend class content::WebContentsUserData<WhaleShieldsDataController>;
@@ -64,26 +132,27 @@ class WhaleShieldsDataController
   explicit WhaleShieldsDataController(content::WebContents* web_contents);
 
   void ReloadWebContents();
+  void ScheduleResourcesChangedNotification();
+  void OnResourcesChangedTimer();
+  void NotifyResourcesChanged();
 
   // content::WebContentsObserver
   void DidFinishNavigation(
       content::NavigationHandle* navigation_handle) override;
   void WebContentsDestroyed() override;
 
-  // content_settings::Observer
-  void OnContentSettingChanged(
-      const ContentSettingsPattern& primary_pattern,
-      const ContentSettingsPattern& secondary_pattern,
-      ContentSettingsTypeSet content_type_set) override;
-
   base::ObserverList<Observer> observer_list_;
-  std::set<std::string> resource_list_blocked_ads_;
-  std::set<std::string> resource_list_blocked_trackers_;
-  std::set<std::string> resource_list_blocked_url_params_;
+  WhaleBlockedResourceList resource_list_blocked_ads_;
+  WhaleBlockedResourceList resource_list_blocked_trackers_;
+  WhaleBlockedResourceList resource_list_blocked_url_params_;
 
   bool keep_blocked_url_params_record_ = false;
-  base::ScopedObservation<HostContentSettingsMap, content_settings::Observer>
-      observation_{this};
+  int64_t navigation_id_ = 0;
+  BlockedResourcesDelta pending_delta_;
+  base::OneShotTimer notify_timer_;
+  raw_ptr<WhaleShieldsSettingsDispatcher> settings_dispatcher_;
+  // Null for off-the-record profiles.
+  raw_ptr<WhaleBlockingStatsStore> blocking_stats_;
 
   WEB_CONTENTS_USER_DATA_KEY_DECL();
 };
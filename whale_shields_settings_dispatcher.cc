@@ -0,0 +1,166 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/whale/browser/ui/whale_shields_settings_dispatcher.h"
+
+#include <memory>
+#include <utility>
+
+#include "base/functional/bind.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/string_util.h"
+#include "chrome/browser/content_settings/host_content_settings_map_factory.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
+#include "content/public/browser/browser_context.h"
+#include "url/gurl.h"
+#include "whale/components/tracking_blockers/common/registrable_domain_cache.h"
+#include "whale/components/tracking_blockers/tracking_blockers_util.h"
+#include "whale/whale/browser/ui/whale_shields_data_controller.h"
+
+namespace whale {
+
+namespace {
+
+const void* const kShieldsSettingsDispatcherUserDataKey =
+    &kShieldsSettingsDispatcherUserDataKey;
+
+std::string GetSiteKey(base::StringPiece host) {
+  if (base::EndsWith(host, ".")) {
+    host.remove_suffix(1);
+  }
+  std::string domain = whale_blocker::GetCachedDomainAndRegistry(host);
+  return domain.empty() ? std::string(host) : domain;
+}
+
+}  // namespace
+
+WhaleShieldsSettingsDispatcher::WhaleShieldsSettingsDispatcher(
+    content::BrowserContext* browser_context)
+    : browser_context_(browser_context),
+      map_(HostContentSettingsMapFactory::GetForProfile(browser_context)) {
+  observation_.Observe(map_.get());
+  batch_subscription_ = whale_blocker::AddTrackingBlockerBatchCallback(
+      browser_context,
+      base::BindRepeating(&WhaleShieldsSettingsDispatcher::OnBatchUpdate,
+                          base::Unretained(this)));
+}
+
+WhaleShieldsSettingsDispatcher::~WhaleShieldsSettingsDispatcher() = default;
+
+// static
+WhaleShieldsSettingsDispatcher*
+WhaleShieldsSettingsDispatcher::GetForBrowserContext(
+    content::BrowserContext* browser_context) {
+  auto* dispatcher = static_cast<WhaleShieldsSettingsDispatcher*>(
+      browser_context->GetUserData(kShieldsSettingsDispatcherUserDataKey));
+  if (!dispatcher) {
+    auto new_dispatcher =
+        std::make_unique<WhaleShieldsSettingsDispatcher>(browser_context);
+    dispatcher = new_dispatcher.get();
+    browser_context->SetUserData(kShieldsSettingsDispatcherUserDataKey,
+                                 std::move(new_dispatcher));
+  }
+  return dispatcher;
+}
+
+void WhaleShieldsSettingsDispatcher::UpdateSite(
+    WhaleShieldsDataController* controller,
+    const GURL& site_url) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  std::string key = GetSiteKey(site_url.host_piece());
+  auto it = site_keys_.find(controller);
+  if (it != site_keys_.end()) {
+    if (it->second == key) {
+      return;
+    }
+    RemoveController(controller);
+  }
+  controllers_by_site_[key].insert(controller);
+  site_keys_.emplace(controller, std::move(key));
+}
+
+void WhaleShieldsSettingsDispatcher::RemoveController(
+    WhaleShieldsDataController* controller) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = site_keys_.find(controller);
+  if (it == site_keys_.end()) {
+    return;
+  }
+  auto bucket = controllers_by_site_.find(it->second);
+  DCHECK(bucket != controllers_by_site_.end());
+  bucket->second.erase(controller);
+  if (bucket->second.empty()) {
+    controllers_by_site_.erase(bucket);
+  }
+  site_keys_.erase(it);
+}
+
+void WhaleShieldsSettingsDispatcher::OnContentSettingChanged(
+    const ContentSettingsPattern& primary_pattern,
+    const ContentSettingsPattern& secondary_pattern,
+    ContentSettingsTypeSet content_type_set) {
+  if ((!content_type_set.ContainsAllTypes() &&
+       content_type_set.GetType() != ContentSettingsType::TRACKING_BLOCKER) ||
+      whale_blocker::IsTrackingBlockerBatchCommitting(browser_context_)) {
+    return;
+  }
+  base::flat_set<WhaleShieldsDataController*> matches;
+  CollectMatches(primary_pattern, &matches);
+  Notify(matches);
+}
+
+void WhaleShieldsSettingsDispatcher::OnBatchUpdate(
+    const std::vector<ContentSettingsPattern>& patterns) {
+  base::flat_set<WhaleShieldsDataController*> matches;
+  for (const auto& pattern : patterns) {
+    CollectMatches(pattern, &matches);
+  }
+  Notify(matches);
+}
+
+void WhaleShieldsSettingsDispatcher::CollectMatches(
+    const ContentSettingsPattern& pattern,
+    base::flat_set<WhaleShieldsDataController*>* matches) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto add_matching = [&](const auto& controllers) {
+    for (WhaleShieldsDataController* controller : controllers) {
+      if (pattern.Matches(controller->GetCurrentSiteURL())) {
+        matches->insert(controller);
+      }
+    }
+  };
+
+  const std::string host = pattern.GetHost();
+  std::string key;
+  if (!host.empty() && !pattern.MatchesAllHosts()) {
+    key = GetSiteKey(host);
+    // "[*.]" on a public suffix or an IP spans more than one bucket.
+    if (pattern.HasDomainWildcard() &&
+        whale_blocker::GetCachedDomainAndRegistry(key).empty()) {
+      key.clear();
+    }
+  }
+  if (key.empty()) {
+    for (const auto& [site, controllers] : controllers_by_site_) {
+      add_matching(controllers);
+    }
+    return;
+  }
+  auto it = controllers_by_site_.find(key);
+  if (it != controllers_by_site_.end()) {
+    add_matching(it->second);
+  }
+}
+
+void WhaleShieldsSettingsDispatcher::Notify(
+    const base::flat_set<WhaleShieldsDataController*>& matches) {
+  for (WhaleShieldsDataController* controller : matches) {
+    // Observers may close tabs; skip controllers that went away.
+    if (site_keys_.contains(controller)) {
+      controller->NotifyTrackingBlockerEnabledChanged();
+    }
+  }
+}
+
+}  // namespace whale
@@ -0,0 +1,91 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_WHALE_BROWSER_UI_WHALE_SHIELDS_SETTINGS_DISPATCHER_H_
+#define WHALE_WHALE_BROWSER_UI_WHALE_SHIELDS_SETTINGS_DISPATCHER_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/callback_list.h"
+#include "base/containers/flat_map.h"
+#include "base/containers/flat_set.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/scoped_observation.h"
+#include "base/sequence_checker.h"
+#include "base/supports_user_data.h"
+#include "components/content_settings/core/browser/content_settings_observer.h"
+#include "components/content_settings/core/browser/host_content_settings_map.h"
+
+class GURL;
+
+namespace content {
+class BrowserContext;
+}
+
+namespace whale {
+
+class WhaleShieldsDataController;
+
+// Per-profile fan-out of TRACKING_BLOCKER changes to the tabs they affect.
+// Observing HostContentSettingsMap from every tab made each change cost
+// one callback per open tab; instead this observes once and keeps the live
+// controllers indexed by the registrable domain (or host, for IPs and the
+// like) of their current site, so a change for one site only reaches the
+// tabs showing it. Must be used on the UI thread.
+class WhaleShieldsSettingsDispatcher : public base::SupportsUserData::Data,
+                                       public content_settings::Observer {
+ public:
+  explicit WhaleShieldsSettingsDispatcher(
+      content::BrowserContext* browser_context);
+  WhaleShieldsSettingsDispatcher(const WhaleShieldsSettingsDispatcher&) =
+      delete;
+  WhaleShieldsSettingsDispatcher& operator=(
+      const WhaleShieldsSettingsDispatcher&) = delete;
+  ~WhaleShieldsSettingsDispatcher() override;
+
+  static WhaleShieldsSettingsDispatcher* GetForBrowserContext(
+      content::BrowserContext* browser_context);
+
+  // Adds |controller| or moves it to the bucket of |site_url|.
+  void UpdateSite(WhaleShieldsDataController* controller,
+                  const GURL& site_url);
+  void RemoveController(WhaleShieldsDataController* controller);
+
+  size_t controller_count() const { return site_keys_.size(); }
+
+ private:
+  // content_settings::Observer:
+  void OnContentSettingChanged(
+      const ContentSettingsPattern& primary_pattern,
+      const ContentSettingsPattern& secondary_pattern,
+      ContentSettingsTypeSet content_type_set) override;
+
+  void OnBatchUpdate(const std::vector<ContentSettingsPattern>& patterns);
+
+  // Adds the controllers whose current site |pattern| matches.
+  void CollectMatches(const ContentSettingsPattern& pattern,
+                      base::flat_set<WhaleShieldsDataController*>* matches);
+  void Notify(const base::flat_set<WhaleShieldsDataController*>& matches);
+
+  raw_ptr<content::BrowserContext> browser_context_;
+  scoped_refptr<HostContentSettingsMap> map_;
+  std::map<std::string, base::flat_set<WhaleShieldsDataController*>>
+      controllers_by_site_;
+  base::flat_map<WhaleShieldsDataController*, std::string> site_keys_;
+
+  base::ScopedObservation<HostContentSettingsMap, content_settings::Observer>
+      observation_{this};
+  base::CallbackListSubscription batch_subscription_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+};
+
+}  // namespace whale
+
+#endif  // WHALE_WHALE_BROWSER_UI_WHALE_SHIELDS_SETTINGS_DISPATCHER_H_
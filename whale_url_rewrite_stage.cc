@@ -0,0 +1,210 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "whale/services/network/whale_url_rewrite_stage.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/functional/bind.h"
+#include "mojo/public/cpp/bindings/remote.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_version.h"
+#include "net/url_request/redirect_info.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "services/network/public/mojom/network_context.mojom.h"
+#include "services/network/public/mojom/url_loader.mojom.h"
+#include "services/network/public/mojom/url_response_head.mojom.h"
+#include "services/network/url_loader_factory.h"
+#include "url/origin.h"
+#include "whale/components/tracking_blockers/common/url_rewriter.h"
+
+namespace network {
+
+// Answers a request with a 307 to its filtered URL and keeps it until the
+// client follows the redirect.
+class WhaleURLRewriteStage::RedirectLoader : public mojom::URLLoader {
+ public:
+  RedirectLoader(
+      WhaleURLRewriteStage* stage,
+      mojo::PendingReceiver<mojom::URLLoader> receiver,
+      int32_t request_id,
+      uint32_t options,
+      ResourceRequest request,
+      const GURL& new_url,
+      mojo::PendingRemote<mojom::URLLoaderClient> client,
+      const net::MutableNetworkTrafficAnnotationTag& traffic_annotation)
+      : stage_(stage),
+        receiver_(this, std::move(receiver)),
+        client_(std::move(client)),
+        request_id_(request_id),
+        options_(options),
+        request_(std::move(request)),
+        traffic_annotation_(traffic_annotation) {
+    receiver_.set_disconnect_handler(
+        base::BindOnce(&WhaleURLRewriteStage::RemoveRedirect,
+                       base::Unretained(stage_), base::Unretained(this)));
+
+    constexpr int kInternalRedirectStatusCode = 307;
+    redirect_info_ = net::RedirectInfo::ComputeRedirectInfo(
+        request_.method, request_.url, request_.site_for_cookies,
+        request_.update_first_party_url_on_redirect
+            ? net::RedirectInfo::FirstPartyURLPolicy::UPDATE_URL_ON_REDIRECT
+            : net::RedirectInfo::FirstPartyURLPolicy::NEVER_CHANGE_URL,
+        request_.referrer_policy, request_.referrer.spec(),
+        kInternalRedirectStatusCode, new_url,
+        absl::nullopt /* referrer_policy_header */,
+        false /* insecure_scheme_was_upgraded */, false /* copy_fragment */,
+        false /* is_signed_exchange_fallback_redirect */);
+
+    // Same tainted origin handling as the proxy, see step 10 of
+    // https://fetch.spec.whatwg.org/#http-redirect-fetch
+    if (request_.request_initiator &&
+        !request_.request_initiator->IsSameOriginWith(request_.url) &&
+        !url::Origin::Create(new_url).IsSameOriginWith(request_.url)) {
+      request_.request_initiator = url::Origin();
+    }
+
+    mojom::URLResponseHeadPtr head = mojom::URLResponseHead::New();
+    head->headers =
+        net::HttpResponseHeaders::Builder(net::HttpVersion(1, 1),
+                                          "307 Internal Redirect")
+            .AddHeader("Location", new_url.spec())
+            .AddHeader("Non-Authoritative-Reason", "WebRequest API")
+            .Build();
+    head->encoded_data_length = 0;
+    client_->OnReceiveRedirect(redirect_info_, std::move(head));
+  }
+
+  RedirectLoader(const RedirectLoader&) = delete;
+  RedirectLoader& operator=(const RedirectLoader&) = delete;
+  ~RedirectLoader() override = default;
+
+  void Start(URLLoaderFactory* factory) {
+    factory->CreateLoaderAndStart(receiver_.Unbind(), request_id_, options_,
+                                  request_, client_.Unbind(),
+                                  traffic_annotation_);
+  }
+
+  // mojom::URLLoader:
+  void FollowRedirect(
+      const std::vector<std::string>& removed_headers,
+      const net::HttpRequestHeaders& modified_headers,
+      const net::HttpRequestHeaders& modified_cors_exempt_headers,
+      const absl::optional<GURL>& new_url) override {
+    for (const std::string& name : removed_headers) {
+      request_.headers.RemoveHeader(name);
+      request_.cors_exempt_headers.RemoveHeader(name);
+    }
+    request_.headers.MergeFrom(modified_headers);
+    request_.cors_exempt_headers.MergeFrom(modified_cors_exempt_headers);
+    request_.url = new_url.value_or(redirect_info_.new_url);
+    request_.method = redirect_info_.new_method;
+    request_.site_for_cookies = redirect_info_.new_site_for_cookies;
+    request_.referrer = GURL(redirect_info_.new_referrer);
+    request_.referrer_policy = redirect_info_.new_referrer_policy;
+    // Deletes |this|.
+    stage_->OnRedirectFollowed(this);
+  }
+  void SetPriority(net::RequestPriority priority,
+                   int32_t intra_priority_value) override {
+    request_.priority = priority;
+  }
+  void PauseReadingBodyFromNet() override {}
+  void ResumeReadingBodyFromNet() override {}
+
+ private:
+  const raw_ptr<WhaleURLRewriteStage> stage_;
+  mojo::Receiver<mojom::URLLoader> receiver_;
+  mojo::Remote<mojom::URLLoaderClient> client_;
+  const int32_t request_id_;
+  const uint32_t options_;
+  ResourceRequest request_;
+  const net::MutableNetworkTrafficAnnotationTag traffic_annotation_;
+  net::RedirectInfo redirect_info_;
+};
+
+// static
+std::unique_ptr<WhaleURLRewriteStage> WhaleURLRewriteStage::MaybeCreate(
+    URLLoaderFactory* factory,
+    mojom::URLLoaderFactoryParams* params) {
+  if (!params->whale_url_rewrite_settings) {
+    return nullptr;
+  }
+  return std::make_unique<WhaleURLRewriteStage>(
+      factory, std::move(params->whale_url_rewrite_settings),
+      std::move(params->whale_url_rewrite_settings_observer));
+}
+
+WhaleURLRewriteStage::WhaleURLRewriteStage(
+    URLLoaderFactory* factory,
+    whale_blocker::mojom::URLRewriteSettingsPtr settings,
+    mojo::PendingReceiver<whale_blocker::mojom::URLRewriteSettingsObserver>
+        receiver)
+    : factory_(factory), settings_(std::move(settings)) {
+  DCHECK(settings_);
+  if (receiver.is_valid()) {
+    receiver_.Bind(std::move(receiver));
+  }
+}
+
+WhaleURLRewriteStage::~WhaleURLRewriteStage() = default;
+
+bool WhaleURLRewriteStage::MaybeRewrite(
+    mojo::PendingReceiver<mojom::URLLoader>& receiver,
+    int32_t request_id,
+    uint32_t options,
+    const ResourceRequest& request,
+    mojo::PendingRemote<mojom::URLLoaderClient>& client,
+    const net::MutableNetworkTrafficAnnotationTag& traffic_annotation) {
+  whale_blocker::URLRewriteResult rewrite =
+      whale_blocker::ComputeURLRewrite(*settings_, request);
+  // A restarted request comes back here with the referrer already capped.
+  if (rewrite.new_referrer && *rewrite.new_referrer == request.referrer) {
+    rewrite.new_referrer.reset();
+  }
+  if (!rewrite.HasChanges()) {
+    return false;
+  }
+
+  ResourceRequest rewritten_request(request);
+  if (rewrite.new_referrer) {
+    rewritten_request.referrer = std::move(*rewrite.new_referrer);
+  }
+  if (!rewrite.new_url) {
+    factory_->CreateLoaderAndStart(std::move(receiver), request_id, options,
+                                   rewritten_request, std::move(client),
+                                   traffic_annotation);
+    return true;
+  }
+
+  redirects_.insert(std::make_unique<RedirectLoader>(
+      this, std::move(receiver), request_id, options,
+      std::move(rewritten_request), *rewrite.new_url, std::move(client),
+      traffic_annotation));
+  return true;
+}
+
+void WhaleURLRewriteStage::OnURLRewriteSettingsChanged(
+    whale_blocker::mojom::URLRewriteSettingsPtr settings) {
+  settings_ = std::move(settings);
+}
+
+void WhaleURLRewriteStage::OnRedirectFollowed(RedirectLoader* loader) {
+  auto it = redirects_.find(loader);
+  DCHECK(it != redirects_.end());
+  // Taken out first since starting the request can re-enter MaybeRewrite().
+  std::unique_ptr<RedirectLoader> redirect =
+      std::move(redirects_.extract(it).value());
+  redirect->Start(factory_);
+}
+
+void WhaleURLRewriteStage::RemoveRedirect(RedirectLoader* loader) {
+  auto it = redirects_.find(loader);
+  DCHECK(it != redirects_.end());
+  redirects_.erase(it);
+}
+
+}  // namespace network
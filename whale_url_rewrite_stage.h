@@ -0,0 +1,86 @@
+// Copyright (c) 2023 NAVER Corp. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WHALE_SERVICES_NETWORK_WHALE_URL_REWRITE_STAGE_H_
+#define WHALE_SERVICES_NETWORK_WHALE_URL_REWRITE_STAGE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+
+#include "base/containers/unique_ptr_adapters.h"
+#include "base/memory/raw_ptr.h"
+#include "mojo/public/cpp/bindings/pending_receiver.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "mojo/public/cpp/bindings/receiver.h"
+#include "net/traffic_annotation/network_traffic_annotation.h"
+#include "services/network/public/mojom/network_context.mojom-forward.h"
+#include "services/network/public/mojom/url_loader.mojom-forward.h"
+#include "whale/components/tracking_blockers/common/tracking_blocker.mojom.h"
+
+namespace network {
+
+struct ResourceRequest;
+class URLLoaderFactory;
+
+// Applies the tracking blocker site hacks to the requests of a
+// URLLoaderFactory that the browser created with URLRewriteSettings instead
+// of proxying it, see WhaleProxyingURLLoaderFactory::
+// PopulateURLRewriteSettings(). Owned by the factory, which hands every
+// request to MaybeRewrite() before starting it.
+class WhaleURLRewriteStage
+    : public whale_blocker::mojom::URLRewriteSettingsObserver {
+ public:
+  // Returns null unless |params| carries URLRewriteSettings.
+  static std::unique_ptr<WhaleURLRewriteStage> MaybeCreate(
+      URLLoaderFactory* factory,
+      mojom::URLLoaderFactoryParams* params);
+
+  WhaleURLRewriteStage(
+      URLLoaderFactory* factory,
+      whale_blocker::mojom::URLRewriteSettingsPtr settings,
+      mojo::PendingReceiver<whale_blocker::mojom::URLRewriteSettingsObserver>
+          receiver);
+  WhaleURLRewriteStage(const WhaleURLRewriteStage&) = delete;
+  WhaleURLRewriteStage& operator=(const WhaleURLRewriteStage&) = delete;
+  ~WhaleURLRewriteStage() override;
+
+  // Takes |receiver| and |client| and returns true if |request| has to be
+  // rewritten. A filtered URL reaches |client| as a synthetic redirect, the
+  // way WhaleProxyingURLLoaderFactory issues it, and the request restarts
+  // through the factory once the client follows it. A capped referrer alone
+  // restarts the request right away.
+  bool MaybeRewrite(
+      mojo::PendingReceiver<mojom::URLLoader>& receiver,
+      int32_t request_id,
+      uint32_t options,
+      const ResourceRequest& request,
+      mojo::PendingRemote<mojom::URLLoaderClient>& client,
+      const net::MutableNetworkTrafficAnnotationTag& traffic_annotation);
+
+ private:
+  class RedirectLoader;
+
+  // whale_blocker::mojom::URLRewriteSettingsObserver:
+  void OnURLRewriteSettingsChanged(
+      whale_blocker::mojom::URLRewriteSettingsPtr settings) override;
+
+  // Starts the request of |loader|, which was redirected, and deletes it.
+  void OnRedirectFollowed(RedirectLoader* loader);
+  void RemoveRedirect(RedirectLoader* loader);
+
+  const raw_ptr<URLLoaderFactory> factory_;
+  whale_blocker::mojom::URLRewriteSettingsPtr settings_;
+  mojo::Receiver<whale_blocker::mojom::URLRewriteSettingsObserver> receiver_{
+      this};
+
+  // Redirects waiting for the client to follow them.
+  std::set<std::unique_ptr<RedirectLoader>, base::UniquePtrComparator>
+      redirects_;
+};
+
+}  // namespace network
+
+#endif  // WHALE_SERVICES_NETWORK_WHALE_URL_REWRITE_STAGE_H_